@@ -72,6 +72,12 @@ int main() {
 	      << (tf.tv_usec - ti.tv_usec)
 	      << "us"
               << "  or  " << cycle_cpu_time << 's' << std::endl;
+
+    olson_tools::FreeListStats stats = bob::freeliststats();
+    std::cout << "hits = " << stats.hits
+              << ", misses = " << stats.misses
+              << ", heap allocs = " << stats.heap_allocs
+              << ", high water = " << stats.high_water << std::endl;
     return 0;
 }
 
@@ -0,0 +1,405 @@
+/** \file
+ * Benchmark suite for NSort:  scaling with the number of elements and the
+ * number of threads, for several data layouts and maps.
+ *
+ * usage:  benchmarkSort [options]
+ *   --min n          smallest number of elements            [1e3]
+ *   --max n          largest number of elements             [1e7]
+ *                    (the sizes run from min to max by factors of ten; 1e8
+ *                    particles needs roughly 20 GB of memory.)
+ *   --threads list   comma separated list of thread counts  [1,max]
+ *   --reps r         repetitions per point (best is kept)   [3]
+ *   --layout list    any of aos,swap,ptr,soa                [all]
+ *   --map list       any of 1D,2D,3D,species,3D+species,grid [all]
+ *   --json           write one JSON object per line instead of CSV
+ *
+ * The layouts are:
+ *   - aos:   std::vector<Particle>, sorted in place (sort_parallel_inplace).
+ *   - swap:  std::vector<Particle>, sorted into a persistent buffer
+ *            (sort_swap).
+ *   - ptr:   std::vector<Particle*>, sorted out of place (sort_parallel).
+ *   - soa:   positions/species and velocities in separate arrays.  The
+ *            positions are sorted with sort_index and both arrays are then
+ *            permuted together with nsort::Gather.
+ *
+ * For each point one record is written with the elements sorted per second
+ * of wall time and the modeled number of bytes read plus written per
+ * element (each pass over an array counted once, write-allocate ignored).
+ * If the Linux perf_event interface is available, cycles, instructions and
+ * last level cache misses per element are measured as well (these are empty
+ * (CSV) or null (JSON) otherwise).  The counters are opened before any
+ * threads are started so that all worker threads are counted.
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+#include <olson-tools/nsort/NSort.h>
+#include <olson-tools/nsort/gather.h>
+#include <olson-tools/nsort/map/_1D.h>
+#include <olson-tools/nsort/map/_2D.h>
+#include <olson-tools/nsort/map/_3D.h>
+#include <olson-tools/nsort/map/w_species.h>
+#include <olson-tools/nsort/map/species_only.h>
+#include <olson-tools/nsort/map/grid.h>
+#include <olson-tools/Timer.h>
+#include "Particle.h"
+
+#if defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+namespace {
+  using olson_tools::Vector;
+  using olson_tools::V3;
+  using olson_tools::nsort::NSort;
+  using olson_tools::nsort::tweak::Null;
+  namespace map = olson_tools::nsort::map;
+
+  const unsigned int n_species = 4;
+
+  /** The hot part of a particle for the structure-of-arrays layout. */
+  struct Position {
+    Vector<double,3> x;
+    int species;
+  };
+
+  inline const int & species( const Position & p ) { return p.species; }
+
+
+  /** Hardware counters for the whole process via perf_event_open.
+   * Each counter is opened separately (with inherit) since inherited
+   * counters cannot be read as a group. */
+  class PerfCounters {
+  public:
+    enum { CYCLES, INSTRUCTIONS, CACHE_MISSES, N };
+
+  private:
+    int fd[N];
+    long long start[N];
+
+  public:
+    long long value[N];
+
+    PerfCounters() {
+      static const unsigned long long config[N] = {
+#if defined(__linux__)
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES
+#endif
+      };
+      for (int i = 0; i < N; ++i) {
+        fd[i] = -1;
+        value[i] = start[i] = 0;
+#if defined(__linux__)
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config[i];
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+      }
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+      for (int i = 0; i < N; ++i)
+        if ( fd[i] >= 0 )
+          close(fd[i]);
+#endif
+    }
+
+    bool available( const int & i ) const { return fd[i] >= 0; }
+
+    void begin() {
+      for (int i = 0; i < N; ++i)
+        start[i] = read(i);
+    }
+
+    void end() {
+      for (int i = 0; i < N; ++i)
+        value[i] = read(i) - start[i];
+    }
+
+  private:
+    long long read( const int & i ) const {
+      long long v = 0;
+#if defined(__linux__)
+      if ( fd[i] >= 0 && ::read(fd[i], &v, sizeof(v)) != sizeof(v) )
+        v = 0;
+#endif
+      return v;
+    }
+  };
+
+
+  /** The options and the output format. */
+  struct Options {
+    int min_n, max_n, reps;
+    std::vector<int> threads;
+    std::string layouts, maps;
+    bool json;
+
+    Options()
+      : min_n(1000), max_n(10000000), reps(3),
+        layouts("aos,swap,ptr,soa"),
+        maps("1D,2D,3D,species,3D+species,grid"), json(false) {
+      threads.push_back(1);
+      if ( olson_tools::nsort::detail::max_threads() > 1 )
+        threads.push_back( olson_tools::nsort::detail::max_threads() );
+    }
+
+    static bool in_list( const std::string & list, const std::string & s ) {
+      std::istringstream in(list);
+      std::string item;
+      while ( std::getline(in, item, ',') )
+        if ( item == s )
+          return true;
+      return false;
+    }
+  };
+
+  /** One measurement. */
+  struct Record {
+    const char * map;
+    const char * layout;
+    int n, threads, n_values;
+    double seconds, bytes_per_elem;
+  };
+
+  void print_header( const Options & opt ) {
+    if ( !opt.json )
+      std::cout << "map,layout,n,threads,n_values,seconds,elem_per_s,"
+                   "bytes_per_elem,cycles_per_elem,instr_per_elem,"
+                   "llc_miss_per_elem" << std::endl;
+  }
+
+  void print( const Options & opt, const Record & r,
+              const PerfCounters & perf ) {
+    static const char * names[PerfCounters::N] = {
+      "cycles_per_elem", "instr_per_elem", "llc_miss_per_elem"
+    };
+    std::ostringstream out;
+    if ( opt.json )
+      out << "{\"map\": \"" << r.map << "\", \"layout\": \"" << r.layout
+          << "\", \"n\": " << r.n << ", \"threads\": " << r.threads
+          << ", \"n_values\": " << r.n_values
+          << ", \"seconds\": " << r.seconds
+          << ", \"elem_per_s\": " << (r.n / r.seconds)
+          << ", \"bytes_per_elem\": " << r.bytes_per_elem;
+    else
+      out << r.map << ',' << r.layout << ',' << r.n << ',' << r.threads
+          << ',' << r.n_values << ',' << r.seconds << ','
+          << (r.n / r.seconds) << ',' << r.bytes_per_elem;
+
+    for (int i = 0; i < PerfCounters::N; ++i) {
+      if ( opt.json ) {
+        out << ", \"" << names[i] << "\": ";
+        if ( perf.available(i) ) out << double(perf.value[i]) / r.n;
+        else                     out << "null";
+      } else {
+        out << ',';
+        if ( perf.available(i) ) out << double(perf.value[i]) / r.n;
+      }
+    }
+    if ( opt.json )
+      out << '}';
+    std::cout << out.str() << std::endl;
+  }
+
+
+  /** Deterministic particles in the box [-50,50)^3. */
+  void init( std::vector<Particle> & pv, const int & n ) {
+    srand(1);
+    pv.resize(n);
+    for (int i = 0; i < n; ++i) {
+      for (int a = 0; a < 3; ++a) {
+        pv[i].x[a] = 100.0 * rand() / (RAND_MAX + 1.0) - 50.0;
+        pv[i].v[a] = 100.0 * rand() / (RAND_MAX + 1.0) - 50.0;
+      }
+      pv[i].species = rand() % n_species;
+    }
+  }
+
+
+  /** Runs all of the layouts for one map, size and number of threads. */
+  template < class Map >
+  class Bench {
+    const Options & opt;
+    PerfCounters & perf;
+    const char * name;
+    Map m;
+    int n_values;
+    NSort<Map> s;
+
+    /* the pristine input and the working copies. */
+    const std::vector<Particle> & input;
+    std::vector<Particle> aos, buffer;
+    std::vector<Particle*> ptrs;
+    std::vector<Position> pos, pos2;
+    std::vector< Vector<double,3> > vel, vel2;
+    std::vector<int> perm;
+
+  public:
+    Bench( const Options & opt, PerfCounters & perf, const char * name,
+           const Map & m, const int & n_values,
+           const std::vector<Particle> & input )
+      : opt(opt), perf(perf), name(name), m(m), n_values(n_values),
+        s(n_values), input(input) { }
+
+    void run( const int & n, const int & nt ) {
+      const double P = sizeof(Particle);
+      const double H = sizeof(Position);
+      const double V = sizeof(Vector<double,3>);
+      const double I = sizeof(int);
+      const double S = sizeof(Particle*);
+
+      /* keys: read the particles.  permute: read and write them. */
+      if ( Options::in_list(opt.layouts, "aos") )
+        measure("aos", n, nt, 3*P);
+      /* keys: read.  scatter into the buffer:  read and write. */
+      if ( Options::in_list(opt.layouts, "swap") )
+        measure("swap", n, nt, 3*P);
+      /* keys: read the pointers and the particles.  scatter the pointers. */
+      if ( Options::in_list(opt.layouts, "ptr") )
+        measure("ptr", n, nt, 3*S + P);
+      /* sort_index: read the positions, write perm.  gather: read perm
+       * (twice) and read and write both arrays. */
+      if ( Options::in_list(opt.layouts, "soa") )
+        measure("soa", n, nt, H + 3*I + 2*(H + V));
+    }
+
+  private:
+    void measure( const char * layout, const int & n, const int & nt,
+                  const double & bytes ) {
+      Record r = { name, layout, n, nt, n_values, 0.0, bytes };
+      olson_tools::Timer timer;
+      long long best[PerfCounters::N] = { 0 };
+
+      for (int rep = 0; rep < opt.reps; ++rep) {
+        prepare(layout, n);
+        perf.begin();
+        timer.start();
+        sort(layout, n, nt);
+        timer.stop();
+        perf.end();
+        if ( rep == 0 || timer.dt < r.seconds ) {
+          r.seconds = timer.dt;
+          for (int i = 0; i < PerfCounters::N; ++i)
+            best[i] = perf.value[i];
+        }
+      }
+
+      for (int i = 0; i < PerfCounters::N; ++i)
+        perf.value[i] = best[i];
+      print(opt, r, perf);
+    }
+
+    /** Copy the pristine input into the layout (not timed). */
+    void prepare( const char * layout, const int & n ) {
+      if ( std::strcmp(layout, "soa") == 0 ) {
+        pos.resize(n);
+        vel.resize(n);
+        pos2.resize(n);
+        vel2.resize(n);
+        perm.resize(n);
+        for (int i = 0; i < n; ++i) {
+          pos[i].x = input[i].x;
+          pos[i].species = input[i].species;
+          vel[i] = input[i].v;
+        }
+        return;
+      }
+
+      aos.assign(input.begin(), input.begin() + n);
+      if ( std::strcmp(layout, "ptr") == 0 ) {
+        ptrs.resize(n);
+        for (int i = 0; i < n; ++i)
+          ptrs[i] = &aos[i];
+      }
+    }
+
+    void sort( const char * layout, const int & n, const int & nt ) {
+      if ( std::strcmp(layout, "aos") == 0 )
+        s.sort_parallel_inplace(aos.begin(), aos.end(), m, Null(), nt);
+      else if ( std::strcmp(layout, "swap") == 0 )
+        s.sort_swap(aos, buffer, m, Null(), nt);
+      else if ( std::strcmp(layout, "ptr") == 0 )
+        s.sort_parallel(ptrs.begin(), ptrs.end(), m, Null(), nt);
+      else {
+        s.sort_index(pos.begin(), pos.end(), &perm[0], m, Null(), nt);
+        olson_tools::nsort::Gather()(&pos[0], &pos2[0])
+                                    (&vel[0], &vel2[0])
+                                    .apply(&perm[0], n, nt);
+      }
+    }
+  };
+
+  template < class Map >
+  void run_map( const Options & opt, PerfCounters & perf, const char * name,
+                const Map & m, const int & n_values,
+                const std::vector<Particle> & input ) {
+    if ( !Options::in_list(opt.maps, name) )
+      return;
+    Bench<Map> b(opt, perf, name, m, n_values, input);
+    for (int n = opt.min_n; n <= opt.max_n; n *= 10)
+      for (unsigned int t = 0; t < opt.threads.size(); ++t)
+        b.run(n, opt.threads[t]);
+  }
+}
+
+int main(int argc, char ** argv) {
+  /* opened first so that the counters are inherited by all threads. */
+  PerfCounters perf;
+
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const char * val = (i + 1 < argc) ? argv[i+1] : "";
+    if      ( arg == "--min" )     { opt.min_n = int(atof(val)); ++i; }
+    else if ( arg == "--max" )     { opt.max_n = int(atof(val)); ++i; }
+    else if ( arg == "--reps" )    { opt.reps = atoi(val); ++i; }
+    else if ( arg == "--layout" )  { opt.layouts = val; ++i; }
+    else if ( arg == "--map" )     { opt.maps = val; ++i; }
+    else if ( arg == "--json" )    { opt.json = true; }
+    else if ( arg == "--threads" ) {
+      opt.threads.clear();
+      std::istringstream in(val);
+      std::string t;
+      while ( std::getline(in, t, ',') )
+        opt.threads.push_back( atoi(t.c_str()) );
+      ++i;
+    } else {
+      std::cerr << "unknown option:  " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<Particle> input;
+  init(input, opt.max_n);
+
+  using namespace map;
+  print_header(opt);
+  run_map(opt, perf, "1D", pivot_ctor< _1D<0> >(), 2, input);
+  run_map(opt, perf, "2D", pivot_ctor< _2D<0,1> >(), 4, input);
+  run_map(opt, perf, "3D", pivot_ctor< _3D<0,1,2> >(), 8, input);
+  run_map(opt, perf, "species", species_only(), n_species, input);
+  run_map(opt, perf, "3D+species",
+          pivot_ctor< w_species< _3D<0,1,2> > >(n_species), 8*n_species,
+          input);
+  run_map(opt, perf, "grid",
+          grid<16,16,16>( V3(-50.,-50.,-50.), V3(50.,50.,50.) ), 4096, input);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/** \file
+ * Timing of the in-place NSort variants against the out-of-place sort_copy and
+ * sort_swap variants for arrays of a small POD record and of the (trivially
+ * copyable, but not POD) example Particle.
+ *
+ * usage:  timeSortCopy [max_n [n_values [nthreads]]]
+ *
+ * The number of elements runs from 1e5 up to max_n (default 1e8) by factors of
+ * ten.  Each line reports the number of elements sorted per second of wall
+ * time.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+
+#include <olson-tools/nsort/NSort.h>
+#include <olson-tools/nsort/map/species_only.h>
+#include <olson-tools/Timer.h>
+#include "Particle.h"
+
+namespace {
+  /** A 32 byte POD record (similar in size to a lightweight particle). */
+  struct Record {
+    int value;
+    int id;
+    double x[3];
+  };
+
+  struct record_value {
+    int operator() ( const Record & r ) const { return r.value; }
+  };
+
+  void initRecords( std::vector<Record> & v, const int & n,
+                    const int & n_values ) {
+    srand(1);
+    v.resize(n);
+    for (int i = 0; i < n; ++i) {
+      v[i].value = rand() % n_values;
+      v[i].id = i;
+      v[i].x[0] = v[i].x[1] = v[i].x[2] = double(i);
+    }
+  }
+
+  void report( const char * type, const char * name, const int & n,
+               olson_tools::Timer & t ) {
+    std::cout << std::setw(10) << type << std::setw(16) << name
+              << std::setw(12) << n
+              << std::setw(14) << (n / t.dt) << " elem/s\n";
+  }
+
+  /** Time each of the sort variants for n elements of type T. */
+  template < typename T, typename Map >
+  void timeSorts( const char * type,
+                  void (*init)(std::vector<T> &, const int &, const int &),
+                  const Map & map, const int & n, const int & n_values,
+                  const int & nthreads ) {
+    using olson_tools::nsort::NSort;
+    using olson_tools::nsort::tweak::Null;
+
+    static NSort<Map> s(n_values);
+    static std::vector<T> v, out, buffer;
+    olson_tools::Timer timer;
+
+    init(v, n, n_values);
+    timer.start();
+    s.sort(v.begin(), v.end(), map);
+    timer.stop();
+    report(type, "sort", n, timer);
+
+    init(v, n, n_values);
+    timer.start();
+    s.sort_parallel(v.begin(), v.end(), map, Null(), nthreads);
+    timer.stop();
+    report(type, "sort_parallel", n, timer);
+
+    init(v, n, n_values);
+    timer.start();
+    s.sort_parallel_inplace(v.begin(), v.end(), map, Null(), nthreads);
+    timer.stop();
+    report(type, "sort_inplace", n, timer);
+
+    /* sort_copy into an already allocated (and touched) output. */
+    init(v, n, n_values);
+    out.resize(n);
+    timer.start();
+    s.sort_copy(&v[0], &v[0] + n, &out[0], NULL, map, Null(), nthreads);
+    timer.stop();
+    report(type, "sort_copy", n, timer);
+
+    /* the buffer is kept between sorts as it would be in a simulation. */
+    init(v, n, n_values);
+    timer.start();
+    s.sort_swap(v, buffer, map, Null(), nthreads);
+    timer.stop();
+    report(type, "sort_swap", n, timer);
+  }
+}
+
+int main(int argc, char ** argv) {
+  const int max_n    = argc > 1 ? int(atof(argv[1])) : 100000000;
+  const int n_values = argc > 2 ? atoi(argv[2]) : 512;
+  const int nthreads = argc > 3 ? atoi(argv[3]) : 0;
+
+  for (int n = 100000; n <= max_n; n *= 10) {
+    timeSorts<Record>("Record", initRecords, record_value(),
+                      n, n_values, nthreads);
+    timeSorts<Particle>("Particle", initPVector,
+                        olson_tools::nsort::map::species_only(),
+                        n, n_values, nthreads);
+    std::cout << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
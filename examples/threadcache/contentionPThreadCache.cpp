@@ -0,0 +1,128 @@
+/** \file
+ * Contention benchmark of the work-stealing PThreadCache against the previous
+ * single-queue implementation (GlobalQueueCache.h).  Batches of short tasks
+ * are added from the main thread and waited for with waitForTasks(...) (or
+ * with a completion queue for the "completion" rows).
+ *
+ * usage:  contentionPThreadCache [max_threads [n_tasks [batch [trace]]]]
+ *
+ * Each line (CSV) gives the tasks completed per second for one cache, number
+ * of threads and amount of work per task (iterations of a short loop).
+ *
+ * If a trace file name is given, the work-stealing cache is instrumented:
+ * the statistics of its threads are printed (to stderr) for each number of
+ * threads, and the timeline of the last number of threads is written to the
+ * trace file (Chrome trace event format).
+ */
+
+#include <olson-tools/PThreadCache.h>
+#include <olson-tools/Timer.h>
+#include "GlobalQueueCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+  struct Task : olson_tools::PThreadTask {
+    int work;
+    double retval;
+
+    Task() : work(0), retval(0) { }
+    virtual void exec() {
+      double x = 1.0;
+      for (int i = 0; i < work; ++i)
+        x = x * 1.0000001 + 1e-9;
+      retval = x;
+    }
+  };
+
+  template < typename Cache >
+  double run( Cache & cache, const int & n_tasks, const int & batch,
+              const int & work ) {
+    std::vector<Task> tasks(batch);
+    for (int i = 0; i < batch; ++i)
+      tasks[i].work = work;
+
+    olson_tools::Timer timer;
+    timer.start();
+    for (int done = 0; done < n_tasks; done += batch) {
+      olson_tools::PThreadTaskSet queued;
+      for (int i = 0; i < batch; ++i) {
+        queued.insert(&tasks[i]);
+        cache.addTask(&tasks[i]);
+      }
+
+      while ( queued.size() ) {
+        olson_tools::PThreadTaskSet finished = cache.waitForTasks(queued);
+        for ( olson_tools::PThreadTaskSet::iterator i = finished.begin();
+              i != finished.end(); ++i )
+          queued.erase(*i);
+      }
+    }
+    timer.stop();
+    return timer.dt;
+  }
+
+  /** The same with a PThreadCompletion instead of waitForTasks. */
+  double run_completion( olson_tools::PThreadCache & cache, const int & n_tasks,
+                         const int & batch, const int & work ) {
+    std::vector<Task> tasks(batch);
+    for (int i = 0; i < batch; ++i)
+      tasks[i].work = work;
+
+    olson_tools::PThreadCompletion completion;
+    olson_tools::Timer timer;
+    timer.start();
+    for (int done = 0; done < n_tasks; done += batch) {
+      for (int i = 0; i < batch; ++i)
+        cache.addTask(&tasks[i], completion);
+      while ( cache.waitForAny(completion) != NULL );
+    }
+    timer.stop();
+    return timer.dt;
+  }
+}
+
+int main(int argc, char ** argv) {
+  const int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+  const int n_tasks     = argc > 2 ? int(atof(argv[2])) : 100000;
+  const int batch       = argc > 3 ? atoi(argv[3]) : 256;
+  const char * trace    = argc > 4 ? argv[4] : NULL;
+
+  olson_tools::PThreadCache stealing;
+  baseline::GlobalQueueCache global;
+  if ( trace )
+    stealing.set_instrumentation( olson_tools::PThreadStats::TRACE );
+
+  std::cout << "cache,threads,work,tasks,seconds,tasks_per_s" << std::endl;
+  const int works[] = {0, 1000, 100000};
+  for (int threads = 2; threads <= max_threads; threads *= 2) {
+    stealing.set_max_threads(threads);
+    global.set_max_threads(threads);
+
+    for (int w = 0; w < 3; ++w) {
+      /* fewer of the longer tasks. */
+      const int n = works[w] > 1000 ? n_tasks / 100 : n_tasks;
+      double dt = run(global, n, batch, works[w]);
+      std::cout << "global," << threads << ',' << works[w] << ',' << n << ','
+                << dt << ',' << (n / dt) << std::endl;
+      dt = run(stealing, n, batch, works[w]);
+      std::cout << "stealing," << threads << ',' << works[w] << ',' << n << ','
+                << dt << ',' << (n / dt) << std::endl;
+      dt = run_completion(stealing, n, batch, works[w]);
+      std::cout << "completion," << threads << ',' << works[w] << ',' << n
+                << ',' << dt << ',' << (n / dt) << std::endl;
+    }
+
+    if ( trace ) {
+      std::cerr << "stealing cache with " << threads << " threads:\n";
+      stealing.print_stats(std::cerr);
+      std::ofstream out(trace);
+      stealing.write_trace(out);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * A simple region (arena) allocator.
+ *
+ * An Arena hands out memory from a few large contiguous chunks by bumping a
+ * pointer.  Objects placed in an arena are never freed one at a time;
+ * instead, the whole arena is either rewound for reuse (reset()) or given
+ * back to the heap (release()).  This suits groups of objects that are
+ * created together and die together, such as the population of a
+ * Generation or the arrays of a lookup table, and it keeps the members of
+ * such a group next to each other in memory.
+ *
+ * An Arena is not thread-safe; each thread (or each owner) should use its own.
+ */
+
+#ifndef olson_tools_Arena_h
+#define olson_tools_Arena_h
+
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#include <boost/static_assert.hpp>
+
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+
+namespace olson_tools {
+
+  /** A region allocator made of a list of contiguous chunks. */
+  class Arena {
+    /* TYPEDEFS */
+  public:
+    /** The default size of a chunk (in bytes). */
+    static const std::size_t default_chunk_size = 64 * 1024;
+
+    /** The default alignment of allocations (in bytes). */
+    static const std::size_t default_alignment = 16;
+
+  private:
+    /** The header of each chunk; the memory of the chunk follows it. */
+    struct Chunk {
+      Chunk * next;
+      std::size_t size;
+
+      char * begin() { return reinterpret_cast<char*>(this) + header_size(); }
+      char * end()   { return begin() + size; }
+    };
+
+    static std::size_t header_size() {
+      const std::size_t a = default_alignment;
+      return (sizeof(Chunk) + a - 1) & ~(a - 1);
+    }
+
+
+    /* STORAGE MEMBERS */
+    /** The first chunk of the list. */
+    Chunk * first;
+
+    /** The chunk being allocated from; the chunks after it are free. */
+    Chunk * current;
+
+    /** The next free byte and the end of the current chunk. */
+    char * ptr;
+    char * limit;
+
+    /** The size of newly allocated chunks. */
+    std::size_t chunk_size;
+
+    /** The number of bytes handed out since the last reset. */
+    std::size_t used;
+
+
+    /* MEMBER FUNCTIONS */
+  public:
+    /** Constructor.  No memory is allocated until it is first needed.
+     * @param chunk_size
+     *    The size of each chunk (larger requests get a chunk of their own).
+     */
+    explicit Arena( std::size_t chunk_size = default_chunk_size )
+      : first(NULL), current(NULL), ptr(NULL), limit(NULL),
+        chunk_size(chunk_size), used(0) { }
+
+    /** Destructor gives all chunks back to the heap.  No destructors of
+     * objects in the arena are called. */
+    ~Arena() { release(); }
+
+    /** Allocate uninitialized memory.
+     * @param bytes
+     *    The number of bytes needed.
+     * @param align
+     *    The alignment (a power of two, at most default_alignment).
+     */
+    void * allocate( const std::size_t & bytes,
+                     std::size_t align = default_alignment ) {
+      char * p = align_up(ptr, align);
+      if ( !fits(p, bytes) ) {
+        next_chunk(bytes);
+        p = ptr;
+      }
+      ptr = p + bytes;
+      used += bytes;
+      return p;
+    }
+
+    /** Allocate space for n objects of type T without constructing them. */
+    template < typename T >
+    T * allocate_array( const std::size_t & n ) {
+      return static_cast<T*>( allocate( n * sizeof(T), alignment_of<T>() ) );
+    }
+
+    /** Allocate and default-construct n objects of type T.  Since the arena
+     * never runs destructors, T must be trivially destructible. */
+    template < typename T >
+    T * construct_array( const std::size_t & n ) {
+      BOOST_STATIC_ASSERT(( boost::has_trivial_destructor<T>::value ));
+      T * a = allocate_array<T>(n);
+      for ( std::size_t i = 0; i < n; ++i )
+        new (a + i) T();
+      return a;
+    }
+
+    /** Make sure that the next bytes (in total) of allocations come from a
+     * single contiguous chunk. */
+    void reserve( const std::size_t & bytes ) {
+      if ( !fits(align_up(ptr, default_alignment), bytes) )
+        next_chunk(bytes);
+    }
+
+    /** Rewind the arena such that all of its memory may be reused.  The
+     * chunks are kept.  Anything previously allocated from the arena must no
+     * longer be used. */
+    void reset() {
+      current = NULL;
+      ptr = limit = NULL;
+      used = 0;
+    }
+
+    /** Give all chunks back to the heap. */
+    void release() {
+      while ( first ) {
+        Chunk * c = first;
+        first = first->next;
+        std::free(c);
+      }
+      reset();
+    }
+
+    /** The number of bytes handed out since the last reset (not counting
+     * alignment padding). */
+    std::size_t size() const { return used; }
+
+    /** The number of bytes in all chunks. */
+    std::size_t capacity() const {
+      std::size_t c = 0;
+      for ( Chunk * i = first; i; i = i->next )
+        c += i->size;
+      return c;
+    }
+
+    /** The number of chunks. */
+    int n_chunks() const {
+      int n = 0;
+      for ( Chunk * i = first; i; i = i->next )
+        ++n;
+      return n;
+    }
+
+  private:
+    /* not copyable. */
+    Arena( const Arena & );
+    Arena & operator= ( const Arena & );
+
+    template < typename T >
+    static std::size_t alignment_of() {
+      const std::size_t a = __alignof__(T);
+      if ( a < default_alignment )
+        return a;
+      else
+        return default_alignment;
+    }
+
+    static char * align_up( char * p, std::size_t align ) {
+      const std::size_t a = align - 1;
+      return reinterpret_cast<char*>(
+        (reinterpret_cast<std::size_t>(p) + a) & ~a );
+    }
+
+    /** Whether bytes fit into the current chunk at p. */
+    bool fits( char * p, const std::size_t & bytes ) const {
+      return current && p <= limit && bytes <= std::size_t(limit - p);
+    }
+
+    /** Move on to the next (retained or new) chunk that fits bytes. */
+    void next_chunk( const std::size_t & bytes ) {
+      /* look through the remaining retained chunks first. */
+      Chunk * prev = current;
+      Chunk * c = current ? current->next : first;
+      while ( c && c->size < bytes ) {
+        prev = c;
+        c = c->next;
+      }
+
+      if ( !c ) {
+        /* nothing retained is large enough; add a new chunk at the end. */
+        std::size_t sz = chunk_size;
+        if ( sz < bytes )
+          sz = bytes;
+        c = static_cast<Chunk*>( std::malloc( header_size() + sz ) );
+        if ( !c )
+          throw std::bad_alloc();
+        c->next = NULL;
+        c->size = sz;
+        if ( prev )
+          prev->next = c;
+        else
+          first = c;
+      }
+
+      current = c;
+      ptr = c->begin();
+      limit = c->end();
+    }
+  };
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_Arena_h
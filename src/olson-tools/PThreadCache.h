@@ -39,129 +39,580 @@
 
 
 
+#include <olson-tools/WorkDeque.h>
+#include <olson-tools/PThreadStats.h>
+#include <olson-tools/ThreadPlacement.h>
+
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <set>
-#include <queue>
+#include <deque>
+#include <vector>
 #include <algorithm>
+#include <ostream>
 
 #include <cstdio>
+#include <cstdlib>
 
 namespace olson_tools {
 
+  class PThreadCompletion;
+
   /** The basic pthread task structure.  Inheriting classes must implement the
    * exec() function. */
   class PThreadTask {
     public:
-      PThreadTask() {}
+      PThreadTask() : completion(NULL), next(NULL), queued(0) {}
       virtual ~PThreadTask() {}
       virtual void exec() = 0;
+
+    private:
+      friend class PThreadCache;
+      friend class PThreadCompletion;
+
+      /** Where to report the completion (NULL for waitForTasks). */
+      PThreadCompletion * completion;
+
+      /** The next task in the completion queue. */
+      PThreadTask * next;
+
+      /** When the task was queued (only set when instrumented). */
+      long long queued;
   };
 
   /** A set of pointers to tasks. */
   typedef std::set<PThreadTask *> PThreadTaskSet;
 
-  /** A PThreads threads cache and associated tasks manager. */
-  class PThreadCache {
+  /** A completion queue for the tasks of one owner.  The tasks given to
+   * PThreadCache::addTask(task, completion) are appended to this queue (an
+   * intrusive list, in the order in which they finish) when they finish.
+   * Waiting for any or all of the owner's tasks (see
+   * PThreadCache::waitForAny and PThreadCache::waitForAll) costs O(1) per
+   * finished task and needs no allocation; only the owner's own lock is
+   * taken when a task finishes.
+   *
+   * A task may only be added to one completion queue at a time, and the
+   * queue must outlive its outstanding tasks.
+   */
+  class PThreadCompletion {
   private:
-    int max_threads;    /* protected by max_threads_spinlock */
-    int active_threads; /* protected by max_threads_spinlock (yes, same one) */
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
 
-    pthread_attr_t  pthread_attr;
-    pthread_mutex_t task_queue_mutex; /* mutex to protect the queue items. */
-    pthread_cond_t  task_ready_cond;  /* condition for task queue additions. */
-    pthread_cond_t  task_finished_cond;
-    pthread_mutex_t task_finished_mutex;/* mutex to protect the finished set. */
-    pthread_spinlock_t max_threads_spinlock;/* mutex to protect max_threads. */
+    /** The finished tasks that have not been taken yet. */
+    PThreadTask * head, * tail;
+    int n_finished;
 
-    pthread_t * threads; /* do we actually need to keep thread ids? */
+    /** The number of tasks added but not finished. */
+    int n_outstanding;
 
+    /** The number of threads blocked in wait(). */
+    int n_waiting;
 
-    std::queue<PThreadTask *> task_queue; /* a linked list of tasks to do. */
-    PThreadTaskSet finished_tasks; /* a linked list of finished tasks. */
+    /* not copyable. */
+    PThreadCompletion( const PThreadCompletion & );
+    PThreadCompletion & operator= ( const PThreadCompletion & );
 
-    bool slavesQuit;
+    friend class PThreadCache;
 
-    inline void signalSlavesQuit() {
-      /* We'll use the task_queue_mutex, just because each slave will exit the
-       * cond_wait() holding this mutex.  So, if we already hold it,
-       * they can't read the quit variable. */
-      pthread_mutex_lock(&task_queue_mutex);
+    inline void added() {
+      pthread_mutex_lock(&mutex);
+      ++n_outstanding;
+      pthread_mutex_unlock(&mutex);
+    }
 
-      slavesQuit = true;
-      /* now send the message to all slaves. */
-      pthread_cond_broadcast(&task_ready_cond);
+    inline void finished( PThreadTask * task ) {
+      pthread_mutex_lock(&mutex);
+      task->next = NULL;
+      if ( tail )   tail->next = task;
+      else          head = task;
+      tail = task;
+      ++n_finished;
+      --n_outstanding;
+      if ( n_waiting > 0 )
+        pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+    }
 
-      pthread_mutex_unlock(&task_queue_mutex);
+    /** Block until a task is finished or none are outstanding.
+     * @param timeout_ns
+     *    If > 0, return after at most this long.
+     */
+    void wait( const long & timeout_ns = 0 ) {
+      pthread_mutex_lock(&mutex);
+      if ( head == NULL && n_outstanding > 0 ) {
+        ++n_waiting;
+        if ( timeout_ns > 0 ) {
+          struct timespec t;
+          clock_gettime(CLOCK_REALTIME, &t);
+          t.tv_nsec += timeout_ns;
+          t.tv_sec += t.tv_nsec / 1000000000;
+          t.tv_nsec %= 1000000000;
+          pthread_cond_timedwait(&cond, &mutex, &t);
+        } else {
+          while ( head == NULL && n_outstanding > 0 )
+            pthread_cond_wait(&cond, &mutex);
+        }
+        --n_waiting;
+      }
+      pthread_mutex_unlock(&mutex);
     }
 
-    inline void resetSlavesQuit() {
-      pthread_mutex_lock(&task_queue_mutex);
-      slavesQuit = false;
-      pthread_mutex_unlock(&task_queue_mutex);
+  public:
+    PThreadCompletion()
+      : head(NULL), tail(NULL), n_finished(0), n_outstanding(0),
+        n_waiting(0) {
+      pthread_mutex_init(&mutex, NULL);
+      pthread_cond_init(&cond, NULL);
     }
 
+    ~PThreadCompletion() {
+      pthread_mutex_destroy(&mutex);
+      pthread_cond_destroy(&cond);
+    }
 
-    inline PThreadTask * getTask() {
-      PThreadTask * task = NULL;
-      pthread_mutex_lock(&task_queue_mutex);
+    /** Take the next finished task (without blocking).
+     * @return NULL if no task has finished.
+     */
+    PThreadTask * pop() {
+      pthread_mutex_lock(&mutex);
+      PThreadTask * task = head;
+      if ( task ) {
+        head = task->next;
+        if ( head == NULL )
+          tail = NULL;
+        task->next = NULL;
+        task->completion = NULL;
+        --n_finished;
+      }
+      pthread_mutex_unlock(&mutex);
+      return task;
+    }
 
-      while (!slavesQuit) {
-        task = task_queue.empty() ? NULL : task_queue.front();
-        if (task == NULL){
-          pthread_cond_wait(&task_ready_cond, &task_queue_mutex);
-        } else {
-          task_queue.pop();
-          break;
+    /** The number of tasks that have been added but have not finished. */
+    int outstanding() {
+      pthread_mutex_lock(&mutex);
+      const int n = n_outstanding;
+      pthread_mutex_unlock(&mutex);
+      return n;
+    }
+
+    /** The number of finished tasks that have not been taken by pop(). */
+    int finished() {
+      pthread_mutex_lock(&mutex);
+      const int n = n_finished;
+      pthread_mutex_unlock(&mutex);
+      return n;
+    }
+  };
+
+  /** A PThreads threads cache and associated tasks manager.
+   *
+   * The tasks are distributed with work stealing:  each thread has its own
+   * lock-free deque (see WorkDeque) onto which the tasks added by that thread
+   * (such as the sub-tasks of a task) are pushed and from which it takes its
+   * newest task.  Tasks added by other threads are posted round-robin to the
+   * (separately locked) inboxes of the threads.  A thread that runs out of
+   * work steals the oldest task of another thread.  Threads that find no work
+   * at all park on a condition variable; adding a task wakes only one of
+   * them, and only if there are parked threads.
+   *
+   * The completion of a task is reported either to a PThreadCompletion
+   * queue given to addTask (see waitForAny and waitForAll) or to the finished
+   * set of waitForTasks(...).  A cache thread that waits for tasks executes
+   * other tasks while it waits, so tasks may add sub-tasks and wait for them
+   * without tying up the thread.
+   *
+   * The cache can optionally count the queue wait and execution time of the
+   * tasks and the idle time and steals of each thread (see
+   * set_instrumentation, print_stats and write_trace).
+   *
+   * The threads can be pinned to CPUs (see set_placement), in which case
+   * they prefer to steal work from the threads on the same NUMA node.
+   *
+   * set_max_threads(...) should not be called concurrently with addTask(...)
+   * for the same cache.
+   */
+  class PThreadCache {
+  private:
+    /** The per-thread task queues. */
+    struct Worker {
+      PThreadCache * cache;
+      pthread_t thread;
+
+      /** Tasks added by this thread. */
+      WorkDeque<PThreadTask> deque;
+
+      /** Tasks added by threads that are not part of the cache. */
+      std::deque<PThreadTask *> inbox;
+      int inbox_size; /* atomic; allows skipping the lock when empty. */
+      pthread_spinlock_t inbox_spinlock;
+
+      /** State of the victim selection. */
+      unsigned int seed;
+
+      /** Where the last task of findTask came from. */
+      PThreadStats::Source source;
+
+      /** Written only by this thread (when instrumented). */
+      PThreadStats stats;
+
+      /** The CPU and NUMA node of this thread (-1 if not pinned). */
+      int cpu, node;
+
+      /** The threads to steal from:  first those on the same node. */
+      std::vector<Worker *> local, remote;
+
+      Worker( PThreadCache * cache, const int & index )
+        : cache(cache), inbox_size(0), seed(2654435761u * (index + 1)),
+          source(PThreadStats::OWN), cpu(-1), node(-1) {
+        pthread_spin_init(&inbox_spinlock, 0);
+      }
+
+      ~Worker() { pthread_spin_destroy(&inbox_spinlock); }
+
+      void post( PThreadTask * task ) {
+        pthread_spin_lock(&inbox_spinlock);
+        inbox.push_back(task);
+        __atomic_store_n( &inbox_size, int(inbox.size()), __ATOMIC_RELEASE );
+        pthread_spin_unlock(&inbox_spinlock);
+      }
+
+      PThreadTask * takeInbox() {
+        if ( __atomic_load_n( &inbox_size, __ATOMIC_ACQUIRE ) == 0 )
+          return NULL;
+        PThreadTask * task = NULL;
+        pthread_spin_lock(&inbox_spinlock);
+        if ( !inbox.empty() ) {
+          task = inbox.front();
+          inbox.pop_front();
+          __atomic_store_n( &inbox_size, int(inbox.size()), __ATOMIC_RELEASE );
         }
+        pthread_spin_unlock(&inbox_spinlock);
+        return task;
       }
 
-      pthread_mutex_unlock(&task_queue_mutex);
+      /** Steal from one of the victims (starting at a random one). */
+      PThreadTask * stealFrom( const std::vector<Worker *> & victims ) {
+        const int n = victims.size();
+        PThreadTask * task = NULL;
+        for (int i = 0, v = n ? random() % n : 0; task == NULL && i < n; ++i) {
+          Worker * victim = victims[ (v + i) % n ];
+          task = victim->deque.steal();
+          if ( task == NULL )
+            task = victim->takeInbox();
+        }
+        return task;
+      }
+
+      unsigned int random() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+      }
+    };
+
+    /** The number of rounds of looking for work before parking. */
+    static const int spin_rounds = 16;
+
+    int max_threads;    /* atomic; changed only by set_max_threads */
+    int active_threads; /* atomic */
+
+    /** The number of queued tasks (incremented before the task is queued,
+     * decremented when it is taken). */
+    int pending;        /* atomic */
+    int sleeping;       /* atomic; the number of parked threads. */
+    bool slavesQuit;    /* atomic */
+    unsigned int next_inbox; /* atomic */
+
+    /** The PThreadStats::Level of instrumentation. */
+    int instrument;     /* atomic */
+    long long epoch;    /* the start of the statistics. */
+
+    /** How the threads are pinned to CPUs. */
+    ThreadPlacement placement;
+
+    pthread_attr_t  pthread_attr;
+    pthread_mutex_t config_mutex;     /* serializes set_max_threads. */
+    pthread_mutex_t park_mutex;       /* mutex for parking idle threads. */
+    pthread_cond_t  park_cond;
+    pthread_cond_t  task_finished_cond;
+    pthread_mutex_t task_finished_mutex;/* mutex to protect the finished set. */
+    int n_waiting;      /* protected by task_finished_mutex */
+
+    /** Identifies the Worker of the calling thread (if any). */
+    pthread_key_t worker_key;
+
+    std::vector<Worker *> workers;
+
+    PThreadTaskSet finished_tasks; /* a linked list of finished tasks. */
+
+    /** The Worker of the calling thread, or NULL if it is not a thread of
+     * this cache. */
+    inline Worker * self() const {
+      return static_cast<Worker*>( pthread_getspecific(worker_key) );
+    }
+
+    /** Take a task from our own deque, our inbox or from another thread.
+     * @param w
+     *    The Worker of the calling thread.
+     */
+    PThreadTask * findTask( Worker * w ) {
+      w->source = PThreadStats::OWN;
+      PThreadTask * task = w->deque.pop();
+      if ( task == NULL ) {
+        task = w->takeInbox();
+        w->source = PThreadStats::INBOX;
+      }
+
+      if ( task == NULL ) {
+        w->source = PThreadStats::STOLEN;
+        task = w->stealFrom(w->local);
+        if ( task == NULL )
+          task = w->stealFrom(w->remote);
+      }
+
+      if ( task != NULL )
+        __atomic_sub_fetch( &pending, 1, __ATOMIC_SEQ_CST );
       return task;
     }
 
+    inline PThreadTask * getTask( Worker * w ) {
+      const int level = __atomic_load_n( &instrument, __ATOMIC_RELAXED );
+      const long long t0 = level ? PThreadStats::now() : 0;
+      long parks = 0;
+      while ( !__atomic_load_n( &slavesQuit, __ATOMIC_ACQUIRE ) ) {
+        for (int r = 0; r < spin_rounds; ++r) {
+          PThreadTask * task = findTask(w);
+          if ( task != NULL ) {
+            /* (the statistics are only written when a task is found, such
+             * that they may be read while the threads are idle.) */
+            if ( level ) {
+              w->stats.parks += parks;
+              w->stats.idled( level, t0, PThreadStats::now() );
+            }
+            return task;
+          }
+          if ( __atomic_load_n( &pending, __ATOMIC_SEQ_CST ) <= 0 )
+            break;
+          sched_yield();
+        }
+
+        /* park until a task is added.  sleeping is incremented before
+         * pending is checked, while addTask increments pending before
+         * checking sleeping, so that one of the two sees the other. */
+        ++parks;
+        pthread_mutex_lock(&park_mutex);
+        __atomic_add_fetch( &sleeping, 1, __ATOMIC_SEQ_CST );
+        while ( __atomic_load_n( &pending, __ATOMIC_SEQ_CST ) <= 0 &&
+                !__atomic_load_n( &slavesQuit, __ATOMIC_ACQUIRE ) )
+          pthread_cond_wait(&park_cond, &park_mutex);
+        __atomic_sub_fetch( &sleeping, 1, __ATOMIC_SEQ_CST );
+        pthread_mutex_unlock(&park_mutex);
+      }
+      return NULL;
+    }
+
     /** Add this task to the finished tasks vector and signal the waiting
      * task owners that a task has finished. */
     inline void signalTaskFinished(PThreadTask * task) {
+      if ( task->completion ) {
+        task->completion->finished(task);
+        return;
+      }
+
       /* add the task to the finished tasks. */
       pthread_mutex_lock(&task_finished_mutex);
 
       finished_tasks.insert(task);
-      pthread_cond_broadcast(&task_finished_cond);
+      if ( n_waiting > 0 )
+        pthread_cond_broadcast(&task_finished_cond);
 
       pthread_mutex_unlock(&task_finished_mutex);
     }
 
-    /** Executes all tasks placed in the task queue. */
-    static void taskSlave(PThreadCache * cache) {
+    /** Queue (or execute) a task. */
+    void queueTask( PThreadTask * task, bool self_if_none_avail ) {
+      const int mx = __atomic_load_n( &max_threads, __ATOMIC_ACQUIRE );
+      bool serial = mx <= 1 ||
+                    ( self_if_none_avail &&
+                      ( mx - __atomic_load_n( &active_threads,
+                                              __ATOMIC_RELAXED ) ) <= 0 );
+
+      if ( serial ) {
+        task->exec();
+        signalTaskFinished(task);
+        return;
+      }
+
+      task->queued = __atomic_load_n( &instrument, __ATOMIC_RELAXED )
+                   ? PThreadStats::now() : 0;
+      __atomic_add_fetch( &pending, 1, __ATOMIC_SEQ_CST );
+
+      Worker * w = self();
+      if ( w != NULL )
+        w->deque.push(task);
+      else {
+        const unsigned int i =
+          __atomic_fetch_add( &next_inbox, 1u, __ATOMIC_RELAXED );
+        workers[ i % workers.size() ]->post(task);
+      }
+
+      /* wake one parked thread (if any). */
+      if ( __atomic_load_n( &sleeping, __ATOMIC_SEQ_CST ) > 0 ) {
+        pthread_mutex_lock(&park_mutex);
+        pthread_cond_signal(&park_cond);
+        pthread_mutex_unlock(&park_mutex);
+      }
+    }
+
+    /** Move the finished tasks of the caller from finished_tasks to retval
+     * (task_finished_mutex must be held). */
+    inline void takeFinished( const PThreadTaskSet & callers_tasks,
+                              PThreadTaskSet & retval ) {
+      if ( finished_tasks.empty() )
+        return;
+      for ( PThreadTaskSet::const_iterator i = callers_tasks.begin();
+            i != callers_tasks.end(); ++i )
+        if ( finished_tasks.erase(*i) > 0 )
+          retval.insert(retval.end(), *i);
+    }
+
+    /** Execute a task that w took with findTask. */
+    inline void run( Worker * w, PThreadTask * task ) {
+      const int level = __atomic_load_n( &instrument, __ATOMIC_RELAXED );
+      const PThreadStats::Source source = w->source;
+      const long long queued = task->queued;
+      const std::type_info * type =
+        level >= PThreadStats::TRACE ? &typeid(*task) : NULL;
+      const long long b = level ? PThreadStats::now() : 0;
+
+      __atomic_add_fetch( &active_threads, 1, __ATOMIC_RELAXED );
+      task->exec();
+      __atomic_sub_fetch( &active_threads, 1, __ATOMIC_RELAXED );
+
+      if ( level ) {
+        ++w->stats.found[source];
+        w->stats.task( level, source, queued, b, PThreadStats::now(), type );
+      }
+      signalTaskFinished(task);
+    }
+
+    /** Executes all tasks placed in the task queues. */
+    static void * taskSlave(void * arg) {
+      Worker * w = static_cast<Worker*>(arg);
+      PThreadCache * cache = w->cache;
+      pthread_setspecific(cache->worker_key, w);
+
       /* check queue, if we get NULL back, that means that we were
        * requested to terminate. */
       PThreadTask * task;
-      while ((task = cache->getTask()) != NULL) {
-        cache->incrementActiveThreads(); /* inc active    */
-        task->exec();                    /* execute task. */
-        cache->decrementActiveThreads(); /* dec active    */
-        cache->signalTaskFinished(task); /* signal finish */
-      }
+      while ((task = cache->getTask(w)) != NULL)
+        cache->run(w, task);
+      return NULL;
     }
 
-    /** Increment the active threads counter--this should only ever be called by
-     * the taskSlave function. */
-    void incrementActiveThreads() {
-      pthread_spin_lock(&max_threads_spinlock);
-      ++active_threads;
-      pthread_spin_unlock(&max_threads_spinlock);
-    }
+    void init( const int & mxth, const ThreadPlacement & p ) {
+      max_threads = 0;
+      active_threads = pending = sleeping = n_waiting = 0;
+      slavesQuit = false;
+      next_inbox = 0;
+      instrument = PThreadStats::NONE;
+      epoch = PThreadStats::now();
+
+      pthread_attr_init(&pthread_attr);
+      pthread_mutex_init(&config_mutex, NULL);
+      pthread_mutex_init(&park_mutex, NULL);
+      pthread_mutex_init(&task_finished_mutex,NULL);
+      pthread_cond_init(&park_cond, NULL);
+      pthread_cond_init(&task_finished_cond, NULL);
+      pthread_key_create(&worker_key, NULL);
+      placement = p;
 
-    /** Decrement the active threads counter--this should only ever be called by
-     * the taskSlave function. */
-    void decrementActiveThreads() {
-      pthread_spin_lock(&max_threads_spinlock);
-      --active_threads;
-      pthread_spin_unlock(&max_threads_spinlock);
+      /* call this function to set up each of the threads. */
+      set_max_threads(mxth);
     }
 
+    /** Create max_threads threads (if more than one), placed according to
+     * placement (config_mutex must be held). */
+    void startThreads() {
+      /* only create new threads IF more than one are requested. 
+       * If there is only one thread, the tasks will be executed serially at
+       * the point of addTask(). */
+      if ( max_threads <= 1 )
+        return;
+
+      /* all of the queues must exist before any thread starts stealing. */
+      const CpuTopology & topology = CpuTopology::system();
+      const std::vector<int> cpus = placement.assign(max_threads, topology);
+      for (int i = 0; i < max_threads; i++) {
+        workers.push_back( new Worker(this, i) );
+        workers[i]->cpu = cpus[i];
+        workers[i]->node = cpus[i] >= 0 ? topology.node_of(cpus[i]) : -1;
+      }
+
+      for (int i = 0; i < max_threads; i++)
+        for (int j = 0; j < max_threads; j++) {
+          if ( i == j )
+            continue;
+          if ( workers[i]->node == workers[j]->node )
+            workers[i]->local.push_back(workers[j]);
+          else
+            workers[i]->remote.push_back(workers[j]);
+        }
+
+      for (int i = 0; i < max_threads; i++) {
+        Worker * w = workers[i];
+        bool pinned = false;
+        if ( w->cpu >= 0 ) {
+          pthread_attr_t attr;
+          pthread_attr_init(&attr);
+          pinned = detail::set_affinity( &attr, std::vector<int>(1, w->cpu) ) &&
+                   pthread_create(&w->thread, &attr, taskSlave, w) == 0;
+          pthread_attr_destroy(&attr);
+        }
+
+        if ( !pinned ) {
+          /* such as a CPU that we may not use or no affinity support. */
+          w->cpu = w->node = -1;
+          pthread_create(&w->thread, &pthread_attr, taskSlave, w);
+        }
+      }
+    }
 
+    /** Stop and join the threads.
+     * @return the tasks that were still queued.
+     */
+    std::vector<PThreadTask *> stopThreads() {
+      std::vector<PThreadTask *> left;
+      if ( workers.empty() )
+        return left;
+
+      pthread_mutex_lock(&park_mutex);
+      __atomic_store_n( &slavesQuit, true, __ATOMIC_RELEASE );
+      /* the only broadcast to the parked threads. */
+      pthread_cond_broadcast(&park_cond);
+      pthread_mutex_unlock(&park_mutex);
+
+      for (unsigned int i = 0; i < workers.size(); ++i)
+        pthread_join(workers[i]->thread, NULL);
+
+      for (unsigned int i = 0; i < workers.size(); ++i) {
+        PThreadTask * task;
+        while ( (task = workers[i]->deque.steal()) != NULL )
+          left.push_back(task);
+        while ( (task = workers[i]->takeInbox()) != NULL )
+          left.push_back(task);
+        delete workers[i];
+      }
+      workers.clear();
 
+      __atomic_store_n( &pending, 0, __ATOMIC_SEQ_CST );
+      __atomic_store_n( &slavesQuit, false, __ATOMIC_RELEASE );
+      return left;
+    }
 
 
   public:
@@ -170,21 +621,11 @@ namespace olson_tools {
      * NUM_PTHREADS.  If this variable is not set, then the default will be to
      * NOT create any threads for executing tasks given this this cache
      * manager.
+     *
+     * The placement of the threads is read from the environment variable
+     * PTHREAD_AFFINITY (see ThreadPlacement::parse; default none).
      */
-    PThreadCache() : max_threads(0),
-                     active_threads(0),
-                     threads(NULL),
-                     task_queue(),
-                     finished_tasks() {
-      pthread_attr_init(&pthread_attr);
-      pthread_mutex_init(&task_queue_mutex, NULL);
-      pthread_mutex_init(&task_finished_mutex,NULL);
-      pthread_spin_init(&max_threads_spinlock,0);
-      pthread_cond_init(&task_ready_cond, NULL);
-      pthread_cond_init(&task_finished_cond, NULL);
-
-      slavesQuit = false;
-
+    PThreadCache() {
       char * max_thread_str = getenv("NUM_PTHREADS");
       int mxth = 1;
 
@@ -195,8 +636,21 @@ namespace olson_tools {
         mxth = 1;
       }
 
-      /* call this function to set up each of the threads. */
-      set_max_threads(mxth);
+      const char * affinity = getenv("PTHREAD_AFFINITY");
+      init( mxth, ThreadPlacement::parse( affinity ? affinity : "" ) );
+    }
+
+    /** Copy constructor:  creates a new cache (with its own threads) with the
+     * same number and placement of threads as that. */
+    PThreadCache( const PThreadCache & that ) {
+      init( __atomic_load_n( &that.max_threads, __ATOMIC_ACQUIRE ),
+            that.placement );
+    }
+
+    /** Assignment only copies the number of threads. */
+    PThreadCache & operator= ( const PThreadCache & that ) {
+      set_max_threads( __atomic_load_n( &that.max_threads, __ATOMIC_ACQUIRE ) );
+      return *this;
     }
 
     /** Destructor. */
@@ -204,11 +658,12 @@ namespace olson_tools {
       /* make sure that all threads are dead. */
       set_max_threads(0);
       pthread_attr_destroy(&pthread_attr);
-      pthread_mutex_destroy(&task_queue_mutex);
+      pthread_mutex_destroy(&config_mutex);
+      pthread_mutex_destroy(&park_mutex);
       pthread_mutex_destroy(&task_finished_mutex);
-      pthread_spin_destroy(&max_threads_spinlock);
-      pthread_cond_destroy(&task_ready_cond);
+      pthread_cond_destroy(&park_cond);
       pthread_cond_destroy(&task_finished_cond);
+      pthread_key_delete(worker_key);
     }
 
     /** Add a task to the thread cache task queue.
@@ -219,31 +674,75 @@ namespace olson_tools {
      *   available [Default false].
      */
     void addTask( PThreadTask * task, bool self_if_none_avail = false ) {
-      pthread_spin_lock(&max_threads_spinlock);
-        bool serial = max_threads <= 1 ||
-                      ( self_if_none_avail && 
-                        ( max_threads - active_threads ) == 0 );
-
-        if ( !serial ) {
-          pthread_mutex_lock(&task_queue_mutex);      /* locked queue */
+      task->completion = NULL;
+      queueTask(task, self_if_none_avail);
+    }
 
-          task_queue.push(task);
-          /* now we should probably signal some thread that there is a task
-           * ready for execution. */
-          pthread_cond_signal(&task_ready_cond);
+    /** Add a task whose completion is reported to the given completion
+     * queue (instead of to waitForTasks).
+     * @param self_if_none_avail
+     *   Whether to perform the work by self if no threads are currently
+     *   available [Default false].
+     */
+    void addTask( PThreadTask * task, PThreadCompletion & completion,
+                  bool self_if_none_avail = false ) {
+      task->completion = &completion;
+      completion.added();
+      queueTask(task, self_if_none_avail);
+    }
 
-          pthread_mutex_unlock(&task_queue_mutex);    /* unlocked queue */
+    /** Wait for any one of the tasks of the completion queue.  When called
+     * from one of the threads of this cache, other queued tasks are executed
+     * while waiting.
+     * @return the next finished task, or NULL if there are no outstanding or
+     * finished tasks left in the completion queue.
+     */
+    PThreadTask * waitForAny( PThreadCompletion & completion ) {
+      Worker * w = self();
+      while ( true ) {
+        PThreadTask * task = completion.pop();
+        if ( task != NULL || completion.outstanding() == 0 ) {
+          /* a task may have finished since pop(). */
+          return task ? task : completion.pop();
         }
-      pthread_spin_unlock(&max_threads_spinlock);
 
-      if ( serial ) {
-        task->exec();
-        signalTaskFinished(task);
+        if ( w != NULL ) {
+          PThreadTask * other = findTask(w);
+          if ( other != NULL ) {
+            run(w, other);
+            continue;
+          }
+          completion.wait(1000000);
+        } else
+          completion.wait();
+      }
+    }
+
+    /** Wait until all of the tasks of the completion queue have finished.
+     * The finished tasks remain in the queue (see PThreadCompletion::pop).
+     */
+    void waitForAll( PThreadCompletion & completion ) {
+      Worker * w = self();
+      while ( completion.outstanding() > 0 ) {
+        if ( w != NULL ) {
+          PThreadTask * other = findTask(w);
+          if ( other != NULL ) {
+            run(w, other);
+            continue;
+          }
+          completion.wait(1000000);
+        } else
+          completion.wait();
       }
     }
 
     /** This function waits for some tasks to finish, if there are any
      * executing, and then returns the particular task(s) that finished.
+     * When called from one of the threads of this cache, other queued tasks
+     * are executed while waiting.
+     *
+     * This costs O(|callers_tasks| log |finished|) per call; owners of many
+     * tasks should use a PThreadCompletion instead.
      *
      * NOTE:  If the tasks in callers_tasks are not actually executing or
      * queued to execute, then this function could cause indefinite deadlock.
@@ -251,99 +750,214 @@ namespace olson_tools {
     inline PThreadTaskSet waitForTasks(const PThreadTaskSet & callers_tasks) {
       /* Only return once one of the callers tasks have actually completed. */
       PThreadTaskSet retval;
+      Worker * w = self();
 
       pthread_mutex_lock(&task_finished_mutex);
 
       /* The order of the following is to avoid race condtions with the
        * pthread_cond_broadcast/wait commands. */
       do {
-        /* Find all finished tasks that the caller owns. */
-        std::set_intersection(callers_tasks.begin(), callers_tasks.end(),
-                              finished_tasks.begin(), finished_tasks.end(),
-                              inserter(retval, retval.begin()));
+        /* Take all finished tasks that the caller owns. */
+        takeFinished(callers_tasks, retval);
 
         if (retval.size() != 0) break;
 
-        pthread_cond_wait(&task_finished_cond, &task_finished_mutex);
-      } while (true);
+        if ( w != NULL ) {
+          /* help instead of blocking this thread. */
+          pthread_mutex_unlock(&task_finished_mutex);
+          PThreadTask * task = findTask(w);
+          if ( task != NULL )
+            run(w, task);
+          pthread_mutex_lock(&task_finished_mutex);
+          if ( task != NULL )
+            continue;
+
+          takeFinished(callers_tasks, retval);
+          if (retval.size() != 0) break;
+        }
 
-      /* We have successfully finished one of the callers tasks.  
-       * Now make sure that we remove the finished tasks from the
-       * finished_tasks set.  We'll use the set operations to do this. */
-      PThreadTaskSet tmp;
-      std::set_difference(finished_tasks.begin(), finished_tasks.end(),
-                          callers_tasks.begin(), callers_tasks.end(),
-                          inserter(tmp, tmp.begin()));
-      finished_tasks.swap(tmp);
+        ++n_waiting;
+        if ( w != NULL ) {
+          /* look for new work again after a little while (tasks added
+           * while we are blocked do not wake us). */
+          struct timespec t;
+          clock_gettime(CLOCK_REALTIME, &t);
+          t.tv_nsec += 1000000;
+          if ( t.tv_nsec >= 1000000000 ) {
+            t.tv_nsec -= 1000000000;
+            ++t.tv_sec;
+          }
+          pthread_cond_timedwait(&task_finished_cond, &task_finished_mutex, &t);
+        } else
+          pthread_cond_wait(&task_finished_cond, &task_finished_mutex);
+        --n_waiting;
+      } while (true);
 
       pthread_mutex_unlock(&task_finished_mutex);
 
       return retval;
     }
 
-    /** Change/Set the number of threads used to execute tasks. */
+    /** Change/Set the number of threads used to execute tasks.  Tasks that
+     * are still queued when the threads are stopped are queued again (or
+     * executed right away if there will be only one thread). */
     inline int set_max_threads(int mx) {
-      pthread_spin_lock(&max_threads_spinlock);
+      pthread_mutex_lock(&config_mutex);
 
+      mx = mx > 1 ? mx : 1;
+      std::vector<PThreadTask *> left;
       if( max_threads != mx ) {
-        if(max_threads > 1) {
-          /* we previously set up threads, so lets tell them to stop. */
-          signalSlavesQuit();
+        /* we previously set up threads, so lets tell them to stop. */
+        left = stopThreads();
 
-          /* join each of the threads. */
-          for (int i = 0; i < max_threads; i++) {
-            pthread_join(threads[i],NULL);
-          }
-
-          resetSlavesQuit();
-
-          /* free up the old list of thread ids. */
-          delete[]threads;
-          threads = NULL;
-        }/* if we have to join some threads */
-
-        max_threads = mx > 1 ? mx : 1;
+        __atomic_store_n( &max_threads, mx, __ATOMIC_RELEASE );
 
         /* only create new threads IF more than one are requested. 
          * If there is only one thread, the tasks will be executed serially at
          * the point of addTask(). */
-        if(max_threads > 1) {
-          /* we are instructed to prepare for threaded processing. */
-          threads = new pthread_t[max_threads];
-
-          for (int i = 0; i < max_threads; i++) {
-            pthread_create(&threads[i], &pthread_attr, (void*(*)(void*))taskSlave, this);
-          }
-        }/* if more than one thread requested */
+        startThreads();
       }/* if the request is a change */
 
-      mx = max_threads;
-      pthread_spin_unlock(&max_threads_spinlock);
+      pthread_mutex_unlock(&config_mutex);
+
+      /* requeue (keeping the completion queue of each task). */
+      for (unsigned int i = 0; i < left.size(); ++i)
+        queueTask(left[i], false);
       return mx;
     }
 
+    /** Pin the threads to CPUs according to the given placement (the
+     * threads are restarted).  The threads on the same NUMA node steal from
+     * each other before they steal from the threads of other nodes.  Where
+     * the placement is not possible (such as a CPU that may not be used or no
+     * affinity support), the threads are not pinned.
+     */
+    inline void set_placement( const ThreadPlacement & p ) {
+      pthread_mutex_lock(&config_mutex);
+      placement = p;
+      std::vector<PThreadTask *> left = stopThreads();
+      startThreads();
+      pthread_mutex_unlock(&config_mutex);
+
+      /* requeue (keeping the completion queue of each task). */
+      for (unsigned int i = 0; i < left.size(); ++i)
+        queueTask(left[i], false);
+    }
+
+    /** Get the placement of the threads. */
+    inline ThreadPlacement get_placement() {
+      pthread_mutex_lock(&config_mutex);
+      ThreadPlacement p = placement;
+      pthread_mutex_unlock(&config_mutex);
+      return p;
+    }
+
+    /** The CPU of each thread (-1 for not pinned). */
+    inline std::vector<int> get_thread_cpus() {
+      pthread_mutex_lock(&config_mutex);
+      std::vector<int> cpus;
+      for (unsigned int i = 0; i < workers.size(); ++i)
+        cpus.push_back( workers[i]->cpu );
+      pthread_mutex_unlock(&config_mutex);
+      return cpus;
+    }
+
+    /** The NUMA node of each thread (-1 for not pinned). */
+    inline std::vector<int> get_thread_nodes() {
+      pthread_mutex_lock(&config_mutex);
+      std::vector<int> nodes;
+      for (unsigned int i = 0; i < workers.size(); ++i)
+        nodes.push_back( workers[i]->node );
+      pthread_mutex_unlock(&config_mutex);
+      return nodes;
+    }
+
+    /** Zero a newly allocated buffer such that its pages are on the nodes of
+     * the threads:  the buffer is divided into equal parts, one for each
+     * thread in order, and part i is placed on the node of thread i (see
+     * olson_tools::first_touch).  This is meant for buffers that are
+     * divided among the threads in the same way, with a compact or explicit
+     * placement.
+     */
+    inline void first_touch( void * p, const size_t & bytes ) {
+      olson_tools::first_touch( p, bytes, get_thread_nodes() );
+    }
+
     /** Get the maximum number of threads that will be used to execute tasks.
      * */
     inline int get_max_threads() {
-      pthread_spin_lock(&max_threads_spinlock);
-      int mx = max_threads;
-      pthread_spin_unlock(&max_threads_spinlock);
-      return mx;
+      return __atomic_load_n( &max_threads, __ATOMIC_ACQUIRE );
     }
 
     /** Get both maximum number of threads that will be used to execute tasks as
      * well as the number of currently active threads.
      * */
     inline std::pair<int,int> get_active_threads() {
-      pthread_spin_lock(&max_threads_spinlock);
-      std::pair<int,int> retval( max_threads, active_threads );
-      pthread_spin_unlock(&max_threads_spinlock);
+      return std::make_pair( __atomic_load_n( &max_threads, __ATOMIC_ACQUIRE ),
+                             __atomic_load_n( &active_threads,
+                                              __ATOMIC_RELAXED ) );
+    }
+
+    /** Set the amount of instrumentation:  PThreadStats::NONE (the
+     * default), COUNTERS or TRACE.  Each thread keeps its own counters (see
+     * PThreadStats); without instrumentation the cost is one relaxed load
+     * per queued and per executed task.  Only the tasks executed by the
+     * threads of the cache are counted (not those that addTask executes
+     * directly).  The statistics are discarded by set_max_threads.
+     */
+    inline void set_instrumentation( const int & level ) {
+      __atomic_store_n( &instrument, level, __ATOMIC_RELAXED );
+    }
+
+    /** Get the PThreadStats::Level of instrumentation. */
+    inline int get_instrumentation() const {
+      return __atomic_load_n( &instrument, __ATOMIC_RELAXED );
+    }
+
+    /** Zero the statistics of all threads.  This (as well as the following
+     * functions) should be called only while the cache is not executing
+     * tasks, such as after waiting for all tasks. */
+    inline void reset_stats() {
+      pthread_mutex_lock(&config_mutex);
+      for (unsigned int i = 0; i < workers.size(); ++i)
+        workers[i]->stats.reset();
+      epoch = PThreadStats::now();
+      pthread_mutex_unlock(&config_mutex);
+    }
+
+    /** A copy of the statistics of each thread. */
+    inline std::vector<PThreadStats> get_stats() {
+      pthread_mutex_lock(&config_mutex);
+      std::vector<PThreadStats> retval;
+      for (unsigned int i = 0; i < workers.size(); ++i)
+        retval.push_back( workers[i]->stats );
+      pthread_mutex_unlock(&config_mutex);
       return retval;
     }
+
+    /** Print a table of the statistics (see print_summary). */
+    inline std::ostream & print_stats( std::ostream & out ) {
+      return print_summary( out, get_stats() );
+    }
+
+    /** Write the timeline (when instrumented with PThreadStats::TRACE) in the
+     * Chrome trace event format (see write_chrome_trace).  The times are
+     * relative to the last reset_stats() (or the creation of the cache). */
+    inline std::ostream & write_trace( std::ostream & out ) {
+      return write_chrome_trace( out, get_stats(), epoch );
+    }
   };
 
-  /** The default thread cache. */
-  static PThreadCache pthreadCache;
+  /** The default thread cache.  This is one instance for the whole program
+   * (not one per translation unit), so that everything that uses the default
+   * cache shares the same threads. */
+  inline PThreadCache & default_pthread_cache() {
+    static PThreadCache cache;
+    return cache;
+  }
+
+  /** The default thread cache (see default_pthread_cache()). */
+  static PThreadCache & pthreadCache = default_pthread_cache();
 
   /** A function to satisfy OpenMP/PThread mixed code. */
   static inline int get_max_threads() {
@@ -38,6 +38,9 @@
 
 #include <olson-tools/PThreadCache.h>
 
+#include <vector>
+#include <new>
+
 namespace olson_tools {
 
   struct DefaultPThreadFunctor {
@@ -47,12 +50,19 @@ namespace olson_tools {
 
   /** Creates merit evaluation tasks that are then executed by
    * the default thread cache (or another if the option is given).
+   *
+   * The tasks (with the functors stored inline) are kept in blocks owned by
+   * the evaluator, and finished tasks are put on a free list to be reused
+   * by the next eval(...), as in memory.h.  Because only the owner of the
+   * evaluator allocates and releases the tasks, no lock is needed; an
+   * evaluator should therefore be used (eval and joinAll) by one thread at a
+   * time.  Keeping an evaluator for repeated evaluations (such as every
+   * generation) avoids all allocation after the first.
    */
   template < typename Functor >
   class PThreadEval {
     /* TYPEDEFS */
   private:
-    typedef olson_tools::PThreadTaskSet PThreadTaskSet;
     typedef olson_tools::PThreadTask PThreadTask;
 
     /** Task for the PThread cache manager. */
@@ -76,30 +86,19 @@ namespace olson_tools {
       }
     };
 
-    /** Functor to sum up total leaves generated by a list of finished tasks. */
-    template < typename Gatherer >
-    struct deleteTasks : public std::unary_function<PThreadTask *, void> {
-      /* MEMBER STORAGE */
-      Gatherer & g;
-
-      /* MEMBER FUNCTIONS */
-      /** Constructor specifies a reference to the gatherer. */
-      deleteTasks( Gatherer & g ) : g(g) { }
-
-      /** Functor operation. */
-      void operator() (PThreadTask * t) {
-        /* Execute the user's gather code. */
-        static_cast<PThreadEvalTask*>(t)->f.accept(g);
-
-        /* we finally delete the actual memory of the task. */
-        delete t;
-      }
+    /** An unused task slot. */
+    struct FreeSlot {
+      FreeSlot * next;
     };
 
+    /** The number of tasks in the first and the largest blocks. */
+    static const unsigned int min_block = 16;
+    static const unsigned int max_block = 4096;
+
     /** No-Op task gatherer. */
     struct NoOpGather {
       template < typename T >
-      void update( const T & t ) { }
+      void update( const T & /*t*/ ) { }
     };
 
 
@@ -110,8 +109,50 @@ namespace olson_tools {
     /** The cache manager to use. */
     PThreadCache & cache;
 
-    /** The tasks to evaluate. */
-    PThreadTaskSet tasks;
+    /** The completion queue of the tasks. */
+    PThreadCompletion completion;
+
+    /** The storage of the tasks. */
+    std::vector<void *> blocks;
+    FreeSlot * free_slots;
+    unsigned int n_slots;
+
+    /* not copyable. */
+    PThreadEval( const PThreadEval & );
+    PThreadEval & operator= ( const PThreadEval & );
+
+    /** Add a block of n slots to the free list. */
+    void grow( const unsigned int & n ) {
+      char * b =
+        static_cast<char*>( ::operator new( n * sizeof(PThreadEvalTask) ) );
+      blocks.push_back(b);
+      for ( unsigned int i = n; i > 0; --i ) {
+        FreeSlot * slot =
+          reinterpret_cast<FreeSlot*>( b + (i-1) * sizeof(PThreadEvalTask) );
+        slot->next = free_slots;
+        free_slots = slot;
+      }
+      n_slots += n;
+    }
+
+    inline void * allocate() {
+      if ( free_slots == NULL ) {
+        /* double the storage (within limits). */
+        unsigned int n = n_slots;
+        if ( n < min_block )      n = min_block;
+        else if ( n > max_block ) n = max_block;
+        grow(n);
+      }
+      FreeSlot * slot = free_slots;
+      free_slots = slot->next;
+      return slot;
+    }
+
+    inline void release( void * p ) {
+      FreeSlot * slot = static_cast<FreeSlot*>(p);
+      slot->next = free_slots;
+      free_slots = slot;
+    }
 
 
 
@@ -122,21 +163,43 @@ namespace olson_tools {
      *    Specify the cache instance to use [default olson_tools::pthreadCache].
      */
     PThreadEval( PThreadCache & cache = olson_tools::pthreadCache )
-      : cache(cache) { }
+      : cache(cache), free_slots(NULL), n_slots(0) { }
+
+    /** Destructor:  waits for any outstanding tasks. */
+    ~PThreadEval() {
+      joinAll();
+      for ( unsigned int i = 0; i < blocks.size(); ++i )
+        ::operator delete( blocks[i] );
+    }
+
+    /** Make room for (at least) n tasks in total. */
+    void reserve( const unsigned int & n ) {
+      if ( n > n_slots )
+        grow( n - n_slots );
+    }
+
+    /** The number of tasks for which there is room. */
+    unsigned int capacity() const { return n_slots; }
 
     /** Task scatterer.  */
     inline void eval( const Functor & f, bool self_if_none_avail = false ) {
-      /* first wait for a thread to become available */
-      PThreadTask * task = new PThreadEvalTask( f );
-      tasks.insert(task);
-      cache.addTask( task, self_if_none_avail );
+      void * slot = allocate();
+      PThreadTask * task;
+      try {
+        task = new (slot) PThreadEvalTask( f );
+      } catch (...) {
+        release(slot);
+        throw;
+      }
+      cache.addTask( task, completion, self_if_none_avail );
     }
 
     /** Task gatherer.  This function makes sure that all of this
      * instance's tasks are completed before returning.
      */
     inline void joinAll() {
-      joinAll( NoOpGather() );
+      NoOpGather g;
+      joinAll( g );
     }
 
     /** Task gatherer.  This function makes sure that all of this
@@ -144,19 +207,16 @@ namespace olson_tools {
      */
     template < typename Gatherer >
     inline void joinAll( Gatherer & g ) {
-      while (tasks.size() > 0) {
-        PThreadTaskSet finished = cache.waitForTasks(tasks);
+      PThreadTask * t;
+      while ( (t = cache.waitForAny(completion)) != NULL ) {
+        PThreadEvalTask * task = static_cast<PThreadEvalTask*>(t);
 
         /* Allow the user to do something with the task results. */
-        for_each( finished.begin(), finished.end(), deleteTasks<Gatherer>(g) );
-
-        /* Now make sure that we remove the finished tasks from the
-         * tasks set.  We'll use the set operations to do this. */
-        PThreadTaskSet tmp;
-        std::set_difference( tasks.begin(), tasks.end(),
-                             finished.begin(), finished.end(),
-                             inserter(tmp, tmp.begin()) );
-        tasks.swap(tmp);
+        task->f.accept(g);
+
+        /* return the task to the free list. */
+        task->~PThreadEvalTask();
+        release(task);
       }
     }
   };
@@ -0,0 +1,283 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * Per-thread statistics (and an optional timeline) of the tasks executed by
+ * a PThreadCache.
+ *
+ * */
+
+#ifndef olson_tools_PThreadStats_h
+#define olson_tools_PThreadStats_h
+
+#include <time.h>
+
+#include <ostream>
+#include <iomanip>
+#include <typeinfo>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#if defined(__GNUC__)
+#  include <cxxabi.h>
+#endif
+
+namespace olson_tools {
+
+  /** The counters of one thread of a PThreadCache.  Each thread only writes
+   * its own instance (no shared atomics), so the numbers should only be read
+   * while the cache is not executing tasks.
+   *
+   * Times are in nanoseconds.  The execution time of a task includes the
+   * time of the tasks that its thread executed while the task waited for its
+   * own sub-tasks.
+   */
+  struct PThreadStats {
+    /* TYPEDEFS */
+    /** The amount of instrumentation (see PThreadCache::set_instrumentation).
+     * */
+    enum Level {
+      /** No instrumentation (the default). */
+      NONE = 0,
+      /** Only the counters. */
+      COUNTERS = 1,
+      /** The counters as well as an event for each task and idle period. */
+      TRACE = 2
+    };
+
+    /** How the task was found. */
+    enum Source { OWN = 0, INBOX = 1, STOLEN = 2 };
+
+    /** One task (type != NULL) or idle period (type == NULL) of the
+     * timeline. */
+    struct Event {
+      long long begin;
+      long long duration;
+      long long queue_wait;
+      const std::type_info * type;
+      int source;
+    };
+
+    /** The most events that are kept per thread. */
+    static const unsigned int max_events = 1u << 20;
+
+    /** Idle periods shorter than this are not added to the timeline. */
+    static const long long min_idle_event = 1000;
+
+
+    /* MEMBER STORAGE */
+    /** The number of tasks executed. */
+    long tasks;
+
+    /** The number of tasks taken from each Source. */
+    long found[3];
+
+    /** The number of times the thread parked for lack of work. */
+    long parks;
+
+    /** The total execution time of the tasks. */
+    long long exec;
+
+    /** The total and the longest time from queuing a task to its start. */
+    long long queue_wait, max_queue_wait;
+
+    /** The total time spent looking for (or waiting for) work. */
+    long long idle;
+
+    /** The timeline (only with TRACE). */
+    std::vector<Event> events;
+
+    /** The number of events not kept because of max_events. */
+    long dropped;
+
+
+    /* MEMBER FUNCTIONS */
+    PThreadStats() { reset(); }
+
+    void reset() {
+      tasks = parks = dropped = 0;
+      found[OWN] = found[INBOX] = found[STOLEN] = 0;
+      exec = queue_wait = max_queue_wait = idle = 0;
+      events.clear();
+    }
+
+    /** The current time (CLOCK_MONOTONIC) in nanoseconds. */
+    static long long now() {
+      struct timespec t;
+      clock_gettime(CLOCK_MONOTONIC, &t);
+      return t.tv_sec * 1000000000LL + t.tv_nsec;
+    }
+
+    /** Record a task that was queued at queued and executed in [b, e). */
+    void task( const int & level, const PThreadStats::Source & source,
+               const long long & queued, const long long & b,
+               const long long & e, const std::type_info * type ) {
+      const long long wait = queued > 0 && b > queued ? b - queued : 0;
+      ++tasks;
+      exec += e - b;
+      queue_wait += wait;
+      if ( wait > max_queue_wait )
+        max_queue_wait = wait;
+      if ( level >= TRACE ) {
+        Event ev = { b, e - b, wait, type, source };
+        add(ev);
+      }
+    }
+
+    /** Record the idle period [b, e). */
+    void idled( const int & level, const long long & b, const long long & e ) {
+      idle += e - b;
+      if ( level >= TRACE && e - b >= min_idle_event ) {
+        Event ev = { b, e - b, 0, NULL, 0 };
+        add(ev);
+      }
+    }
+
+    /** The fraction of the (non-idle plus idle) time spent executing tasks.
+     * */
+    double busy() const {
+      return exec + idle > 0 ? double(exec) / double(exec + idle) : 0.0;
+    }
+
+  private:
+    void add( const Event & ev ) {
+      if ( events.size() < max_events )
+        events.push_back(ev);
+      else
+        ++dropped;
+    }
+  };
+
+  namespace detail {
+    /** The readable name of a task type. */
+    inline std::string type_name( const std::type_info * type ) {
+      if ( type == NULL )
+        return "idle";
+      std::string name = type->name();
+#if defined(__GNUC__)
+      int status = 0;
+      char * d = abi::__cxa_demangle( name.c_str(), NULL, NULL, &status );
+      if ( d ) {
+        if ( status == 0 )
+          name = d;
+        std::free(d);
+      }
+#endif
+      /* (names go into JSON strings.) */
+      for ( std::string::iterator i = name.begin(); i != name.end(); ++i )
+        if ( *i == '"' || *i == '\\' )
+          *i = '\'';
+      return name;
+    }
+  }/* namespace detail */
+
+  /** Print a table of the counters of each thread (times in milliseconds
+   * except for the queue waits, which are in microseconds). */
+  inline std::ostream & print_summary( std::ostream & out,
+                                       const std::vector<PThreadStats> & s ) {
+    PThreadStats total;
+    const std::streamsize precision = out.precision();
+    out << "thread     tasks       own     inbox    stolen     parks"
+           "     exec_ms  wait_avg_us  wait_max_us     idle_ms  busy\n";
+    for ( unsigned int i = 0; i <= s.size(); ++i ) {
+      const PThreadStats & t = i < s.size() ? s[i] : total;
+      if ( i < s.size() ) {
+        total.tasks += t.tasks;
+        for ( int j = 0; j < 3; ++j )
+          total.found[j] += t.found[j];
+        total.parks += t.parks;
+        total.exec += t.exec;
+        total.queue_wait += t.queue_wait;
+        if ( t.max_queue_wait > total.max_queue_wait )
+          total.max_queue_wait = t.max_queue_wait;
+        total.idle += t.idle;
+        out << std::setw(6) << i;
+      } else
+        out << " total";
+
+      out << std::setw(10) << t.tasks
+          << std::setw(10) << t.found[PThreadStats::OWN]
+          << std::setw(10) << t.found[PThreadStats::INBOX]
+          << std::setw(10) << t.found[PThreadStats::STOLEN]
+          << std::setw(10) << t.parks
+          << std::fixed << std::setprecision(3)
+          << std::setw(12) << t.exec * 1e-6
+          << std::setw(13)
+          << ( t.tasks > 0 ? t.queue_wait * 1e-3 / t.tasks : 0.0 )
+          << std::setw(13) << t.max_queue_wait * 1e-3
+          << std::setw(12) << t.idle * 1e-6
+          << std::setprecision(2)
+          << std::setw(6) << t.busy()
+          << '\n';
+    }
+    out.unsetf(std::ios::floatfield);
+    out.precision(precision);
+    return out;
+  }
+
+  /** Write the events of each thread in the Chrome trace event format (load
+   * with chrome://tracing or https://ui.perfetto.dev).
+   * @param epoch
+   *    The time (PThreadStats::now()) to use as zero.
+   */
+  inline std::ostream & write_chrome_trace( std::ostream & out,
+                                            const std::vector<PThreadStats> & s,
+                                            const long long & epoch = 0 ) {
+    static const char * source[] = { "own", "inbox", "stolen" };
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char * sep = "\n";
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    for ( unsigned int i = 0; i < s.size(); ++i ) {
+      out << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                    "\"tid\":" << i << ",\"args\":{\"name\":\"thread " << i
+          << "\"}}";
+      sep = ",\n";
+      for ( unsigned int j = 0; j < s[i].events.size(); ++j ) {
+        const PThreadStats::Event & ev = s[i].events[j];
+        out << sep << "{\"name\":\"" << detail::type_name(ev.type) << "\","
+               "\"cat\":\"" << (ev.type ? "task" : "idle") << "\","
+               "\"ph\":\"X\",\"pid\":0,\"tid\":" << i
+            << ",\"ts\":" << (ev.begin - epoch) * 1e-3
+            << ",\"dur\":" << ev.duration * 1e-3;
+        if ( ev.type )
+          out << ",\"args\":{\"queue_wait_us\":" << ev.queue_wait * 1e-3
+              << ",\"source\":\"" << source[ev.source] << "\"}";
+        out << '}';
+      }
+    }
+    out << "\n]}\n";
+    out.unsetf(std::ios::floatfield);
+    out.precision(precision);
+    return out;
+  }
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_PThreadStats_h
@@ -62,11 +62,14 @@
 
 #include <olson-tools/Vector.h>
 #include <olson-tools/power.h>
+#include <olson-tools/ompexcept.h>
 
 
 #include <limits>
 #include <sstream>
 #include <ostream>
+#include <stdexcept>
+#include <iostream>
 
 #include <cmath>
 #include <cstring>
@@ -429,6 +432,195 @@ namespace olson_tools {
     return retval;
   }
 
+  /* **** BEGIN LINEAR ALGEBRA **** { */
+
+  /** LU decomposition (Doolittle, with partial pivoting) of a SquareMatrix.
+   * On return, A holds both L (strictly below the diagonal, unit diagonal
+   * implied) and U (on and above the diagonal) of P*A = L*U.  The loops all
+   * have compile-time bounds, so for small L the compiler fully unrolls them.
+   *
+   * @param A
+   *    The matrix to decompose (in place).
+   * @param perm
+   *    Output row permutation:  row i of P*A is row perm[i] of A.
+   *
+   * @return The sign of the permutation (+1 or -1), or 0 if A is singular.
+   */
+  template <class T, unsigned int L>
+  inline int lu_decompose( SquareMatrix<T,L> & A, unsigned int perm[L] ) {
+    int sign = 1;
+    for (unsigned int i = 0; i < L; ++i) perm[i] = i;
+
+    for (unsigned int k = 0; k < L; ++k) {
+      /* find the pivot. */
+      unsigned int p = k;
+      T pmax = std::abs(A.val[k][k]);
+      for (unsigned int i = k+1; i < L; ++i) {
+        if ( std::abs(A.val[i][k]) > pmax ) {
+          pmax = std::abs(A.val[i][k]);
+          p = i;
+        }
+      }
+
+      if ( pmax == T(0) )
+        return 0;
+
+      if ( p != k ) {
+        for (unsigned int j = 0; j < L; ++j)
+          std::swap( A.val[k][j], A.val[p][j] );
+        std::swap( perm[k], perm[p] );
+        sign = -sign;
+      }
+
+      const T inv_pivot = T(1) / A.val[k][k];
+      for (unsigned int i = k+1; i < L; ++i) {
+        const T f = ( A.val[i][k] *= inv_pivot );
+        for (unsigned int j = k+1; j < L; ++j)
+          A.val[i][j] -= f * A.val[k][j];
+      }
+    }
+
+    return sign;
+  }
+
+  /** Solve A*x = b given the LU decomposition of A from lu_decompose.
+   * @param LU
+   *    The output matrix of lu_decompose.
+   * @param perm
+   *    The output permutation of lu_decompose.
+   * @param b
+   *    The right hand side.
+   * @return x.
+   */
+  template <class T, unsigned int L>
+  inline Vector<T,L> lu_solve( const SquareMatrix<T,L> & LU,
+                               const unsigned int perm[L],
+                               const Vector<T,L> & b ) {
+    Vector<T,L> x;
+    /* forward substitution (L has a unit diagonal) */
+    for (unsigned int i = 0; i < L; ++i) {
+      T xi = b[perm[i]];
+      for (unsigned int j = 0; j < i; ++j)
+        xi -= LU.val[i][j] * x[j];
+      x[i] = xi;
+    }
+
+    /* back substitution */
+    for (int i = L-1; i >= 0; --i) {
+      T xi = x[i];
+      for (unsigned int j = i+1; j < L; ++j)
+        xi -= LU.val[i][j] * x[j];
+      x[i] = xi / LU.val[i][i];
+    }
+    return x;
+  }
+
+  /** Determinant of a SquareMatrix (computed via LU decomposition). */
+  template <class T, unsigned int L>
+  inline T det( const SquareMatrix<T,L> & m ) {
+    SquareMatrix<T,L> LU(m);
+    unsigned int perm[L];
+    T retval = lu_decompose(LU, perm);
+    for (unsigned int i = 0; i < L; ++i)
+      retval *= LU.val[i][i];
+    return retval;
+  }
+
+  /** Determinant of a 2x2 SquareMatrix. */
+  template <class T>
+  inline T det( const SquareMatrix<T,2u> & m ) {
+    return m.val[0][0]*m.val[1][1] - m.val[0][1]*m.val[1][0];
+  }
+
+  /** Determinant of a 3x3 SquareMatrix. */
+  template <class T>
+  inline T det( const SquareMatrix<T,3u> & m ) {
+    return m.val[0][0] * (m.val[1][1]*m.val[2][2] - m.val[1][2]*m.val[2][1])
+         - m.val[0][1] * (m.val[1][0]*m.val[2][2] - m.val[1][2]*m.val[2][0])
+         + m.val[0][2] * (m.val[1][0]*m.val[2][1] - m.val[1][1]*m.val[2][0]);
+  }
+
+  /** Inverse of a SquareMatrix (computed via LU decomposition).
+   * @throws std::runtime_error if m is singular.
+   */
+  template <class T, unsigned int L>
+  inline SquareMatrix<T,L> inverse( const SquareMatrix<T,L> & m ) {
+    SquareMatrix<T,L> LU(m);
+    unsigned int perm[L];
+    if ( lu_decompose(LU, perm) == 0 )
+      THROW(std::runtime_error,"SquareMatrix::inverse:  singular matrix");
+
+    SquareMatrix<T,L> retval;
+    for (unsigned int j = 0; j < L; ++j) {
+      Vector<T,L> e(T(0));
+      e[j] = T(1);
+      const Vector<T,L> col = lu_solve(LU, perm, e);
+      for (unsigned int i = 0; i < L; ++i)
+        retval.val[i][j] = col[i];
+    }
+    return retval;
+  }
+
+  /** Inverse of a 2x2 SquareMatrix.
+   * @throws std::runtime_error if m is singular.
+   */
+  template <class T>
+  inline SquareMatrix<T,2u> inverse( const SquareMatrix<T,2u> & m ) {
+    const T d = det(m);
+    if ( d == T(0) )
+      THROW(std::runtime_error,"SquareMatrix::inverse:  singular matrix");
+    const T id = T(1) / d;
+
+    SquareMatrix<T,2u> retval;
+    retval.val[0][0] =  m.val[1][1] * id;
+    retval.val[0][1] = -m.val[0][1] * id;
+    retval.val[1][0] = -m.val[1][0] * id;
+    retval.val[1][1] =  m.val[0][0] * id;
+    return retval;
+  }
+
+  /** Inverse of a 3x3 SquareMatrix (via the adjugate).
+   * @throws std::runtime_error if m is singular.
+   */
+  template <class T>
+  inline SquareMatrix<T,3u> inverse( const SquareMatrix<T,3u> & m ) {
+    const T (&a)[3][3] = m.val;
+    SquareMatrix<T,3u> retval;
+    T (&r)[3][3] = retval.val;
+    r[0][0] = a[1][1]*a[2][2] - a[1][2]*a[2][1];
+    r[1][0] = a[1][2]*a[2][0] - a[1][0]*a[2][2];
+    r[2][0] = a[1][0]*a[2][1] - a[1][1]*a[2][0];
+
+    const T d = a[0][0]*r[0][0] + a[0][1]*r[1][0] + a[0][2]*r[2][0];
+    if ( d == T(0) )
+      THROW(std::runtime_error,"SquareMatrix::inverse:  singular matrix");
+    const T id = T(1) / d;
+
+    r[0][1] = a[0][2]*a[2][1] - a[0][1]*a[2][2];
+    r[1][1] = a[0][0]*a[2][2] - a[0][2]*a[2][0];
+    r[2][1] = a[0][1]*a[2][0] - a[0][0]*a[2][1];
+    r[0][2] = a[0][1]*a[1][2] - a[0][2]*a[1][1];
+    r[1][2] = a[0][2]*a[1][0] - a[0][0]*a[1][2];
+    r[2][2] = a[0][0]*a[1][1] - a[0][1]*a[1][0];
+
+    retval *= id;
+    return retval;
+  }
+
+  /** Solve A*x = b (via LU decomposition with partial pivoting).
+   * @throws std::runtime_error if A is singular.
+   */
+  template <class T, unsigned int L>
+  inline Vector<T,L> solve( const SquareMatrix<T,L> & A, const Vector<T,L> & b ) {
+    SquareMatrix<T,L> LU(A);
+    unsigned int perm[L];
+    if ( lu_decompose(LU, perm) == 0 )
+      THROW(std::runtime_error,"SquareMatrix::solve:  singular matrix");
+    return lu_solve(LU, perm, b);
+  }
+
+  /* **** END LINEAR ALGEBRA **** } */
+
   /** Define SQR explicitly to be in the inner product of a SquareMatrix with its
    * self.  We define this specialization because the return value is not the
    * same as the arguments. */
@@ -463,4 +655,8 @@ namespace olson_tools {
 
 }/* namespace olson_tools */
 
+#if defined(USE_SIMD_VECTOR) && defined(__SSE2__)
+#  include <olson-tools/simd/SquareMatrix.h>
+#endif
+
 #endif // olson_tools_SquareMatrix_h
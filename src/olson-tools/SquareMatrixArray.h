@@ -0,0 +1,428 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * Batched (structure-of-arrays) SquareMatrix kernels.
+ *
+ * A SquareMatrixArray stores many LxL matrices with each of the L*L matrix
+ * elements in its own contiguous array (see VectorArray).  The kernels in this
+ * file (mult, det, inverse, solve) operate on whole arrays at a time, running
+ * across the matrices rather than within them.  For doubles, and when the
+ * compiler targets SSE2 or better, four matrices are processed per
+ * instruction using the packed-double wrappers of olson-tools/simd/pd.h.
+ *
+ * Example (rotating a whole particle array into another frame):
+ * \verbatim
+      VectorArray<double,3> x(...), xr;
+      SquareMatrix<double,3> R = ...;
+      mult(R, x, xr);
+     \endverbatim
+ *
+ * Copyright 2004-2009 Spencer Olson
+ */
+
+#ifndef olson_tools_SquareMatrixArray_h
+#define olson_tools_SquareMatrixArray_h
+
+#include <olson-tools/SquareMatrix.h>
+#include <olson-tools/VectorArray.h>
+
+#if defined(__SSE2__)
+#  include <olson-tools/simd/pd.h>
+#endif
+
+#include <cstddef>
+#include <cmath>
+
+namespace olson_tools {
+
+  namespace detail {
+    /** Scalar lane:  one matrix per kernel invocation. */
+    template < typename T >
+    struct batch_lane {
+      typedef T type;
+      static const unsigned int width = 1u;
+      static inline T load(const T * p) { return *p; }
+      static inline void store(T * p, const T & v) { *p = v; }
+      static inline T set1(const T & t) { return t; }
+      static inline T sqrt(const T & t) { return std::sqrt(t); }
+    };
+
+    /** The widest lane available for type T. */
+    template < typename T >
+    struct wide_lane {
+      typedef batch_lane<T> type;
+    };
+
+#if defined(__SSE2__)
+    /** Packed-double lane:  four matrices per kernel invocation. */
+    struct pd4_lane {
+      typedef simd::pd4 type;
+      static const unsigned int width = 4u;
+      static inline simd::pd4 load(const double * p) { return simd::load4(p); }
+      static inline void store(double * p, const simd::pd4 & v) { simd::store4(p, v); }
+      static inline simd::pd4 set1(const double & t) { return simd::set1(t); }
+      static inline simd::pd4 sqrt(const simd::pd4 & v) { return simd::sqrt(v); }
+    };
+
+    template <>
+    struct wide_lane<double> {
+      typedef pd4_lane type;
+    };
+#endif
+
+    /** Run kernel.apply<Lane>(i) for all i in [0,n), using the widest lane
+     * for as long as possible. */
+    template < typename T, typename Kernel >
+    inline void batch_apply( const Kernel & kernel, const std::size_t & n ) {
+      typedef typename wide_lane<T>::type W;
+      std::size_t i = 0;
+      for (; i + W::width <= n; i += W::width)
+        kernel.template apply<W>(i);
+      for (; i < n; ++i)
+        kernel.template apply< batch_lane<T> >(i);
+    }
+
+    /** y[i] = A[i] * x[i] */
+    template < typename T, unsigned int L >
+    struct batch_mult_mv {
+      const T * A[L*L];
+      const T * x[L];
+      T * y[L];
+
+      template < typename Lane >
+      inline void apply( const std::size_t & i ) const {
+        typedef typename Lane::type V;
+        V xv[L];
+        for (unsigned int j = 0; j < L; ++j)
+          xv[j] = Lane::load(x[j] + i);
+
+        for (unsigned int r = 0; r < L; ++r) {
+          V s = Lane::load(A[r*L] + i) * xv[0];
+          for (unsigned int c = 1; c < L; ++c)
+            s = s + Lane::load(A[r*L+c] + i) * xv[c];
+          Lane::store(y[r] + i, s);
+        }
+      }
+    };
+
+    /** y[i] = A * x[i] */
+    template < typename T, unsigned int L >
+    struct batch_mult_shared_mv {
+      const SquareMatrix<T,L> * A;
+      const T * x[L];
+      T * y[L];
+
+      template < typename Lane >
+      inline void apply( const std::size_t & i ) const {
+        typedef typename Lane::type V;
+        V xv[L];
+        for (unsigned int j = 0; j < L; ++j)
+          xv[j] = Lane::load(x[j] + i);
+
+        for (unsigned int r = 0; r < L; ++r) {
+          V s = Lane::set1(A->val[r][0]) * xv[0];
+          for (unsigned int c = 1; c < L; ++c)
+            s = s + Lane::set1(A->val[r][c]) * xv[c];
+          Lane::store(y[r] + i, s);
+        }
+      }
+    };
+
+    /** C[i] = A[i] * B[i] */
+    template < typename T, unsigned int L >
+    struct batch_mult_mm {
+      const T * A[L*L];
+      const T * B[L*L];
+      T * C[L*L];
+
+      template < typename Lane >
+      inline void apply( const std::size_t & i ) const {
+        typedef typename Lane::type V;
+        V c[L*L];
+        for (unsigned int r = 0; r < L; ++r) {
+          for (unsigned int col = 0; col < L; ++col) {
+            V s = Lane::load(A[r*L] + i) * Lane::load(B[col] + i);
+            for (unsigned int k = 1; k < L; ++k)
+              s = s + Lane::load(A[r*L+k] + i) * Lane::load(B[k*L+col] + i);
+            c[r*L+col] = s;
+          }
+        }
+        for (unsigned int k = 0; k < L*L; ++k)
+          Lane::store(C[k] + i, c[k]);
+      }
+    };
+
+    /** Cofactors of the first column of a 3x3 matrix (these are also the
+     * first column of the adjugate). */
+    template < typename V >
+    inline void cofactors3_col0( const V a[9], V & c0, V & c1, V & c2 ) {
+      c0 = a[4]*a[8] - a[5]*a[7];
+      c1 = a[5]*a[6] - a[3]*a[8];
+      c2 = a[3]*a[7] - a[4]*a[6];
+    }
+
+    /** d[i] = det(A[i]) (3x3) */
+    template < typename T >
+    struct batch_det3 {
+      const T * A[9];
+      T * d;
+
+      template < typename Lane >
+      inline void apply( const std::size_t & i ) const {
+        typedef typename Lane::type V;
+        V a[9], c0, c1, c2;
+        for (unsigned int k = 0; k < 9u; ++k)
+          a[k] = Lane::load(A[k] + i);
+        cofactors3_col0(a, c0, c1, c2);
+        Lane::store(d + i, a[0]*c0 + a[1]*c1 + a[2]*c2);
+      }
+    };
+
+    /** B[i] = inverse(A[i]) (3x3) */
+    template < typename T >
+    struct batch_inverse3 {
+      const T * A[9];
+      T * B[9];
+
+      template < typename Lane >
+      inline void apply( const std::size_t & i ) const {
+        typedef typename Lane::type V;
+        V a[9], r[9];
+        for (unsigned int k = 0; k < 9u; ++k)
+          a[k] = Lane::load(A[k] + i);
+        cofactors3_col0(a, r[0], r[3], r[6]);
+        const V id = Lane::set1(T(1)) / (a[0]*r[0] + a[1]*r[3] + a[2]*r[6]);
+        r[1] = a[2]*a[7] - a[1]*a[8];
+        r[4] = a[0]*a[8] - a[2]*a[6];
+        r[7] = a[1]*a[6] - a[0]*a[7];
+        r[2] = a[1]*a[5] - a[2]*a[4];
+        r[5] = a[2]*a[3] - a[0]*a[5];
+        r[8] = a[0]*a[4] - a[1]*a[3];
+        for (unsigned int k = 0; k < 9u; ++k)
+          Lane::store(B[k] + i, r[k] * id);
+      }
+    };
+
+    /** x[i] = A[i]^-1 * b[i] (3x3, Cramer's rule via the adjugate) */
+    template < typename T >
+    struct batch_solve3 {
+      const T * A[9];
+      const T * b[3];
+      T * x[3];
+
+      template < typename Lane >
+      inline void apply( const std::size_t & i ) const {
+        typedef typename Lane::type V;
+        V a[9], r[9], bv[3];
+        for (unsigned int k = 0; k < 9u; ++k)
+          a[k] = Lane::load(A[k] + i);
+        for (unsigned int k = 0; k < 3u; ++k)
+          bv[k] = Lane::load(b[k] + i);
+        cofactors3_col0(a, r[0], r[3], r[6]);
+        const V id = Lane::set1(T(1)) / (a[0]*r[0] + a[1]*r[3] + a[2]*r[6]);
+        r[1] = a[2]*a[7] - a[1]*a[8];
+        r[4] = a[0]*a[8] - a[2]*a[6];
+        r[7] = a[1]*a[6] - a[0]*a[7];
+        r[2] = a[1]*a[5] - a[2]*a[4];
+        r[5] = a[2]*a[3] - a[0]*a[5];
+        r[8] = a[0]*a[4] - a[1]*a[3];
+        for (unsigned int k = 0; k < 3u; ++k)
+          Lane::store(x[k] + i, (r[3*k]*bv[0] + r[3*k+1]*bv[1] + r[3*k+2]*bv[2]) * id);
+      }
+    };
+  }/* namespace detail */
+
+
+  /** Structure-of-arrays storage of many SquareMatrix<T,L> values.  The
+   * (i,j) elements of all the matrices are stored contiguously (see
+   * component(i,j)).
+   *
+   * @see VectorArray.
+   */
+  template < typename T, unsigned int L >
+  class SquareMatrixArray : public VectorArray<T,L*L> {
+    /* TYPEDEFS */
+  public:
+    typedef VectorArray<T,L*L> super;
+    typedef typename super::size_type size_type;
+
+    /** The side length of the matrices. */
+    static const unsigned int side_length = L;
+
+
+    /* MEMBER FUNCTIONS */
+  public:
+    /** Default constructor creates an empty array. */
+    SquareMatrixArray() : super() { }
+
+    /** Create an array of n (uninitialized) matrices. */
+    explicit SquareMatrixArray( const size_type & n ) : super(n) { }
+
+    /** Create an array of n matrices, each equal to m. */
+    SquareMatrixArray( const size_type & n, const SquareMatrix<T,L> & m )
+      : super( n, Vector<T,L*L>(&m.val[0][0]) ) { }
+
+    using super::component;
+
+    /** Pointer to the (aligned) array of the (i,j) elements. */
+    inline T * component( const unsigned int & i, const unsigned int & j ) {
+      return super::component(i*L + j);
+    }
+
+    /** Pointer to the (aligned) array of the (i,j) elements--const version.
+     * */
+    inline const T * component( const unsigned int & i,
+                                const unsigned int & j ) const {
+      return super::component(i*L + j);
+    }
+
+    /** Copy out the kth matrix. */
+    inline SquareMatrix<T,L> get( const size_type & k ) const {
+      SquareMatrix<T,L> m;
+      for (unsigned int i = 0; i < L; ++i)
+        for (unsigned int j = 0; j < L; ++j)
+          m.val[i][j] = component(i,j)[k];
+      return m;
+    }
+
+    /** Set the kth matrix. */
+    inline void set( const size_type & k, const SquareMatrix<T,L> & m ) {
+      for (unsigned int i = 0; i < L; ++i)
+        for (unsigned int j = 0; j < L; ++j)
+          component(i,j)[k] = m.val[i][j];
+    }
+
+    /** Append a matrix. */
+    inline void push_back( const SquareMatrix<T,L> & m ) {
+      super::push_back( Vector<T,L*L>(&m.val[0][0]) );
+    }
+  };
+
+
+
+  /* **** BEGIN BATCHED OPERATIONS **** { */
+
+  /** Batched Matrix X Vector multiplication:  y[i] = A[i] * x[i].
+   * y is resized to match; y may be the same array as x. */
+  template < typename T, unsigned int L >
+  inline void mult( const SquareMatrixArray<T,L> & A,
+                    const VectorArray<T,L> & x,
+                          VectorArray<T,L> & y ) {
+    y.resize(x.size());
+    detail::batch_mult_mv<T,L> k;
+    for (unsigned int j = 0; j < L*L; ++j) k.A[j] = A.component(j);
+    for (unsigned int j = 0; j < L; ++j) {
+      k.x[j] = x.component(j);
+      k.y[j] = y.component(j);
+    }
+    detail::batch_apply<T>(k, x.size());
+  }
+
+  /** Batched Matrix X Vector multiplication with a single matrix:
+   * y[i] = A * x[i].  y is resized to match; y may be the same array as x. */
+  template < typename T, unsigned int L >
+  inline void mult( const SquareMatrix<T,L> & A,
+                    const VectorArray<T,L> & x,
+                          VectorArray<T,L> & y ) {
+    y.resize(x.size());
+    detail::batch_mult_shared_mv<T,L> k;
+    k.A = &A;
+    for (unsigned int j = 0; j < L; ++j) {
+      k.x[j] = x.component(j);
+      k.y[j] = y.component(j);
+    }
+    detail::batch_apply<T>(k, x.size());
+  }
+
+  /** Batched Matrix X Matrix multiplication:  C[i] = A[i] * B[i].
+   * C is resized to match; C may be the same array as A or B. */
+  template < typename T, unsigned int L >
+  inline void mult( const SquareMatrixArray<T,L> & A,
+                    const SquareMatrixArray<T,L> & B,
+                          SquareMatrixArray<T,L> & C ) {
+    C.resize(A.size());
+    detail::batch_mult_mm<T,L> k;
+    for (unsigned int j = 0; j < L*L; ++j) {
+      k.A[j] = A.component(j);
+      k.B[j] = B.component(j);
+      k.C[j] = C.component(j);
+    }
+    detail::batch_apply<T>(k, A.size());
+  }
+
+  /** Batched determinant of 3x3 matrices:  d[i] = det(A[i]).
+   * @param d
+   *    Output array of at least A.size() elements.
+   */
+  template < typename T >
+  inline void det( const SquareMatrixArray<T,3u> & A, T * d ) {
+    detail::batch_det3<T> k;
+    for (unsigned int j = 0; j < 9u; ++j) k.A[j] = A.component(j);
+    k.d = d;
+    detail::batch_apply<T>(k, A.size());
+  }
+
+  /** Batched inverse of 3x3 matrices:  B[i] = inverse(A[i]).
+   * Unlike inverse(const SquareMatrix&), singular matrices are not detected;
+   * their inverses will contain inf/nan values.  B is resized to match; B may
+   * be the same array as A. */
+  template < typename T >
+  inline void inverse( const SquareMatrixArray<T,3u> & A,
+                             SquareMatrixArray<T,3u> & B ) {
+    B.resize(A.size());
+    detail::batch_inverse3<T> k;
+    for (unsigned int j = 0; j < 9u; ++j) {
+      k.A[j] = A.component(j);
+      k.B[j] = B.component(j);
+    }
+    detail::batch_apply<T>(k, A.size());
+  }
+
+  /** Batched solve of 3x3 systems:  A[i] * x[i] = b[i].
+   * Singular systems are not detected (see inverse).  x is resized to match;
+   * x may be the same array as b. */
+  template < typename T >
+  inline void solve( const SquareMatrixArray<T,3u> & A,
+                     const VectorArray<T,3u> & b,
+                           VectorArray<T,3u> & x ) {
+    x.resize(b.size());
+    detail::batch_solve3<T> k;
+    for (unsigned int j = 0; j < 9u; ++j) k.A[j] = A.component(j);
+    for (unsigned int j = 0; j < 3u; ++j) {
+      k.b[j] = b.component(j);
+      k.x[j] = x.component(j);
+    }
+    detail::batch_apply<T>(k, b.size());
+  }
+
+  /* **** END BATCHED OPERATIONS **** } */
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_SquareMatrixArray_h
@@ -49,6 +49,12 @@
  *
  * Copyright 1998-2008 Spencer Eugene Olson --- All Rights Reserved
  *
+ * With pthreads, SyncLock spins for a short while (SyncLock::spin_rounds
+ * attempts) and then puts the thread to sleep until the lock is released
+ * (with a futex on Linux), such that threads waiting on a lock that is held
+ * for a long time do not burn whole cores.  SyncRWLock adds shared (reader)
+ * locking for read-mostly data.  If SYNCLOCK_STATS is defined, both locks
+ * keep contention counters (see SyncLockStats).
  * */
 
 #ifndef olson_tools_SyncLock_h
@@ -66,9 +72,16 @@
 
 #if defined(USE_PTHREAD) && !defined(THREAD_SYS_DEFINED)
 #  include <pthread.h>
+#  include <sched.h>
 #  include <errno.h>
+#  if defined(__linux__)
+#    include <linux/futex.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#  endif
 #  define IF_PTHREAD(x) x
 #  define THREAD_SYS_DEFINED
+#  define PTHREAD_SYS_DEFINED
 #else
 #  define IF_PTHREAD(x)
 #endif
@@ -88,45 +101,149 @@
 #  define IF_THREADS(x,y) y
 #endif
 
+#if defined(SYNCLOCK_STATS)
+#  include <time.h>
+#  define IF_SYNCLOCK_STATS(x) x
+#else
+#  define IF_SYNCLOCK_STATS(x)
+#endif
+
 
 namespace olson_tools {
 
+  /** Contention counters of a SyncLock or SyncRWLock.  These are only
+   * collected for pthreads and if SYNCLOCK_STATS is defined (otherwise they
+   * stay zero).
+   */
+  struct SyncLockStats {
+    /** The number of times the lock was acquired (exclusively or shared). */
+    long acquisitions;
+    /** The number of acquisitions that found the lock held. */
+    long contended;
+    /** The number of times that a thread went to sleep on the lock. */
+    long parks;
+    /** The total time spent waiting in contended acquisitions (ns). */
+    long long wait_ns;
+
+    SyncLockStats() : acquisitions(0), contended(0), parks(0), wait_ns(0) { }
+  };
+
+  namespace detail {
+
+    /** Hint to the processor that this is a spin-wait loop. */
+    inline void spin_pause() {
+#if defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+#endif
+    }
+
+#if defined(SYNCLOCK_STATS)
+    inline long long synclock_now() {
+      timespec t;
+      clock_gettime( CLOCK_MONOTONIC, &t );
+      return t.tv_sec * 1000000000LL + t.tv_nsec;
+    }
+
+    /** Record an acquisition (while holding the lock). */
+    inline void synclock_count( SyncLockStats & s, const long long & t0,
+                                const long & parks ) {
+      __atomic_add_fetch( &s.acquisitions, 1, __ATOMIC_RELAXED );
+      if ( t0 ) {
+        __atomic_add_fetch( &s.contended, 1, __ATOMIC_RELAXED );
+        __atomic_add_fetch( &s.parks, parks, __ATOMIC_RELAXED );
+        __atomic_add_fetch( &s.wait_ns, synclock_now() - t0,
+                            __ATOMIC_RELAXED );
+      }
+    }
+
+    inline SyncLockStats synclock_read( const SyncLockStats & s ) {
+      SyncLockStats r;
+      r.acquisitions = __atomic_load_n( &s.acquisitions, __ATOMIC_RELAXED );
+      r.contended    = __atomic_load_n( &s.contended, __ATOMIC_RELAXED );
+      r.parks        = __atomic_load_n( &s.parks, __ATOMIC_RELAXED );
+      r.wait_ns      = __atomic_load_n( &s.wait_ns, __ATOMIC_RELAXED );
+      return r;
+    }
+
+    inline void synclock_reset( SyncLockStats & s ) {
+      __atomic_store_n( &s.acquisitions, 0, __ATOMIC_RELAXED );
+      __atomic_store_n( &s.contended, 0, __ATOMIC_RELAXED );
+      __atomic_store_n( &s.parks, 0, __ATOMIC_RELAXED );
+      __atomic_store_n( &s.wait_ns, 0, __ATOMIC_RELAXED );
+    }
+#endif
+
+#if defined(PTHREAD_SYS_DEFINED)
+    /** Sleep while *addr == val (or until woken). */
+    inline void futex_wait( int * addr, const int & val ) {
+#  if defined(__linux__)
+      syscall( SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0 );
+#  else
+      if ( __atomic_load_n( addr, __ATOMIC_RELAXED ) == val )
+        sched_yield();
+#  endif
+    }
+
+    /** Wake one thread sleeping in futex_wait on addr. */
+    inline void futex_wake_one( int * addr ) {
+#  if defined(__linux__)
+      syscall( SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+#  endif
+    }
+#endif
+
+  }/* namespace olson_tools::detail */
+
   /** SyncLock is a class to facilitate mutual exlusion locks for
    * multi-threaded code.  This should be specialized (by ifdefs) for the
    * specific type of mutex needed.
    *
    * Currently supported threading systems:
    * - OpenMP
-   * - PThreads.
+   * - PThreads (spin, then sleep on a futex).
    * - Win32 (Critical Section stuff)
    * .
    *
    */
   class SyncLock {
+  public:
+    /** The number of attempts to take a held lock before going to sleep. */
+    static const int spin_rounds = 100;
+
   private:
     IF_OMP(omp_lock_t omplock;)
-    IF_PTHREAD(pthread_spinlock_t pthread_spin;)
+    /* 0:  unlocked, 1:  locked, 2:  locked and there may be sleepers. */
+    IF_PTHREAD(int state;)
     IF_WIN32(CRITICAL_SECTION critical_section;)
+    IF_SYNCLOCK_STATS(SyncLockStats counters;)
 
   public:
     /** Constructor initializes relevant mutex object. */
     SyncLock() {
       IF_OMP(omp_init_lock(&omplock);)
-      IF_PTHREAD(pthread_spin_init(&pthread_spin, 0);)
+      IF_PTHREAD(state = 0;)
       IF_WIN32(InitializeCriticalSection(&critical_section);)
     }
 
     /** Destructor destroys relevant mutex object. */
     ~SyncLock() {
       IF_OMP(omp_destroy_lock(&omplock);)
-      IF_PTHREAD(pthread_spin_destroy(&pthread_spin);)
       IF_WIN32(DeleteCriticalSection(&critical_section);)
     }
 
     /** Locks relevant mutex object. */
     inline void lock() {
       IF_OMP(omp_set_lock(&omplock);)
-      IF_PTHREAD(pthread_spin_lock(&pthread_spin);)
+      IF_PTHREAD(
+        int c = 0;
+        if ( !__atomic_compare_exchange_n( &state, &c, 1, false,
+                                           __ATOMIC_ACQUIRE,
+                                           __ATOMIC_RELAXED ) ) {
+          lockSlow();
+        } else {
+          IF_SYNCLOCK_STATS(detail::synclock_count(counters, 0, 0));
+        }
+      )
       IF_WIN32(EnterCriticalSection(&critical_section);)
     }
 
@@ -136,7 +253,16 @@ namespace olson_tools {
      */
     inline bool tryLock() {
       IF_OMP(return omp_test_lock(&omplock);)
-      IF_PTHREAD(return pthread_spin_trylock(&pthread_spin) == 0;)
+      IF_PTHREAD(
+        int c = 0;
+        if ( __atomic_compare_exchange_n( &state, &c, 1, false,
+                                          __ATOMIC_ACQUIRE,
+                                          __ATOMIC_RELAXED ) ) {
+          IF_SYNCLOCK_STATS(detail::synclock_count(counters, 0, 0));
+          return true;
+        } else
+          return false;
+      )
       IF_WIN32(return TryEnterCriticalSection(&critical_section);)
       IF_THREADS(/*threads active*/,return true;)
     }
@@ -151,17 +277,7 @@ namespace olson_tools {
           return true;
       )
 
-      IF_PTHREAD(
-        int v = pthread_spin_trylock(&pthread_spin);
-        switch (v) {
-          case EBUSY:
-            return true;
-          case 0:
-            unlock();
-          default:
-            return false;
-        }
-      )
+      IF_PTHREAD(return __atomic_load_n( &state, __ATOMIC_ACQUIRE ) != 0;)
 
       IF_WIN32(
         if ( TryEnterCriticalSection(&critical_section) ) {
@@ -177,9 +293,163 @@ namespace olson_tools {
     /** Unlocks relevant mutex object. */
     inline void unlock() {
       IF_OMP(omp_unset_lock(&omplock);)
-      IF_PTHREAD(pthread_spin_unlock(&pthread_spin);)
+      IF_PTHREAD(
+        if ( __atomic_exchange_n( &state, 0, __ATOMIC_RELEASE ) == 2 )
+          detail::futex_wake_one( &state );
+      )
       IF_WIN32(LeaveCriticalSection(&critical_section);)
     }
+
+    /** The contention counters of this lock (all zero unless SYNCLOCK_STATS
+     * is defined). */
+    inline SyncLockStats stats() const {
+      IF_SYNCLOCK_STATS(return detail::synclock_read(counters);)
+      return SyncLockStats();
+    }
+
+    /** Zero the contention counters. */
+    inline void resetStats() {
+      IF_SYNCLOCK_STATS(detail::synclock_reset(counters);)
+    }
+
+  private:
+    IF_PTHREAD(
+    /** The contended path of lock():  spin for a while and then sleep.  Once
+     * a thread has slept, it takes the lock in state 2 so that the unlock
+     * wakes the next sleeper. */
+    void lockSlow() {
+      IF_SYNCLOCK_STATS(const long long t0 = detail::synclock_now();)
+      IF_SYNCLOCK_STATS(long parks = 0;)
+
+      for ( int r = 0; r < spin_rounds; ++r ) {
+        detail::spin_pause();
+        int c = __atomic_load_n( &state, __ATOMIC_RELAXED );
+        if ( c == 0 &&
+             __atomic_compare_exchange_n( &state, &c, 1, false,
+                                          __ATOMIC_ACQUIRE,
+                                          __ATOMIC_RELAXED ) ) {
+          IF_SYNCLOCK_STATS(detail::synclock_count(counters, t0, parks));
+          return;
+        }
+        if ( c == 2 )
+          break; /* others are already sleeping */
+      }
+
+      while ( __atomic_exchange_n( &state, 2, __ATOMIC_ACQUIRE ) != 0 ) {
+        detail::futex_wait( &state, 2 );
+        IF_SYNCLOCK_STATS(++parks;)
+      }
+      IF_SYNCLOCK_STATS(detail::synclock_count(counters, t0, parks));
+    }
+    )
+  };
+
+  /** A reader/writer lock:  any number of threads may hold the lock shared
+   * (lockShared()), or one thread may hold it exclusively (lock()).  Waiting
+   * writers take precedence over new readers.  Without pthreads, shared
+   * locking is the same as exclusive locking.
+   */
+  class SyncRWLock {
+  public:
+    /** The number of attempts to take a held lock before going to sleep. */
+    static const int spin_rounds = SyncLock::spin_rounds;
+
+  private:
+#if defined(PTHREAD_SYS_DEFINED)
+    pthread_rwlock_t rwlock;
+    IF_SYNCLOCK_STATS(SyncLockStats counters;)
+#else
+    SyncLock exclusive;
+#endif
+
+  public:
+#if defined(PTHREAD_SYS_DEFINED)
+    /** Constructor initializes relevant lock object. */
+    SyncRWLock() { init(); }
+
+    /** Copy constructor creates a new (unlocked) lock. */
+    SyncRWLock( const SyncRWLock & ) { init(); }
+
+    /** Destructor destroys relevant lock object. */
+    ~SyncRWLock() { pthread_rwlock_destroy( &rwlock ); }
+
+    /** Locks exclusively (for writing). */
+    inline void lock() { acquire( &pthread_rwlock_trywrlock,
+                                  &pthread_rwlock_wrlock ); }
+
+    /** Releases an exclusive lock. */
+    inline void unlock() { pthread_rwlock_unlock( &rwlock ); }
+
+    /** Locks shared (for reading). */
+    inline void lockShared() { acquire( &pthread_rwlock_tryrdlock,
+                                        &pthread_rwlock_rdlock ); }
+
+    /** Releases a shared lock. */
+    inline void unlockShared() { pthread_rwlock_unlock( &rwlock ); }
+
+    /** The contention counters of this lock (all zero unless SYNCLOCK_STATS
+     * is defined). */
+    inline SyncLockStats stats() const {
+      IF_SYNCLOCK_STATS(return detail::synclock_read(counters);)
+      return SyncLockStats();
+    }
+
+    /** Zero the contention counters. */
+    inline void resetStats() {
+      IF_SYNCLOCK_STATS(detail::synclock_reset(counters);)
+    }
+
+  private:
+    void init() {
+      pthread_rwlockattr_t attr;
+      pthread_rwlockattr_init( &attr );
+#  if defined(__GLIBC__)
+      /* otherwise, a steady stream of readers starves the writers. */
+      pthread_rwlockattr_setkind_np(
+        &attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP );
+#  endif
+      pthread_rwlock_init( &rwlock, &attr );
+      pthread_rwlockattr_destroy( &attr );
+    }
+
+    /** Try for a while and then block (sleep). */
+    inline void acquire( int (*try_lock)(pthread_rwlock_t *),
+                         int (*block)(pthread_rwlock_t *) ) {
+      if ( try_lock( &rwlock ) == 0 ) {
+        IF_SYNCLOCK_STATS(detail::synclock_count(counters, 0, 0));
+        return;
+      }
+
+      IF_SYNCLOCK_STATS(const long long t0 = detail::synclock_now();)
+      for ( int r = 0; r < spin_rounds; ++r ) {
+        detail::spin_pause();
+        if ( try_lock( &rwlock ) == 0 ) {
+          IF_SYNCLOCK_STATS(detail::synclock_count(counters, t0, 0));
+          return;
+        }
+      }
+      block( &rwlock );
+      IF_SYNCLOCK_STATS(detail::synclock_count(counters, t0, 1));
+    }
+#else
+    /** Locks exclusively (for writing). */
+    inline void lock() { exclusive.lock(); }
+
+    /** Releases an exclusive lock. */
+    inline void unlock() { exclusive.unlock(); }
+
+    /** Locks shared (for reading). */
+    inline void lockShared() { exclusive.lock(); }
+
+    /** Releases a shared lock. */
+    inline void unlockShared() { exclusive.unlock(); }
+
+    /** The contention counters of the underlying SyncLock. */
+    inline SyncLockStats stats() const { return exclusive.stats(); }
+
+    /** Zero the contention counters. */
+    inline void resetStats() { exclusive.resetStats(); }
+#endif
   };
 
   /** An RAII type automatic locking/unlocking key for a SyncLock. 
@@ -193,6 +463,24 @@ namespace olson_tools {
     ~SyncKey() { lock.unlock(); }
   };
 
+  /** An RAII type automatic key for shared (reading) access through a
+   * SyncRWLock. */
+  struct SyncReadKey {
+    SyncRWLock & lock;
+
+    SyncReadKey( SyncRWLock & lock ) : lock(lock) { lock.lockShared(); }
+    ~SyncReadKey() { lock.unlockShared(); }
+  };
+
+  /** An RAII type automatic key for exclusive (writing) access through a
+   * SyncRWLock. */
+  struct SyncWriteKey {
+    SyncRWLock & lock;
+
+    SyncWriteKey( SyncRWLock & lock ) : lock(lock) { lock.lock(); }
+    ~SyncWriteKey() { lock.unlock(); }
+  };
+
   /** Automatic locking/unlocking facility with a typename scope. */
   template < typename T >
   struct Synchronize : SyncKey {
@@ -0,0 +1,353 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * CPU/NUMA topology and the placement of the threads of a PThreadCache.
+ *
+ * The topology is read from /sys/devices/system/node (Linux), so that
+ * libnuma is not needed.  Where the topology or thread affinity is not
+ * available, all CPUs are taken to be on one node and the threads are not
+ * pinned.
+ * */
+
+#ifndef olson_tools_ThreadPlacement_h
+#define olson_tools_ThreadPlacement_h
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+namespace olson_tools {
+
+  /** Parse a list of CPUs such as "0-3,8,10-11" (the format of the Linux
+   * cpulist files).
+   * @return false if the list is malformed.
+   */
+  inline bool parse_cpu_list( const std::string & s, std::vector<int> & cpus ) {
+    cpus.clear();
+    const char * p = s.c_str();
+    while ( *p ) {
+      char * end;
+      const long b = strtol(p, &end, 10);
+      if ( end == p || b < 0 )
+        return false;
+      long e = b;
+      p = end;
+      if ( *p == '-' ) {
+        e = strtol(p + 1, &end, 10);
+        if ( end == p + 1 || e < b )
+          return false;
+        p = end;
+      }
+      for ( long c = b; c <= e; ++c )
+        cpus.push_back(int(c));
+      if ( *p == ',' )
+        ++p;
+      else if ( *p == '\n' || *p == ' ' )
+        break;
+      else if ( *p )
+        return false;
+    }
+    return !cpus.empty();
+  }
+
+  /** The CPUs (that this process may use) of each NUMA node. */
+  class CpuTopology {
+  private:
+    std::vector< std::vector<int> > nodes;
+
+    /** The CPUs that this process may run on. */
+    static std::vector<int> allowed() {
+      std::vector<int> cpus;
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if ( sched_getaffinity(0, sizeof(set), &set) == 0 ) {
+        for ( int c = 0; c < CPU_SETSIZE; ++c )
+          if ( CPU_ISSET(c, &set) )
+            cpus.push_back(c);
+      }
+#endif
+      if ( cpus.empty() ) {
+        const long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for ( long c = 0; c < (n > 0 ? n : 1); ++c )
+          cpus.push_back(int(c));
+      }
+      return cpus;
+    }
+
+    void read( const char * sysfs ) {
+      const std::vector<int> ok = allowed();
+
+      std::vector<int> ids;
+      if ( DIR * d = opendir(sysfs) ) {
+        while ( struct dirent * e = readdir(d) ) {
+          char * end;
+          if ( strncmp(e->d_name, "node", 4) == 0 ) {
+            const long id = strtol(e->d_name + 4, &end, 10);
+            if ( end != e->d_name + 4 && *end == '\0' )
+              ids.push_back(int(id));
+          }
+        }
+        closedir(d);
+      }
+      std::sort(ids.begin(), ids.end());
+
+      for ( unsigned int i = 0; i < ids.size(); ++i ) {
+        std::string list;
+        std::ifstream in( ( std::string(sysfs) + "/node" +
+                            to_string(ids[i]) + "/cpulist" ).c_str() );
+        std::vector<int> cpus, node;
+        if ( !std::getline(in, list) || !parse_cpu_list(list, cpus) )
+          continue;
+        for ( unsigned int c = 0; c < cpus.size(); ++c )
+          if ( std::binary_search(ok.begin(), ok.end(), cpus[c]) )
+            node.push_back(cpus[c]);
+        if ( !node.empty() )
+          nodes.push_back(node);
+      }
+
+      if ( nodes.empty() )
+        nodes.push_back(ok);
+    }
+
+    static std::string to_string( const int & i ) {
+      char s[16];
+      snprintf(s, sizeof(s), "%d", i);
+      return s;
+    }
+
+  public:
+    /** Read the topology of this machine.
+     * @param sysfs
+     *    The directory of the node directories [Default
+     *    /sys/devices/system/node].
+     */
+    CpuTopology( const char * sysfs = "/sys/devices/system/node" ) {
+      read(sysfs);
+    }
+
+    /** A given topology (the CPUs of each node). */
+    CpuTopology( const std::vector< std::vector<int> > & nodes )
+      : nodes(nodes) { }
+
+    /** The topology of this machine (read once). */
+    static const CpuTopology & system() {
+      static const CpuTopology t;
+      return t;
+    }
+
+    int n_nodes() const { return nodes.size(); }
+
+    const std::vector<int> & cpus( const int & node ) const {
+      return nodes[node];
+    }
+
+    int n_cpus() const {
+      int n = 0;
+      for ( unsigned int i = 0; i < nodes.size(); ++i )
+        n += nodes[i].size();
+      return n;
+    }
+
+    /** The node of a CPU (-1 if the CPU is not known). */
+    int node_of( const int & cpu ) const {
+      for ( unsigned int i = 0; i < nodes.size(); ++i )
+        if ( std::find(nodes[i].begin(), nodes[i].end(), cpu) !=
+             nodes[i].end() )
+          return i;
+      return -1;
+    }
+  };
+
+  /** A policy for pinning the threads of a PThreadCache to CPUs. */
+  struct ThreadPlacement {
+    enum Policy {
+      /** Do not pin the threads (the default). */
+      NONE,
+      /** Fill the CPUs of the first node, then of the next, .... */
+      COMPACT,
+      /** Alternate between the nodes. */
+      SCATTER,
+      /** Use the given list of CPUs (in order). */
+      EXPLICIT
+    };
+
+    Policy policy;
+
+    /** The CPUs for EXPLICIT. */
+    std::vector<int> cpu_list;
+
+    ThreadPlacement( const Policy & policy = NONE ) : policy(policy) { }
+
+    ThreadPlacement( const std::vector<int> & cpu_list )
+      : policy(EXPLICIT), cpu_list(cpu_list) { }
+
+    /** Parse "compact", "scatter", "none" or a list of CPUs (see
+     * parse_cpu_list).  Anything else gives NONE. */
+    static ThreadPlacement parse( const std::string & s ) {
+      if ( s == "compact" ) return ThreadPlacement(COMPACT);
+      if ( s == "scatter" ) return ThreadPlacement(SCATTER);
+      std::vector<int> cpus;
+      if ( parse_cpu_list(s, cpus) )
+        return ThreadPlacement(cpus);
+      return ThreadPlacement(NONE);
+    }
+
+    /** The CPU of each of n threads (-1 for not pinned).  Threads are
+     * wrapped around if there are more threads than CPUs. */
+    std::vector<int> assign( const int & n,
+                             const CpuTopology & t =
+                               CpuTopology::system() ) const {
+      std::vector<int> cpus(n > 0 ? n : 0, -1);
+      const int nn = t.n_nodes();
+      switch ( policy ) {
+        case COMPACT: {
+          std::vector<int> all;
+          for ( int k = 0; k < nn; ++k )
+            all.insert( all.end(), t.cpus(k).begin(), t.cpus(k).end() );
+          for ( int i = 0; i < n; ++i )
+            cpus[i] = all[ i % all.size() ];
+          break;
+        }
+        case SCATTER:
+          for ( int i = 0; i < n; ++i ) {
+            const std::vector<int> & node = t.cpus(i % nn);
+            cpus[i] = node[ (i / nn) % node.size() ];
+          }
+          break;
+        case EXPLICIT:
+          if ( !cpu_list.empty() )
+            for ( int i = 0; i < n; ++i )
+              cpus[i] = cpu_list[ i % cpu_list.size() ];
+          break;
+        default:
+          break;
+      }
+      return cpus;
+    }
+  };
+
+  namespace detail {
+    /** Set the affinity of the attributes (or of the calling thread, if attr
+     * is NULL) to the given CPUs.
+     * @return false if not supported or not allowed.
+     */
+    inline bool set_affinity( pthread_attr_t * attr,
+                              const std::vector<int> & cpus ) {
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for ( unsigned int i = 0; i < cpus.size(); ++i )
+        if ( cpus[i] >= 0 && cpus[i] < CPU_SETSIZE )
+          CPU_SET(cpus[i], &set);
+      if ( CPU_COUNT(&set) == 0 )
+        return false;
+      if ( attr )
+        return pthread_attr_setaffinity_np(attr, sizeof(set), &set) == 0;
+      return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+      return false;
+#endif
+    }
+
+    /** Zero [b, e) from a thread on the given CPUs. */
+    struct touch_part {
+      char * b, * e;
+      const std::vector<int> * cpus;
+      pthread_t thread;
+
+      static void * run( void * arg ) {
+        touch_part * t = static_cast<touch_part*>(arg);
+        set_affinity(NULL, *t->cpus);
+        memset(t->b, 0, t->e - t->b);
+        return NULL;
+      }
+    };
+  }/* namespace detail */
+
+  /** Zero a newly allocated buffer such that its pages are placed on the
+   * NUMA nodes of the threads that will use it (the first touch of a page
+   * decides its node).  The buffer is divided into equal, contiguous parts,
+   * one for each entry of thread_nodes, and part i is zeroed by a thread on
+   * node thread_nodes[i] (-1:  any node).
+   */
+  inline void first_touch( void * p, const size_t & bytes,
+                           const std::vector<int> & thread_nodes,
+                           const CpuTopology & t = CpuTopology::system() ) {
+    char * buf = static_cast<char*>(p);
+    const size_t n = thread_nodes.size();
+    if ( n == 0 || t.n_nodes() <= 1 ) {
+      memset(buf, 0, bytes);
+      return;
+    }
+
+    /* one thread for each run of parts on the same node. */
+    std::vector<detail::touch_part> parts;
+    for ( size_t i = 0; i < n; ++i ) {
+      const int node = thread_nodes[i];
+      char * b = buf + bytes * i / n;
+      char * e = buf + bytes * (i + 1) / n;
+      if ( !parts.empty() && parts.back().e == b &&
+           parts.back().cpus ==
+             ( node >= 0 && node < t.n_nodes() ? &t.cpus(node) : NULL ) ) {
+        parts.back().e = e;
+        continue;
+      }
+      detail::touch_part part = {
+        b, e, node >= 0 && node < t.n_nodes() ? &t.cpus(node) : NULL,
+        pthread_t()
+      };
+      parts.push_back(part);
+    }
+
+    for ( size_t i = 0; i < parts.size(); ++i ) {
+      if ( parts[i].cpus == NULL ||
+           pthread_create(&parts[i].thread, NULL, detail::touch_part::run,
+                          &parts[i]) != 0 ) {
+        memset(parts[i].b, 0, parts[i].e - parts[i].b);
+        parts[i].cpus = NULL;
+      }
+    }
+    for ( size_t i = 0; i < parts.size(); ++i )
+      if ( parts[i].cpus )
+        pthread_join(parts[i].thread, NULL);
+  }
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_ThreadPlacement_h
@@ -53,6 +53,11 @@
  * away and unrolling the loops for sizes ~3 (which are mostly what I use this
  * for).  Thus, in most cases, these classes should perform just fine.  
  *
+ * If USE_SIMD_VECTOR is defined, Vector<double,3> and Vector<double,4> are
+ * replaced by SSE2/AVX specializations that are padded to four doubles and
+ * aligned to 32 bytes (see olson-tools/simd/Vector.h).  Compile with -mavx to
+ * get the AVX versions.
+ *
  * Copyright 2004-2008 Spencer Olson
  */
 
@@ -736,4 +741,8 @@ namespace olson_tools {
 
 }/* namespace olson_tools */
 
+#if defined(USE_SIMD_VECTOR) && defined(__SSE2__)
+#  include <olson-tools/simd/Vector.h>
+#endif
+
 #endif // olson_tools_Vector_h
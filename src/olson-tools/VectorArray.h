@@ -0,0 +1,511 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * Structure-of-arrays container for Vector valued data.
+ *
+ * Copyright 2004-2009 Spencer Olson
+ */
+
+#ifndef olson_tools_VectorArray_h
+#define olson_tools_VectorArray_h
+
+#include <olson-tools/Vector.h>
+
+#include <boost/type_traits/remove_const.hpp>
+
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <new>
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+namespace olson_tools {
+
+  /** Proxy reference to one element of a VectorArray.  This behaves much like
+   * a Vector<T,L>& for existing code:  it can be indexed, assigned to/from a
+   * Vector<T,L>, modified with the compound assignment operators and
+   * converted to a Vector<T,L>.  Because a VectorRef is not a real Vector,
+   * templated free functions that deduce Vector<T,L> (such as the generic
+   * operator+) need an explicit conversion (or use the member operators
+   * provided here).
+   *
+   * @tparam T
+   *    The element type (const T provides a read-only reference).
+   * @tparam L
+   *    The number of components.
+   */
+  template < typename T, unsigned int L >
+  class VectorRef {
+    /* TYPEDEFS */
+  public:
+    /** The type of a single component. */
+    typedef typename boost::remove_const<T>::type element_type;
+
+    /** The type of the (value) Vector that this is a reference to. */
+    typedef Vector< element_type, L > value_type;
+
+    /** The length of the Vector. */
+    static const unsigned int length = L;
+
+
+    /* MEMBER STORAGE */
+  private:
+    /** Pointer to the first component of this element. */
+    T * base;
+
+    /** Distance between successive components. */
+    std::ptrdiff_t stride;
+
+
+    /* MEMBER FUNCTIONS */
+  public:
+    /** Constructor. */
+    inline VectorRef( T * base, const std::ptrdiff_t & stride )
+      : base(base), stride(stride) { }
+
+    /** Index operator. */
+    inline T & operator[] (const int & i) const { return base[i*stride]; }
+
+    /** Conversion to a Vector (by value). */
+    inline operator value_type () const { return get(); }
+
+    /** Explicit conversion to a Vector (by value). */
+    inline value_type get() const {
+      value_type retval;
+      for (unsigned int i = 0; i < L; ++i) retval[i] = base[i*stride];
+      return retval;
+    }
+
+    /** Assignment operator--copies the referenced values (not the reference).
+     * */
+    inline const VectorRef & operator= (const VectorRef & that) const {
+      return *this = that.get();
+    }
+
+    /** Assignment operator--from a Vector. */
+    template < typename TR >
+    inline const VectorRef & operator= (const Vector<TR,L> & that) const {
+      for (unsigned int i = 0; i < L; ++i) base[i*stride] = that[i];
+      return *this;
+    }
+
+    /** Assignment operator--from scalar value. */
+    inline const VectorRef & operator= (const T & that) const {
+      for (unsigned int i = 0; i < L; ++i) base[i*stride] = that;
+      return *this;
+    }
+
+    /** Zero the referenced Vector. */
+    inline const VectorRef & zero () const { return *this = T(0); }
+
+    /** Vector + Vector immediate addition. */
+    inline const VectorRef & operator+= (const value_type & that) const {
+      for (unsigned int i = 0; i < L; ++i) base[i*stride] += that[i];
+      return *this;
+    }
+
+    /** Vector - Vector immediate subtraction. */
+    inline const VectorRef & operator-= (const value_type & that) const {
+      for (unsigned int i = 0; i < L; ++i) base[i*stride] -= that[i];
+      return *this;
+    }
+
+    /** Vector X Scalar immediate multiplication. */
+    inline const VectorRef & operator*= (const T & that) const {
+      for (unsigned int i = 0; i < L; ++i) base[i*stride] *= that;
+      return *this;
+    }
+
+    /** Vector X Scalar immediate division. */
+    inline const VectorRef & operator/= (const T & that) const {
+      for (unsigned int i = 0; i < L; ++i) base[i*stride] /= that;
+      return *this;
+    }
+
+    /** Vector + Vector addition. */
+    inline value_type operator+ (const value_type & that) const {
+      return get() + that;
+    }
+
+    /** Vector - Vector subtraction. */
+    inline value_type operator- (const value_type & that) const {
+      return get() - that;
+    }
+
+    /** Inner product. */
+    inline element_type operator* (const value_type & that) const {
+      return get() * that;
+    }
+
+    /** Vector X Scalar multiplication. */
+    inline value_type operator* (const T & that) const {
+      return get() * that;
+    }
+
+    /** Vector / Scalar division. */
+    inline value_type operator/ (const T & that) const {
+      return get() / that;
+    }
+
+    /** Compute the magnitude of the referenced vector. */
+    inline element_type abs() const { return get().abs(); }
+  };
+
+  /** Swap the values referenced by two VectorRefs.  This is found by
+   * std::iter_swap (and therefore by nsort::NSort) via ADL. */
+  template < typename T, unsigned int L >
+  inline void swap( const VectorRef<T,L> & a, const VectorRef<T,L> & b ) {
+    for (unsigned int i = 0; i < L; ++i)
+      std::swap(a[i], b[i]);
+  }
+
+  /** Stream output operator. */
+  template < typename T, unsigned int L >
+  inline std::ostream & operator<< (std::ostream & output,
+                                    const VectorRef<T,L> & v) {
+    return output << v.get();
+  }
+
+
+  /** Random access iterator over the elements of a VectorArray.  Dereferencing
+   * gives a VectorRef proxy.  This iterator can be given to nsort::NSort.
+   */
+  template < typename T, unsigned int L >
+  class VectorArrayIterator {
+    /* TYPEDEFS */
+  public:
+    typedef std::random_access_iterator_tag          iterator_category;
+    typedef typename VectorRef<T,L>::value_type      value_type;
+    typedef std::ptrdiff_t                           difference_type;
+    typedef void                                     pointer;
+    typedef VectorRef<T,L>                           reference;
+
+
+    /* MEMBER STORAGE */
+  private:
+    T * base;
+    std::ptrdiff_t stride;
+
+
+    /* MEMBER FUNCTIONS */
+  public:
+    inline VectorArrayIterator( T * base = NULL, const std::ptrdiff_t & stride = 0 )
+      : base(base), stride(stride) { }
+
+    /** Conversion from non-const to const iterator. */
+    template < typename T2 >
+    inline VectorArrayIterator( const VectorArrayIterator<T2,L> & that )
+      : base(that.ptr()), stride(that.get_stride()) { }
+
+    inline T * ptr() const { return base; }
+    inline const std::ptrdiff_t & get_stride() const { return stride; }
+
+    inline reference operator* () const { return reference(base, stride); }
+    inline reference operator[] (const difference_type & n) const {
+      return reference(base + n, stride);
+    }
+
+    inline VectorArrayIterator & operator++ () { ++base; return *this; }
+    inline VectorArrayIterator & operator-- () { --base; return *this; }
+    inline VectorArrayIterator operator++ (int) {
+      VectorArrayIterator r(*this); ++base; return r;
+    }
+    inline VectorArrayIterator operator-- (int) {
+      VectorArrayIterator r(*this); --base; return r;
+    }
+
+    inline VectorArrayIterator & operator+= (const difference_type & n) {
+      base += n; return *this;
+    }
+    inline VectorArrayIterator & operator-= (const difference_type & n) {
+      base -= n; return *this;
+    }
+    inline VectorArrayIterator operator+ (const difference_type & n) const {
+      return VectorArrayIterator(base + n, stride);
+    }
+    inline VectorArrayIterator operator- (const difference_type & n) const {
+      return VectorArrayIterator(base - n, stride);
+    }
+    inline difference_type operator- (const VectorArrayIterator & that) const {
+      return base - that.base;
+    }
+
+    inline bool operator== (const VectorArrayIterator & that) const { return base == that.base; }
+    inline bool operator!= (const VectorArrayIterator & that) const { return base != that.base; }
+    inline bool operator<  (const VectorArrayIterator & that) const { return base <  that.base; }
+    inline bool operator<= (const VectorArrayIterator & that) const { return base <= that.base; }
+    inline bool operator>  (const VectorArrayIterator & that) const { return base >  that.base; }
+    inline bool operator>= (const VectorArrayIterator & that) const { return base >= that.base; }
+  };
+
+
+  /** Structure-of-arrays storage of Vector<T,L> values.
+   * Each component of the Vectors is stored contiguously (component(i) gives
+   * the array of the ith components), which is what SIMD kernels and batched
+   * field lookup or integration routines want.  Each component array is
+   * aligned to VectorArray::alignment bytes.
+   *
+   * Element access (operator[] and the iterators) hands out VectorRef proxies
+   * which behave much like Vector<T,L>& for existing code.  The iterators are
+   * random access and can be sorted with nsort::NSort.
+   *
+   * Example:
+   * \verbatim
+      std::vector< Vector<double,3> > aos = ...;
+      VectorArray<double,3> x(aos.begin(), aos.end());
+      double * xs = x.component(0);           // all x components
+      x[10] += V3(1.,0.,0.);
+      x.copy_to(aos.begin());
+     \endverbatim
+   */
+  template < typename T, unsigned int L >
+  class VectorArray {
+    /* TYPEDEFS */
+  public:
+    typedef Vector<T,L>                        value_type;
+    typedef VectorRef<T,L>                     reference;
+    typedef VectorRef<const T,L>               const_reference;
+    typedef VectorArrayIterator<T,L>           iterator;
+    typedef VectorArrayIterator<const T,L>     const_iterator;
+    typedef std::size_t                        size_type;
+    typedef std::ptrdiff_t                     difference_type;
+
+    /** The number of components. */
+    static const unsigned int length = L;
+
+    /** The alignment (in bytes) of each component array. */
+    static const size_type alignment = 64u;
+
+
+    /* MEMBER STORAGE */
+  private:
+    /** The component storage (L arrays of stride elements each). */
+    T * data;
+
+    /** The number of elements. */
+    size_type n;
+
+    /** The capacity of each component array (a multiple of
+     * alignment/sizeof(T)). */
+    size_type stride;
+
+
+    /* MEMBER FUNCTIONS */
+  public:
+    /** Default constructor creates an empty array. */
+    VectorArray() : data(NULL), n(0), stride(0) { }
+
+    /** Create an array of n elements (each is default constructed). */
+    explicit VectorArray( const size_type & n ) : data(NULL), n(0), stride(0) {
+      resize(n);
+    }
+
+    /** Create an array of n elements, each equal to v. */
+    VectorArray( const size_type & n, const value_type & v )
+      : data(NULL), n(0), stride(0) {
+      resize(n, v);
+    }
+
+    /** Create an array from a range of (AoS) Vector<T,L> values.
+     * @see assign. */
+    template < typename Iter >
+    VectorArray( const Iter & first, const Iter & last )
+      : data(NULL), n(0), stride(0) {
+      assign(first, last);
+    }
+
+    /** Copy constructor. */
+    VectorArray( const VectorArray & that ) : data(NULL), n(0), stride(0) {
+      *this = that;
+    }
+
+    /** Destructor. */
+    ~VectorArray() {
+      std::free(data);
+    }
+
+    /** Assignment operator. */
+    VectorArray & operator= ( const VectorArray & that ) {
+      if ( this == &that )
+        return *this;
+      resize(that.n);
+      for (unsigned int j = 0; j < L; ++j)
+        std::copy( that.component(j), that.component(j) + n, component(j) );
+      return *this;
+    }
+
+    /** The number of elements. */
+    inline size_type size() const { return n; }
+
+    /** Whether there are no elements. */
+    inline bool empty() const { return n == 0; }
+
+    /** The number of elements that can be held without reallocation. */
+    inline size_type capacity() const { return stride; }
+
+    /** The distance (in elements of T) between successive component arrays.
+     * */
+    inline difference_type get_stride() const { return stride; }
+
+    /** Pointer to the (aligned) array of the jth components. */
+    inline T * component( const unsigned int & j ) {
+      return data + j*stride;
+    }
+
+    /** Pointer to the (aligned) array of the jth components--const version.
+     * */
+    inline const T * component( const unsigned int & j ) const {
+      return data + j*stride;
+    }
+
+    /** Element access. */
+    inline reference operator[] ( const size_type & i ) {
+      return reference(data + i, stride);
+    }
+
+    /** Element access--const version. */
+    inline const_reference operator[] ( const size_type & i ) const {
+      return const_reference(data + i, stride);
+    }
+
+    inline iterator begin() { return iterator(data, stride); }
+    inline iterator end()   { return iterator(data + n, stride); }
+    inline const_iterator begin() const { return const_iterator(data, stride); }
+    inline const_iterator end()   const { return const_iterator(data + n, stride); }
+
+    /** Make sure that at least new_cap elements can be held without
+     * reallocation. */
+    void reserve( const size_type & new_cap ) {
+      if ( new_cap <= stride )
+        return;
+
+      /* round up to keep every component array aligned. */
+      const size_type per_line = alignment / sizeof(T) > 0 ?
+                                 alignment / sizeof(T) : 1u;
+      size_type new_stride = ((new_cap + per_line - 1) / per_line) * per_line;
+
+      void * p = NULL;
+      if ( posix_memalign(&p, alignment, new_stride * L * sizeof(T)) != 0 )
+        throw std::bad_alloc();
+
+      T * new_data = static_cast<T*>(p);
+      for (unsigned int j = 0; j < L; ++j)
+        std::copy( component(j), component(j) + n, new_data + j*new_stride );
+
+      std::free(data);
+      data = new_data;
+      stride = new_stride;
+    }
+
+    /** Change the number of elements.  New elements are left uninitialized.
+     * */
+    void resize( const size_type & new_n ) {
+      reserve(new_n);
+      n = new_n;
+    }
+
+    /** Change the number of elements, initializing new elements to v. */
+    void resize( const size_type & new_n, const value_type & v ) {
+      reserve(new_n);
+      for (unsigned int j = 0; j < L; ++j)
+        if ( new_n > n )
+          std::fill( component(j) + n, component(j) + new_n, v[j] );
+      n = new_n;
+    }
+
+    /** Remove all elements (the storage is kept). */
+    inline void clear() { n = 0; }
+
+    /** Append an element. */
+    inline void push_back( const value_type & v ) {
+      if ( n == stride )
+        reserve( stride > 0 ? 2*stride : 1u );
+      (*this)[n++] = v;
+    }
+
+    /** Bulk conversion from an array-of-structures range.  The values given by
+     * [first, last) must be convertible to Vector<T,L> (or at least be
+     * indexable by 0..L-1).  The input is processed in blocks so that the
+     * source stays in cache while each component array is written.
+     */
+    template < typename Iter >
+    void assign( Iter first, const Iter & last ) {
+      resize( std::distance(first, last) );
+
+      static const size_type block = 256u;
+      for (size_type i0 = 0; i0 < n; i0 += block) {
+        const size_type i1 = std::min(n, i0 + block);
+        for (unsigned int j = 0; j < L; ++j) {
+          Iter it = first;
+          T * c = component(j);
+          for (size_type i = i0; i < i1; ++i, ++it)
+            c[i] = (*it)[j];
+        }
+        std::advance(first, i1 - i0);
+      }
+    }
+
+    /** Bulk conversion to an array-of-structures range.  out must point to a
+     * range of at least size() elements that can be indexed by 0..L-1 (such
+     * as Vector<T,L>).
+     * @return the end of the output range.
+     */
+    template < typename OutIter >
+    OutIter copy_to( OutIter out ) const {
+      static const size_type block = 256u;
+      for (size_type i0 = 0; i0 < n; i0 += block) {
+        const size_type i1 = std::min(n, i0 + block);
+        for (unsigned int j = 0; j < L; ++j) {
+          OutIter it = out;
+          const T * c = component(j);
+          for (size_type i = i0; i < i1; ++i, ++it)
+            (*it)[j] = c[i];
+        }
+        std::advance(out, i1 - i0);
+      }
+      return out;
+    }
+
+    /** Swap the contents of two VectorArrays. */
+    inline void swap( VectorArray & that ) {
+      std::swap(data, that.data);
+      std::swap(n, that.n);
+      std::swap(stride, that.stride);
+    }
+  };
+
+  template < typename T, unsigned int L >
+  const typename VectorArray<T,L>::size_type VectorArray<T,L>::alignment;
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_VectorArray_h
@@ -0,0 +1,176 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * A lock-free work-stealing deque of pointers (Chase and Lev, SPAA 2005, with
+ * the memory ordering of Le et al., PPoPP 2013).
+ *
+ * Copyright 2006-2009 Spencer Olson
+ */
+
+#ifndef olson_tools_WorkDeque_h
+#define olson_tools_WorkDeque_h
+
+#include <cstddef>
+
+namespace olson_tools {
+
+  /** A double ended queue of pointers that one thread (the owner) pushes and
+   * pops at the bottom while any other thread may steal from the top.  The
+   * owner's operations only synchronize with thieves when the deque is
+   * (almost) empty.  The circular buffer grows as needed; the old buffers
+   * are kept (since a thief might still be reading from them) until the
+   * deque is destroyed.
+   *
+   * This uses the GCC __atomic builtins.
+   */
+  template < typename T >
+  class WorkDeque {
+    /* TYPEDEFS */
+  private:
+    struct Buffer {
+      long mask;
+      T ** items;
+      Buffer * prev;
+
+      Buffer( const long & size, Buffer * prev )
+        : mask(size - 1), items(new T*[size]), prev(prev) { }
+      ~Buffer() { delete[] items; }
+
+      inline T * get( const long & i ) const {
+        return __atomic_load_n( &items[i & mask], __ATOMIC_RELAXED );
+      }
+
+      inline void put( const long & i, T * t ) {
+        __atomic_store_n( &items[i & mask], t, __ATOMIC_RELAXED );
+      }
+    };
+
+
+    /* MEMBER STORAGE */
+    /** The next position to steal from. */
+    long top;
+    /** The next position to push to. */
+    long bottom;
+    Buffer * buffer;
+
+    /* not copyable. */
+    WorkDeque( const WorkDeque & );
+    WorkDeque & operator= ( const WorkDeque & );
+
+
+    /* MEMBER FUNCTIONS */
+  public:
+    WorkDeque( const long & size = 256 )
+      : top(0), bottom(0), buffer(new Buffer(size, NULL)) { }
+
+    ~WorkDeque() {
+      while ( buffer ) {
+        Buffer * p = buffer->prev;
+        delete buffer;
+        buffer = p;
+      }
+    }
+
+    /** Push t onto the bottom (owner only). */
+    void push( T * t ) {
+      const long b = __atomic_load_n( &bottom, __ATOMIC_RELAXED );
+      const long tp = __atomic_load_n( &top, __ATOMIC_ACQUIRE );
+      Buffer * a = __atomic_load_n( &buffer, __ATOMIC_RELAXED );
+      if ( b - tp > a->mask ) {
+        /* full:  copy into a buffer of twice the size. */
+        Buffer * n = new Buffer( 2 * (a->mask + 1), a );
+        for (long i = tp; i < b; ++i)
+          n->put( i, a->get(i) );
+        __atomic_store_n( &buffer, n, __ATOMIC_RELEASE );
+        a = n;
+      }
+      a->put( b, t );
+      /* publishes the item (and *t) to the thieves. */
+      __atomic_store_n( &bottom, b + 1, __ATOMIC_RELEASE );
+    }
+
+    /** Pop from the bottom (owner only).
+     * @return NULL if the deque is empty.
+     */
+    T * pop() {
+      const long b = __atomic_load_n( &bottom, __ATOMIC_RELAXED ) - 1;
+      Buffer * a = __atomic_load_n( &buffer, __ATOMIC_RELAXED );
+      __atomic_store_n( &bottom, b, __ATOMIC_RELAXED );
+      __atomic_thread_fence( __ATOMIC_SEQ_CST );
+      long tp = __atomic_load_n( &top, __ATOMIC_RELAXED );
+
+      T * t = NULL;
+      if ( tp <= b ) {
+        t = a->get(b);
+        if ( tp == b ) {
+          /* the last item:  race the thieves for it. */
+          if ( !__atomic_compare_exchange_n( &top, &tp, tp + 1, false,
+                                             __ATOMIC_SEQ_CST,
+                                             __ATOMIC_RELAXED ) )
+            t = NULL;
+          __atomic_store_n( &bottom, b + 1, __ATOMIC_RELAXED );
+        }
+      } else
+        __atomic_store_n( &bottom, b + 1, __ATOMIC_RELAXED );
+      return t;
+    }
+
+    /** Steal from the top (any thread).
+     * @return NULL if the deque is empty or if another thread won the race
+     * for the top item.
+     */
+    T * steal() {
+      long tp = __atomic_load_n( &top, __ATOMIC_ACQUIRE );
+      __atomic_thread_fence( __ATOMIC_SEQ_CST );
+      const long b = __atomic_load_n( &bottom, __ATOMIC_ACQUIRE );
+
+      if ( tp < b ) {
+        Buffer * a = __atomic_load_n( &buffer, __ATOMIC_ACQUIRE );
+        T * t = a->get(tp);
+        if ( !__atomic_compare_exchange_n( &top, &tp, tp + 1, false,
+                                           __ATOMIC_SEQ_CST,
+                                           __ATOMIC_RELAXED ) )
+          return NULL;
+        return t;
+      }
+      return NULL;
+    }
+
+    /** The approximate number of items (exact for the owner when no thief is
+     * active). */
+    long size() const {
+      const long b = __atomic_load_n( &bottom, __ATOMIC_RELAXED );
+      const long tp = __atomic_load_n( &top, __ATOMIC_RELAXED );
+      return b > tp ? b - tp : 0;
+    }
+  };
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_WorkDeque_h
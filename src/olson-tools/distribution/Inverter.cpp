@@ -62,39 +62,76 @@
  */
 
 #include <olson-tools/ompexcept.h>
+#include <olson-tools/parallel_for.h>
 
 #include <stdexcept>
+#include <algorithm>
 #include <cstring>
 
 namespace olson_tools {
   namespace distribution {
 
+    namespace detail {
+      /** Inverts the normalized integral IntP for a range of q[]. */
+      struct InvertRange {
+        const double * IntP;
+        double * q;
+        int L;
+        double min, dx, dprob;
+
+        void operator() ( const int & b, const int & e ) const {
+          /* the first bin above the first probability of the range; the
+           * probabilities increase with i, so that the following search can
+           * continue from there. */
+          int j = std::lower_bound( IntP + 1, IntP + L + 1,
+                                    b*dprob + IntP[0] ) - IntP;
+
+          for ( int i = b; i < e; ++i ) {
+            /* the ith probability: */
+            double prob = i*dprob + IntP[0];
+
+            /* find the probability location above this one. */
+            while (j <= L && IntP[j] < prob) j++;
+
+            /* now we use linear interpolation to determine the input value at
+             * this probability.
+             */
+
+            q[i] = (min+(j-1)*dx)
+                 + (dx / (IntP[j] - IntP[j-1]))
+                   * (prob    - IntP[j-1]);
+          }
+        }
+      };
+    }/* namespace olson_tools::distribution::detail */
+
 
     inline void Inverter::copyLq(const int & that_L, const double * that_q) {
-      if (q) delete[] q;
+      if (q && !arena) delete[] q;
       L = that_L;
-      q = new double[L + 1];
+      q = arena ? arena->allocate_array<double>(L + 1) : new double[L + 1];
       memcpy (q, that_q, sizeof(double)*(L+1));
     }
 
 
     inline Inverter::Inverter(const Inverter & that)
-      : L(0), q(NULL) {
+      : L(0), q(NULL), arena(NULL) {
       copyLq(that.L, that.q);
     }
 
 
     inline Inverter::Inverter(const int & _qLen, const double * _q)
-      : L(0), q(NULL) {
-      copyLq(_qLen-1, q);
+      : L(0), q(NULL), arena(NULL) {
+      copyLq(_qLen-1, _q);
     }
 
 
     template < typename DistroFunctor >
     inline Inverter::Inverter( const DistroFunctor & distro,
                                const double & min, const double & max,
-                               const int & nbins )
-      : L(nbins) {
+                               const int & nbins,
+                               Arena * arena )
+      : L(nbins), q(NULL), arena(arena) {
 
       if (L <= 1) {
         THROW(std::runtime_error,"Inverter needs more than one bin.");
@@ -117,7 +154,7 @@ namespace olson_tools {
       }
 
       /* now we invert the distribution by using the integral. */
-      q = new double[L+1];
+      q = arena ? arena->allocate_array<double>(L+1) : new double[L+1];
       q[0] = min;
       q[L] = max;
       
@@ -129,22 +166,8 @@ namespace olson_tools {
        */
       double dprob = (IntP[L] - IntP[0]) / ((double)L);
 
-      for ( i = 1; i < L; ++i ) {
-        /* the ith probability: */
-        double prob = i*dprob + IntP[0];
-
-        /* find the probability location above this one. */
-        int j = 1;
-        while (j <= L && IntP[j] < prob) j++;
-
-        /* now we use linear interpolation to determine the input value at
-         * this probability.
-         */
-
-        q[i] = (min+(j-1)*dx)
-             + (dx / (IntP[j] - IntP[j-1]))
-               * (prob    - IntP[j-1]);
-      }
+      detail::InvertRange invert = { IntP, q, L, min, dx, dprob };
+      parallel_for( 1, L, 4096, invert );
 
       /* cleanup */
       delete[] IntP;
@@ -152,7 +175,7 @@ namespace olson_tools {
 
 
     inline Inverter::~Inverter() {
-      delete[] q;
+      if (!arena) delete[] q;
     }
 
 
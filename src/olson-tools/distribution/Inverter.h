@@ -83,6 +83,7 @@
 #define olson_tools_distribution_Inverter_h
 
 #include <olson-tools/random/random.h>
+#include <olson-tools/Arena.h>
 
 namespace olson_tools {
   namespace distribution {
@@ -132,13 +133,20 @@ namespace olson_tools {
        *     inversion.
        * @param nbins
        *     Number of bins to use in distribution inversion [Default  100].
+       * @param arena
+       *     If given, the inverted distribution is allocated from this Arena
+       *     instead of the heap.  The arena must outlive the Inverter.
+       *     Assignments to this Inverter keep using the same arena.
+       *     [Default NULL]
        */
       template < typename DistroFunctor >
       inline Inverter( const DistroFunctor & distro,
                        const double & min, const double & max,
-                       const int & nbins = 100 );
+                       const int & nbins = 100,
+                       Arena * arena = NULL );
 
-      /** Destructor frees memory for q-array. */
+      /** Destructor frees memory for q-array (unless it came from an arena).
+       * */
       inline ~Inverter();
 
       /** Get a random number from this distribution.
@@ -191,6 +199,7 @@ namespace olson_tools {
     private:
       int L;
       double * q; /* length L + 1 */
+      Arena * arena; /* where q came from (NULL for the heap) */
     };
 
   }/* namespace olson_tools::distribution */
@@ -39,12 +39,16 @@
 #ifndef olson_tools_field_lookup_h
 #define olson_tools_field_lookup_h
 
+#include <olson-tools/Arena.h>
 #include <olson-tools/SquareMatrix.h>
+#include <olson-tools/SquareMatrixArray.h>
 #include <olson-tools/Vector.h>
+#include <olson-tools/VectorArray.h>
 #include <olson-tools/indices.h>
 #include <olson-tools/ompexcept.h>
 #include <olson-tools/power.h>
 
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -69,14 +73,16 @@ class FieldLookupBase {
   private:
     std::string fname;
     bool initialized;
+    Arena * arena;
 
   public:
     /** Default constructor.
      * Does not initialize the lookup table.
      */
-    FieldLookupBase() : fname(""), initialized(false) {}
+    FieldLookupBase() : fname(""), initialized(false), arena(NULL) {}
 
-    FieldLookupBase(const std::string & filename) : fname(""), initialized(false) {
+    FieldLookupBase(const std::string & filename)
+      : fname(""), initialized(false), arena(NULL) {
         readindata(filename);
     }
 
@@ -103,7 +109,7 @@ class FieldLookupBase {
 
         core_dx_inv  = 1.0; core_dx_inv .compDiv(core_dx);
         core_L_2 = 0.5*compMult((core_N-1).to_type<double>(), core_dx);
-        data[CORE].initialize(core_N[X], core_N[Y], core_N[Z]);
+        data[CORE].initialize(core_N[X], core_N[Y], core_N[Z], arena);
 
 
 #ifndef DISABLE_SHELL_LOOKUP
@@ -119,12 +125,20 @@ class FieldLookupBase {
         }
 
         shell_dx_inv = 1.0; shell_dx_inv.compDiv(shell_dx);
-        data[SHELL].initialize(shell_N[X], shell_N[Y], shell_N[Z]);
+        data[SHELL].initialize(shell_N[X], shell_N[Y], shell_N[Z], arena);
 #endif
     }
 
     const bool & isInitialized() const { return initialized; }
 
+    /** Allocate the tables from the given arena (instead of from the heap)
+     * when they are next initialized, for example to place the core and
+     * shell tables next to each other.  The arena must outlive the tables.
+     * @param a
+     *    The arena (NULL to allocate from the heap).
+     */
+    void set_arena(Arena * a) { arena = a; }
+
     /** this function will allow the user to change the field-file then
      * request a re-read mid-stream.  This is meant to be useful as a trigger
      * point inside a debugger if necessary. */
@@ -137,14 +151,17 @@ class FieldLookupBase {
     class DTable {
       private:
         Record * data;
+        /* the arena from which data came (NULL for the heap). */
+        Arena * arena;
 
       public:
-        inline DTable () : data(NULL), xlen(0), ylen(0),
+        inline DTable () : data(NULL), arena(NULL), xlen(0), ylen(0),
                            zlen(0), xlen_times_ylen(0) {}
 
         inline void initialize (const unsigned int & Nx,
                                 const unsigned int & Ny,
-                                const unsigned int & Nz) {
+                                const unsigned int & Nz,
+                                Arena * a = NULL) {
             cleanup();
 
             xlen = Nx;
@@ -152,13 +169,27 @@ class FieldLookupBase {
             zlen = Nz;
             xlen_times_ylen = Nx*Ny;
 
-            data = new Record[xlen*ylen*zlen];
+            arena = a;
+            if (arena) {
+                const unsigned int n = xlen*ylen*zlen;
+                data = arena->allocate_array<Record>(n);
+                for (unsigned int i = 0; i < n; ++i)
+                    new (data + i) Record();
+            } else
+                data = new Record[xlen*ylen*zlen];
         }
 
         inline void cleanup () {
             if (data) {
-                delete[] data;
+                if (arena) {
+                    /* the memory itself goes back with the arena. */
+                    const unsigned int n = xlen*ylen*zlen;
+                    for (unsigned int i = 0; i < n; ++i)
+                        data[i].~Record();
+                } else
+                    delete[] data;
                 data = NULL;
+                arena = NULL;
             }
 
             xlen = ylen = zlen = xlen_times_ylen = 0;
@@ -193,6 +224,12 @@ class FieldLookupBase {
             return data[zi*(xlen_times_ylen) + xi*ylen + yi];
         }
 
+        inline Record & operator()(const unsigned int & xi,
+                                   const unsigned int & yi,
+                                   const unsigned int & zi) {
+            return data[zi*(xlen_times_ylen) + xi*ylen + yi];
+        }
+
         unsigned int xlen, ylen, zlen, xlen_times_ylen;
     };
 
@@ -322,18 +359,152 @@ class FieldLookupBase {
     }
 };
 
-/** The cartesian field lookup class. */
-template <class Record>
+/** Symmetry policies for FieldLookup. */
+namespace symmetry {
+    /** No symmetry:  the table covers the full domain. */
+    struct None {
+        /** The number of copies of the table needed to cover the domain. */
+        static const unsigned int order = 1u;
+
+        static inline unsigned int fold( Vector<double,3> & /*r*/,
+                                         const Vector<double,3> & /*min*/ ) {
+            return 0u;
+        }
+
+        static inline void unfold( Vector<double,3> & /*v*/,
+                                   const unsigned int & /*flips*/ ) { }
+
+        static inline bool compatible( const Vector<double,3> & /*core_min*/,
+                                       const Vector<double,3> & /*shell_min*/ ) {
+            return true;
+        }
+    };
+
+    /** Mirror symmetry about one or more planes perpendicular to the
+     * coordinate axes.  Only the fundamental domain is stored in the table;
+     * lookups at other positions are reflected into the fundamental domain
+     * and the vector result is reflected back.  Scalar results are taken to
+     * be even under each reflection.
+     *
+     * The mirror planes are the lower faces of the table:  for each mirrored
+     * axis a, the plane is r[a] == core_min[a] and the shell table must start
+     * at the same plane (shell_min[a] == core_min[a]; FieldLookup::readindata
+     * throws otherwise).  Such a table is created by passing the plane as
+     * the minimum to createFieldFile.
+     *
+     * @tparam planes
+     *    Bitmask of the axes normal to the mirror planes (e.g.
+     *    (1u<<Z) for the z=z0 plane of a symmetric coil pair).
+     * @tparam flip_x
+     *    Bitmask of the vector components that change sign on reflection
+     *    through the plane normal to X [Default:  (1u<<X), as for a polar
+     *    vector like E or a force].
+     * @tparam flip_y
+     *    Same as flip_x for the plane normal to Y [Default:  (1u<<Y)].
+     * @tparam flip_z
+     *    Same as flip_x for the plane normal to Z [Default:  (1u<<Z)].
+     *
+     * @see AxialMirror for magnetic (axial vector) fields.
+     */
+    template < unsigned int planes,
+               unsigned int flip_x = (1u<<X),
+               unsigned int flip_y = (1u<<Y),
+               unsigned int flip_z = (1u<<Z) >
+    struct Mirror {
+        static const unsigned int order = 1u << ( ((planes >> X) & 1u) +
+                                                  ((planes >> Y) & 1u) +
+                                                  ((planes >> Z) & 1u) );
+
+        /** Reflect r into the fundamental domain.
+         * @return the bitmask of vector components to negate in unfold.
+         */
+        static inline unsigned int fold( Vector<double,3> & r,
+                                         const Vector<double,3> & min ) {
+            unsigned int flips = 0u;
+            if ( (planes & (1u<<X)) && r[X] < min[X] ) {
+                r[X] = 2.0*min[X] - r[X];
+                flips ^= flip_x;
+            }
+            if ( (planes & (1u<<Y)) && r[Y] < min[Y] ) {
+                r[Y] = 2.0*min[Y] - r[Y];
+                flips ^= flip_y;
+            }
+            if ( (planes & (1u<<Z)) && r[Z] < min[Z] ) {
+                r[Z] = 2.0*min[Z] - r[Z];
+                flips ^= flip_z;
+            }
+            return flips;
+        }
+
+        /** Reflect a vector result back out of the fundamental domain. */
+        static inline void unfold( Vector<double,3> & v,
+                                   const unsigned int & flips ) {
+            if ( flips & (1u<<X) ) v[X] = -v[X];
+            if ( flips & (1u<<Y) ) v[Y] = -v[Y];
+            if ( flips & (1u<<Z) ) v[Z] = -v[Z];
+        }
+
+        /** Whether the core and shell tables start at the same mirror
+         * planes. */
+        static inline bool compatible( const Vector<double,3> & core_min,
+                                       const Vector<double,3> & shell_min ) {
+            for ( unsigned int a = 0; a < 3u; ++a )
+                if ( (planes & (1u<<a)) && shell_min[a] != core_min[a] )
+                    return false;
+            return true;
+        }
+    };
+
+    /** Mirror symmetry of an axial vector field (such as the magnetic field
+     * of a symmetric coil pair):  on reflection through a plane, the normal
+     * component is unchanged while the in-plane components change sign. */
+    template < unsigned int planes >
+    struct AxialMirror : Mirror< planes,
+                                 (1u<<Y) | (1u<<Z),
+                                 (1u<<X) | (1u<<Z),
+                                 (1u<<X) | (1u<<Y) > { };
+}/* namespace symmetry */
+
+/** The cartesian field lookup class.
+ * @tparam Symmetry
+ *    Symmetry policy of the field (see symmetry::Mirror) [Default:
+ *    symmetry::None].  With a mirror symmetry, the table only needs to cover
+ *    the fundamental domain, which reduces the memory by symmetry::order.
+ */
+template <class Record, class Symmetry = symmetry::None>
 class FieldLookup : public FieldLookupBase<Record> {
   public:
     typedef FieldLookupBase<Record> super;
+    typedef Symmetry symmetry_type;
 
     /** Default constructor.
      * Does not initialize the lookup table.
      */
     FieldLookup() : super() {}
 
-    FieldLookup(const std::string & filename) : super(filename) { }
+    FieldLookup(const std::string & filename) : super() {
+        readindata(filename);
+    }
+
+    /** @see FieldLookupBase::rereadindata. */
+    void rereadindata() {
+        readindata();
+    }
+
+  protected:
+    /** Read the table (see FieldLookupBase::readindata) and check that it
+     * suits the symmetry policy. */
+    void readindata(const std::string & filename = "") {
+        super::readindata(filename);
+#ifndef DISABLE_SHELL_LOOKUP
+        if ( !Symmetry::compatible(super::core_min, super::shell_min) ) {
+            THROW(std::runtime_error,"field-lookup::readindata:  "
+                  "shell table does not start at the mirror planes.");
+        }
+#endif
+    }
+
+  public:
 
 
     /** Provide acceleration data from a file source.
@@ -346,7 +517,9 @@ class FieldLookup : public FieldLookupBase<Record> {
         register unsigned int table;
         register unsigned int xi, yi, zi;
         register double xf, yf, zf, xF, yF, zF;
-        getindx(table, xi, xf, yi, yf, zi, zf, r);
+        Vector<double,3> rf = r;
+        const unsigned int flips = Symmetry::fold(rf, super::core_min);
+        getindx(table, xi, xf, yi, yf, zi, zf, rf);
         xF = 1.0 - xf;
         yF = 1.0 - yf;
         zF = 1.0 - zf;
@@ -360,6 +533,7 @@ class FieldLookup : public FieldLookupBase<Record> {
         retval.addFraction(xf*yF*zf, super::data[table](xi+1,yi  ,zi+1).vector(i));
         retval.addFraction(xF*yf*zf, super::data[table](xi  ,yi+1,zi+1).vector(i));
         retval.addFraction(xf*yf*zf, super::data[table](xi+1,yi+1,zi+1).vector(i));
+        Symmetry::unfold(retval, flips);
     }
 
     /** Provide potential data from a file source.
@@ -370,7 +544,9 @@ class FieldLookup : public FieldLookupBase<Record> {
         register unsigned int table;
         register unsigned int xi, yi, zi;
         register double xf, yf, zf, xF, yF, zF;
-        getindx(table, xi, xf, yi, yf, zi, zf, r);
+        Vector<double,3> rf = r;
+        Symmetry::fold(rf, super::core_min);
+        getindx(table, xi, xf, yi, yf, zi, zf, rf);
         xF = 1.0 - xf;
         yF = 1.0 - yf;
         zF = 1.0 - zf;
@@ -385,10 +561,14 @@ class FieldLookup : public FieldLookupBase<Record> {
              + xf*yf*zf * super::data[table](xi+1,yi+1,zi+1).scalar(i);
     }
 
-    /** Obtain the nearest record of the lookup table.  */
-    Record & getRecord( const Vector<double,3> & r,
+    /** Obtain the nearest record of the lookup table.  For a symmetric
+     * table, this is the record nearest to the folded position (the record is
+     * not unfolded). */
+    Record & getRecord( const Vector<double,3> & r_,
                         const enum super::DSECT & table = super::CORE ) {
         register double xf, yf, zf;
+        Vector<double,3> r = r_;
+        Symmetry::fold(r, super::core_min);
 
 #if !defined(NOTRUNCX) || !defined(NOTRUNCY) || !defined(NOTRUNCZ)
         const Vector<int,3> * nmax;
@@ -439,9 +619,14 @@ class FieldLookup : public FieldLookupBase<Record> {
 #endif
 
 #ifndef DISABLE_SHELL_LOOKUP
-        if (fabs(r[X] - super::r0[X]) > super::core_L_2[X] ||
-            fabs(r[Y] - super::r0[Y]) > super::core_L_2[Y] ||
-            fabs(r[Z] - super::r0[Z]) > super::core_L_2[Z]   ) {
+        /* a symmetric table is not centered on r0. */
+        if ( Symmetry::order > 1u ?
+               ( r[X] < super::core_min[X] || r[X] > super::core_max[X] ||
+                 r[Y] < super::core_min[Y] || r[Y] > super::core_max[Y] ||
+                 r[Z] < super::core_min[Z] || r[Z] > super::core_max[Z] )
+             : ( fabs(r[X] - super::r0[X]) > super::core_L_2[X] ||
+                 fabs(r[Y] - super::r0[Y]) > super::core_L_2[Y] ||
+                 fabs(r[Z] - super::r0[Z]) > super::core_L_2[Z] ) ) {
             table = super::SHELL;
             xf = ( (r[X]-super::shell_min[X]) * super::shell_dx_inv[X] );
             yf = ( (r[Y]-super::shell_min[Y]) * super::shell_dx_inv[Y] );
@@ -477,6 +662,56 @@ class FieldLookup : public FieldLookupBase<Record> {
 };
 
 
+namespace detail {
+    /** The type of rotation held by AxiSymFieldLookup::R. */
+    enum AxiSymRotation {
+        /** R is the identity. */
+        AXISYM_R_IDENTITY,
+        /** R is a signed permutation (rotation by multiples of 90 deg). */
+        AXISYM_R_AXIS_ALIGNED,
+        /** R is anything else. */
+        AXISYM_R_GENERAL
+    };
+
+    /** Batched (rho,z) transform for AxiSymFieldLookup (see
+     * detail::batch_apply in SquareMatrixArray.h). */
+    template < int rtype >
+    struct axisym_coords {
+        const double * x[3];
+        double * rho;
+        double * z;
+        const SquareMatrix<double,3> * R;
+        Vector<double,3> r0;
+        unsigned int axes[3];
+        double zsign;
+
+        template < typename Lane >
+        inline void apply( const std::size_t & i ) const {
+            typedef typename Lane::type V;
+            V d[3];
+            for (unsigned int j = 0; j < 3u; ++j)
+                d[j] = Lane::load(x[j] + i) - Lane::set1(r0[j]);
+
+            if ( rtype == AXISYM_R_IDENTITY ) {
+                Lane::store(rho + i, Lane::sqrt(d[X]*d[X] + d[Y]*d[Y]));
+                Lane::store(z   + i, d[Z]);
+            } else if ( rtype == AXISYM_R_AXIS_ALIGNED ) {
+                const V & a = d[axes[0]], & b = d[axes[1]];
+                Lane::store(rho + i, Lane::sqrt(a*a + b*b));
+                Lane::store(z   + i, Lane::set1(zsign) * d[axes[2]]);
+            } else {
+                V rr[3];
+                for (unsigned int j = 0; j < 3u; ++j)
+                    rr[j] = Lane::set1(R->val[j][0]) * d[0]
+                          + Lane::set1(R->val[j][1]) * d[1]
+                          + Lane::set1(R->val[j][2]) * d[2];
+                Lane::store(rho + i, Lane::sqrt(rr[X]*rr[X] + rr[Y]*rr[Y]));
+                Lane::store(z   + i, rr[Z]);
+            }
+        }
+    };
+}/* namespace detail */
+
 /** The axially symmetric field lookup class. */
 template <class Record>
 class AxiSymFieldLookup : public FieldLookupBase<Record> {
@@ -534,12 +769,127 @@ class AxiSymFieldLookup : public FieldLookupBase<Record> {
              + rhof*zf * super::data[table](rhoi+1, 0, zi+1).scalar(i);
     }
 
+    /** Batched version of vector_lookup:  retval[k] = vector_lookup(r[k]).
+     * The (rho,z) coordinates are computed a block at a time with
+     * getRotatedRelativeCoords(r, first, n, rho, z) before interpolating.
+     */
+    inline void vector_lookup(VectorArray<double,3> & retval,
+                              const VectorArray<double,3> & r,
+                              const unsigned int & i) const {
+        static const std::size_t block = 256u;
+        double rho[block], z[block];
+        retval.resize(r.size());
+
+        for (std::size_t k0 = 0; k0 < r.size(); k0 += block) {
+            const std::size_t n = std::min(block, r.size() - k0);
+            getRotatedRelativeCoords(r, k0, n, rho, z);
+            for (std::size_t k = 0; k < n; ++k) {
+                unsigned int table, rhoi, zi;
+                double rhof, zf;
+                getindx(table, rhoi, rhof, zi, zf, rho[k], z[k]);
+                const double rhoF = 1.0 - rhof, zF = 1.0 - zf;
+
+                Vector<double,3> v(0.0);
+                v.addFraction(rhoF*zF, super::data[table](rhoi  , 0, zi  ).vector(i));
+                v.addFraction(rhof*zF, super::data[table](rhoi+1, 0, zi  ).vector(i));
+                v.addFraction(rhoF*zf, super::data[table](rhoi  , 0, zi+1).vector(i));
+                v.addFraction(rhof*zf, super::data[table](rhoi+1, 0, zi+1).vector(i));
+                retval[k0 + k] = v;
+            }
+        }
+    }
+
+    /** Batched version of scalar_lookup:  retval[k] = scalar_lookup(r[k]).
+     * @param retval
+     *    Output array of at least r.size() elements.
+     */
+    inline void scalar_lookup(double * retval,
+                              const VectorArray<double,3> & r,
+                              const unsigned int & i) const {
+        static const std::size_t block = 256u;
+        double rho[block], z[block];
+
+        for (std::size_t k0 = 0; k0 < r.size(); k0 += block) {
+            const std::size_t n = std::min(block, r.size() - k0);
+            getRotatedRelativeCoords(r, k0, n, rho, z);
+            for (std::size_t k = 0; k < n; ++k) {
+                unsigned int table, rhoi, zi;
+                double rhof, zf;
+                getindx(table, rhoi, rhof, zi, zf, rho[k], z[k]);
+                const double rhoF = 1.0 - rhof, zF = 1.0 - zf;
+
+                retval[k0 + k] =
+                       rhoF*zF * super::data[table](rhoi  , 0, zi  ).scalar(i)
+                     + rhof*zF * super::data[table](rhoi+1, 0, zi  ).scalar(i)
+                     + rhoF*zf * super::data[table](rhoi  , 0, zi+1).scalar(i)
+                     + rhof*zf * super::data[table](rhoi+1, 0, zi+1).scalar(i);
+            }
+        }
+    }
+
     /** Rotation matrix INTO the field-lookup frame. */
-    SquareMatrix<double,3> R;
+    const SquareMatrix<double,3> & getR() const { return R; }
+
+    /** Set the rotation matrix INTO the field-lookup frame.
+     * @see rotateField.
+     */
+    void setR( const SquareMatrix<double,3> & r ) {
+        R = r;
+        updateR();
+    }
 
 private:
+    /** Rotation matrix INTO the field-lookup frame (set through setR() or
+     * rotateField() so that R_type stays consistent with it). */
+    SquareMatrix<double,3> R;
+
+    /** Re-examine R to choose the fastest coordinate transform.  Identity
+     * and axis-aligned (signed permutation) rotations skip the full
+     * matrix-vector product.
+     */
+    void updateR() {
+        R_type = detail::AXISYM_R_GENERAL;
+
+        /* find the single nonzero (+-1) element of each row. */
+        for (unsigned int i = 0; i < 3u; ++i) {
+            unsigned int nnz = 0;
+            for (unsigned int j = 0; j < 3u; ++j) {
+                if ( R.val[i][j] == 0.0 )
+                    continue;
+                if ( fabs(R.val[i][j]) != 1.0 )
+                    return;
+                R_axes[i] = j;
+                ++nnz;
+            }
+            if ( nnz != 1u )
+                return;
+        }
+
+        if ( R_axes[X] == R_axes[Y] || R_axes[X] == R_axes[Z] ||
+             R_axes[Y] == R_axes[Z] )
+            return;
+
+        R_zsign = R.val[Z][R_axes[Z]];
+
+        if ( R_axes[X] == X && R_axes[Y] == Y && R_axes[Z] == Z &&
+             R.val[X][X] == 1.0 && R.val[Y][Y] == 1.0 && R_zsign == 1.0 )
+            R_type = detail::AXISYM_R_IDENTITY;
+        else
+            R_type = detail::AXISYM_R_AXIS_ALIGNED;
+    }
+
+    /** The type of rotation held in R (set by updateR()). */
+    detail::AxiSymRotation R_type;
+
+    /** For axis-aligned R:  the source axis of each rotated axis. */
+    unsigned int R_axes[3];
+
+    /** For axis-aligned R:  the sign of the rotated Z axis. */
+    double R_zsign;
+
     inline void defaultR() {
         R = SquareMatrix<double,3U>::identity();
+        updateR();
     }
 
 public:
@@ -579,6 +929,7 @@ public:
         SquareMatrix<double,3> & rz   = *((SquareMatrix<double,3>*)rz_);
 
         R   = ry * rz;
+        updateR();
     }
 
 
@@ -588,9 +939,54 @@ public:
                                           double & rho,
                                           double & z ) const {
 
-        Vector<double,3> r_rel = R * (r - super::r0);
-        rho = sqrt(SQR(r_rel[X]) +  SQR(r_rel[Y]));
-         z = r_rel[Z];
+        switch ( R_type ) {
+            case detail::AXISYM_R_IDENTITY:
+                rho = sqrt( SQR(r[X] - super::r0[X]) + SQR(r[Y] - super::r0[Y]) );
+                z = r[Z] - super::r0[Z];
+                break;
+
+            case detail::AXISYM_R_AXIS_ALIGNED: {
+                const unsigned int & a = R_axes[X], & b = R_axes[Y], & c = R_axes[Z];
+                rho = sqrt( SQR(r[a] - super::r0[a]) + SQR(r[b] - super::r0[b]) );
+                z = R_zsign * (r[c] - super::r0[c]);
+                break;
+            }
+
+            default: {
+                Vector<double,3> r_rel = R * (r - super::r0);
+                rho = sqrt(SQR(r_rel[X]) +  SQR(r_rel[Y]));
+                z = r_rel[Z];
+            }
+        }
+    }
+
+    /** Batched version of getRotatedRelativeCoords for the elements
+     * [first, first+n) of r.  The results are stored in rho[0..n) and
+     * z[0..n).  For doubles, this is vectorized using olson-tools/simd/pd.h
+     * when SSE2 is available.
+     */
+    void getRotatedRelativeCoords( const VectorArray<double,3> & r,
+                                   const std::size_t & first,
+                                   const std::size_t & n,
+                                   double * rho,
+                                   double * z ) const {
+        switch ( R_type ) {
+            case detail::AXISYM_R_IDENTITY:
+                batchCoords< detail::AXISYM_R_IDENTITY >(r, first, n, rho, z);
+                break;
+            case detail::AXISYM_R_AXIS_ALIGNED:
+                batchCoords< detail::AXISYM_R_AXIS_ALIGNED >(r, first, n, rho, z);
+                break;
+            default:
+                batchCoords< detail::AXISYM_R_GENERAL >(r, first, n, rho, z);
+        }
+    }
+
+    /** Batched version of getRotatedRelativeCoords for all of r. */
+    inline void getRotatedRelativeCoords( const VectorArray<double,3> & r,
+                                          double * rho,
+                                          double * z ) const {
+        getRotatedRelativeCoords(r, 0, r.size(), rho, z);
     }
 
 
@@ -632,17 +1028,46 @@ public:
     }
 
   private:
+    template < int rtype >
+    inline void batchCoords( const VectorArray<double,3> & r,
+                             const std::size_t & first,
+                             const std::size_t & n,
+                             double * rho,
+                             double * z ) const {
+        detail::axisym_coords<rtype> k;
+        for (unsigned int j = 0; j < 3u; ++j) {
+            k.x[j] = r.component(j) + first;
+            k.axes[j] = R_axes[j];
+        }
+        k.rho = rho;
+        k.z = z;
+        k.R = &R;
+        k.r0 = super::r0;
+        k.zsign = R_zsign;
+        detail::batch_apply<double>(k, n);
+    }
+
     inline void getindx ( unsigned int & table,
                           unsigned int & rhoi,
                           double       & rhof,
                           unsigned int & zi,
                           double       & zf,
                           const Vector<double,3> & r) const {
+        double rho, z;
+        getRotatedRelativeCoords(r, rho, z);
+        getindx(table, rhoi, rhof, zi, zf, rho, z);
+    }
+
+    inline void getindx ( unsigned int & table,
+                          unsigned int & rhoi,
+                          double       & rhof,
+                          unsigned int & zi,
+                          double       & zf,
+                          const double & rho,
+                          const double & z ) const {
 #if !defined(NOTRUNCX) || !defined(NOTRUNCY) || !defined(NOTRUNCZ)
         const Vector<int,3> * nmax;
 #endif
-        double rho, z;
-        getRotatedRelativeCoords(r, rho, z);
 
 #ifndef DISABLE_SHELL_LOOKUP
         if (rho > super::core_max[RHO] || rho < super::core_min[RHO] ||
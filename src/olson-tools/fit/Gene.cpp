@@ -278,13 +278,14 @@ std::ostream& operator<<(std::ostream &output, const Gene & gene) {
 } // operator<<  Gene
 
 
-Gene::Gene( int nalleles /* = 0 */, Allele_struct alls[] /* = 0 */ ):
-  numalleles(0), alleles(NULL) {
+Gene::Gene( int nalleles /* = 0 */, Allele_struct alls[] /* = 0 */,
+            Arena * arena /* = NULL */ ):
+  numalleles(0), alleles(NULL), arena(arena) {
 
   /* Allocate and assign alleles */
   if( nalleles && alls ) {
     //Allocation
-    alleles = new Allele_struct[numalleles = nalleles];
+    alleles = new_alleles(numalleles = nalleles);
     //Assignment
     for(int i=0;i<nalleles;i++) {
       alleles[i] = alls[i];
@@ -294,11 +295,11 @@ Gene::Gene( int nalleles /* = 0 */, Allele_struct alls[] /* = 0 */ ):
 }// Gene specific constructor
 
 Gene::Gene(const Gene& gn):
-  numalleles(gn.numalleles), alleles(NULL) {
+  numalleles(gn.numalleles), alleles(NULL), arena(NULL) {
 
   if( numalleles ) {
     //Allocation
-    alleles = new Allele_struct[ numalleles ];
+    alleles = new_alleles( numalleles );
     //Assignment
     for(int i=0;i<numalleles;i++) { // copy all of the parts
       alleles[i] = gn.alleles[i];
@@ -307,6 +308,16 @@ Gene::Gene(const Gene& gn):
 
 }//Gene copy constructor
 
+Gene::Gene(const Gene& gn, Arena * arena):
+  numalleles(gn.numalleles), alleles(NULL), arena(arena) {
+
+  if( numalleles ) {
+    alleles = new_alleles( numalleles );
+    for(int i=0;i<numalleles;i++) alleles[i] = gn.alleles[i];
+  }//if
+
+}//Gene copy constructor (with arena)
+
 void Gene::randinit() {
   // initialize gene to random, but valid value
   // init gene randomly
@@ -458,8 +469,8 @@ const Gene & Gene::operator=(const Gene & g2) {
   // allocated space
 
   if(numalleles != g2.numalleles) {
-    delete[] alleles;alleles = NULL;
-    if( (numalleles=g2.numalleles) ) alleles  = new Allele_struct[numalleles];
+    free_alleles();
+    if( (numalleles=g2.numalleles) ) alleles  = new_alleles(numalleles);
   } // reallocate the space for normal alleles
 
   /* now copy over some values */
@@ -477,8 +488,8 @@ void Gene::copy_alleles_from_Gene( const Gene & g2,
   // allocated space
 
   if( numalleles != ( b - a + 1 ) ) {
-    delete alleles; alleles = NULL;
-    if((numalleles = ( b - a + 1 ) )) alleles  = new Allele_struct[numalleles];
+    free_alleles();
+    if((numalleles = ( b - a + 1 ) )) alleles  = new_alleles(numalleles);
   } // reallocate the space for normal alleles
 
   /* now copy over some values */
@@ -490,21 +501,21 @@ const Gene & Gene::operator+=(const Gene & g2) {
   if( !g2.numalleles ) return *this;
   Allele_struct * tmpalleles = alleles;
   int i(0), iter;
-  alleles = new Allele_struct[ iter = (numalleles + g2.numalleles) ];
+  alleles = new_alleles( iter = (numalleles + g2.numalleles) );
   for( ; i < numalleles; i++) alleles[i] = tmpalleles[i];
   for( ; i < iter; i++) alleles[i] = g2.alleles[ i - numalleles ];
   numalleles = iter;
-  delete[] tmpalleles;
+  if ( !arena ) delete[] tmpalleles;
   return *this;
 }//Gene::operator+=
 
 /// Gene add-to operator (with Allele_struct).
 const Gene & Gene::operator+=( const Allele_struct & a ) {
   Allele_struct * tmpalleles = alleles;
-  alleles = new Allele_struct[ numalleles + 1 ];
+  alleles = new_alleles( numalleles + 1 );
   for(int i = 0; i < numalleles; i++) alleles[i] = tmpalleles[i];
   alleles[ numalleles++ ] = a;
-  delete[] tmpalleles;
+  if ( !arena ) delete[] tmpalleles;
   return *this;
 }//Gene::operator+=
 
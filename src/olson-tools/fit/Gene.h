@@ -64,6 +64,7 @@
 #ifndef GENE_H
 #define GENE_H
 #include "io.h" // in and output
+#include <olson-tools/Arena.h>
 
 
 namespace olson_tools{ namespace fit {
@@ -118,13 +119,22 @@ typedef struct Allele_struct {
 */
 class Gene{
  public:
-   ///
-   Gene( int nalleles = 0, Allele_struct alls[] = 0 );
+   /** Constructor.
+    * @param arena
+    *    If given, the alleles are allocated from this Arena instead of the
+    *    heap.  The arena must outlive the Gene.
+    */
+   Gene( int nalleles = 0, Allele_struct alls[] = 0, Arena * arena = NULL );
    ///
    Gene(const Gene& gn);
 
+   /** Copy constructor that allocates the alleles from the given Arena
+    * (if not NULL).  The arena must outlive the Gene.  Assignments to this
+    * Gene keep using the same arena. */
+   Gene(const Gene& gn, Arena * arena);
+
    /** Gene destructor. */
-   ~Gene() { delete[] alleles; }
+   ~Gene() { free_alleles(); }
 
    ///
    void randinit();
@@ -179,6 +189,21 @@ class Gene{
    void copy_alleles_from_Gene( const Gene &, int a = 0, int b = 65355 );
 
  private:
+   /** Allocate n alleles (from the arena if there is one). */
+   Allele_struct * new_alleles( const int & n ) {
+     if ( arena )
+       return arena->construct_array<Allele_struct>(n);
+     else
+       return new Allele_struct[n];
+   }
+
+   /** Free the alleles (which only returns them to the heap if they did not
+    * come from an arena). */
+   void free_alleles() {
+     if ( !arena )
+       delete[] alleles;
+     alleles = NULL;
+   }
 
    ///number of alleles in genes
    int numalleles;
@@ -186,6 +211,9 @@ class Gene{
    /// The alleles.
    Allele_struct *alleles;
 
+   /** The arena from which the alleles are allocated (NULL for the heap). */
+   Arena * arena;
+
 }; // class gene
 
 /** This is basically just a wrapper for the Gene class.
@@ -202,6 +230,10 @@ public:
   /// create chromosome with this gene make-up
   Chromosome(const Gene& cgene) : Gene(cgene) { }
 
+  /** create chromosome with this gene make-up, allocating the alleles from
+   * arena (if not NULL). */
+  Chromosome(const Gene& cgene, Arena * arena) : Gene(cgene, arena) { }
+
   /** mutate gene internally.  Up to n mutations will happen, where n is the
    * number of alleles.
    *
@@ -80,7 +80,7 @@
 #ifdef USE_PTHREAD
 #  include <olson-tools/fit/detail/EvalMeritFunctor.h>
 #  include <olson-tools/fit/detail/LocalFitFunctor.h>
-#  include <olson-tools/PThreadEval.h>
+#  include <olson-tools/parallel_for.h>
 #endif
 
 
@@ -111,8 +111,8 @@ namespace olson_tools{
 
     #ifdef USE_PTHREAD
     template < typename optionsT >
-    olson_tools::PThreadCache
-      Generation<optionsT>::thread_cache = olson_tools::PThreadCache();
+    olson_tools::PThreadCache &
+      Generation<optionsT>::thread_cache = olson_tools::default_pthread_cache();
     #endif
 
     /* *****   end    stopGeneticAlg portion ******* */
@@ -180,14 +180,11 @@ namespace olson_tools{
          * evaluation in its own threads.  Doing so now will cache the result in
          * the individual.  
          */
-        typedef EvalMeritFunctor< typename optionsT::MeritFunctor > Functor;
+        typedef detail::EvalMeritFunctor< typename optionsT::MeritFunctor >
+          Functor;
 
-        olson_tools::PThreadEval< Functor >
-          evaluator(Generation::thread_cache);
-        for ( int i = 0; i < options.population; ++i ) {
-          evaluator.eval( Functor( *member[i] ) );
-        }
-        evaluator.joinAll();
+        olson_tools::parallel_for( 0, int(options.population), 1,
+                                   Functor( member ), thread_cache );
       }
       #endif
 
@@ -259,20 +256,16 @@ namespace olson_tools{
              * the individual.  
              */
             using detail::LocalFitFunctor;
-            using olson_tools::PThreadEval;
 
             typedef LocalFitFunctor<
               typename optionsT::MeritFunctor,
               typename optionsT::LocalFit
             > Functor;
-            PThreadEval<Functor> localFitter(Generation::thread_cache);
-            for ( unsigned int i = 0; i < fit_max_individuals; ++i ) {
-              Functor f( typename optionsT::LocalFit(),
-                         options.localParam,
-                         member[i] );
-              localFitter.eval( f );
-            }
-            localFitter.joinAll();
+            olson_tools::parallel_for( 0, int(fit_max_individuals), 1,
+                                       Functor( typename optionsT::LocalFit(),
+                                                options.localParam,
+                                                member ),
+                                       thread_cache );
           }
           #else
             for ( unsigned int i = 0; i < fit_max_individuals; ++i ) {
@@ -294,7 +287,7 @@ namespace olson_tools{
     template < typename optionsT>
     Generation<optionsT>::Generation( const optionsT & options, const Gene & igene )
       : options(options), gene(igene), bestmerit(0) {
-      member = new_Individual_list( gene, options.population );
+      member = new_Individual_list( gene, options.population, arena );
       assert(member); // member better be point to an Individual pointer
 
       #ifdef USE_PTHREAD
@@ -308,7 +301,7 @@ namespace olson_tools{
     Generation<optionsT>::Generation(const Generation& gen)
       : options(gen.options), gene( gen.gene ), bestmerit( gen.bestmerit )  {
       //cast the gene[-1] to a function of the correct kind
-      member = new_Individual_list( gene, options.population );
+      member = new_Individual_list( gene, options.population, arena );
       for( int i = 0; i < options.population; ++i )
         *member[i] = *gen.member[i];
     } // Generation copy constructor
@@ -317,7 +310,7 @@ namespace olson_tools{
     Generation<optionsT>::Generation(const Generation& gen, int max_individuals)
       : options( gen.options), gene( gen.gene ), bestmerit( gen.bestmerit ) {
       //cast the gene[-1] to a function of the correct kind
-      member = new_Individual_list( gene, options.population );
+      member = new_Individual_list( gene, options.population, arena );
       for( int i = 0; i < max_individuals; ++i )
         *member[i] = *gen.member[i];
     } // Generation partial copy constructor
@@ -343,7 +336,7 @@ namespace olson_tools{
       int nchild = int( options.replace * options.population ); // number of children to create
       int ichild = options.population - nchild; // this is child index in new generation
       Generation chld( *this, ichild ); // make partial copy
-      Individual **parent = new_Individual_list( gene, 2 );
+      Individual **parent = new_Individual_list( gene, 2, chld.arena );
       // now for the new children
       while( ichild < options.population && !stop ){
         // select parents
@@ -392,7 +385,7 @@ namespace olson_tools{
       int nchild = int(options.replace*options.population);// number of children to create
       int ichild=options.population-nchild; // this is the child index in the new generation
       Generation chld(*this,ichild);// make partial copy
-      Individual **children = new_Individual_list( gene, 2 );
+      Individual **children = new_Individual_list( gene, 2, chld.arena );
 
       // now for the new children
       while( ichild < options.population && !stop ) {
@@ -513,7 +506,8 @@ namespace olson_tools{
     template < typename optionsT>
     Individual<typename optionsT::MeritFunctor> **
     Generation<optionsT>::new_Individual_list( const Gene & gn,
-                                               long population ) {
+                                               long population,
+                                               Arena & arena ) {
       /* With the following, we will create an array of pointers
        * each to its own new Individiual, except for the first pointer
        * in the array.  In ilist[0] we will store the value of population
@@ -521,14 +515,23 @@ namespace olson_tools{
        * to the ilist[1] to the user.  We do this, so that, when deleting
        * the list, we can find the size of the population without
        * having it given explicitly to us again. (see delete_Individual_list)
+       *
+       * The list, the Individuals, and their alleles are all placed in one
+       * contiguous piece of the arena.
        */
       if(!population)
         return NULL;//will do nothing for this case
 
-      Individual **ilist = new Individual *[population+1];
+      arena.reserve( sizeof(Individual *) * (population+1)
+                   + ( sizeof(Individual)
+                     + sizeof(Allele_struct) * gn.numAlleles()
+                     + 2 * Arena::default_alignment ) * population );
+
+      Individual **ilist = arena.allocate_array<Individual *>(population+1);
 
       for(long i = 1; i<(population+1);++i)
-        ilist[i] = new Individual( gn );
+        ilist[i] = new (arena.allocate_array<Individual>(1))
+                     Individual( gn, &arena );
 
       ilist[0] = reinterpret_cast<Individual *>(population);
       return ++ilist;
@@ -539,8 +542,7 @@ namespace olson_tools{
       --ilist;
       long population = reinterpret_cast<long>(ilist[0]);
       ++ilist;
-      for(long i = 0; i<population; delete ilist[i++]);
-      delete[] --ilist;
+      for(long i = 0; i<population; ilist[i++]->~Individual());
     } //delete_population_list
 
     template < typename T >
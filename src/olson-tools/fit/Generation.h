@@ -97,7 +97,9 @@ namespace olson_tools{
 
     #ifdef USE_PTHREAD
     private:
-      static olson_tools::PThreadCache thread_cache;
+      /** The threads for the merit evaluations and local fits; this is the
+       * default thread cache, shared with the rest of the library. */
+      static olson_tools::PThreadCache & thread_cache;
     #endif
 
 
@@ -116,6 +118,11 @@ namespace olson_tools{
        * value of the exiting gene. */
       merit_t bestmerit;
 
+      /** Storage for the Individuals of this generation and their alleles,
+       * such that the population lies in a few contiguous chunks and is freed
+       * all at once. */
+      Arena arena;
+
       ///
       Individual **member;
 
@@ -201,7 +208,13 @@ namespace olson_tools{
       ///
       int tselect(merit_t rtot, int skip);
 
-      Individual ** new_Individual_list(const Gene & gn, long population );
+      /** Create a list of population Individuals (and their alleles) in the
+       * given arena. */
+      Individual ** new_Individual_list( const Gene & gn, long population,
+                                         Arena & arena );
+
+      /** Destroy a list created by new_Individual_list.  The memory is
+       * returned when the arena is released. */
       void delete_Individual_list(Individual ** ilist);
     }; // Generation class
 
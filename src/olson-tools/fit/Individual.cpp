@@ -75,6 +75,14 @@ namespace olson_tools{
         meritFunctor() {
     } // Individual constructor
 
+    template < typename MF >
+    inline Individual<MF>::Individual( const Gene & gene, Arena * arena )
+      : DNA( gene, arena ),
+        updatemerit( true ),
+        merit(0),
+        meritFunctor() {
+    } // Individual constructor (with arena)
+
     template < typename MF >
     inline const Individual<MF> &
     Individual<MF>::operator= ( const Individual & ind ) {
@@ -108,6 +108,11 @@ namespace olson_tools{
        */
       inline Individual( const Gene & gene );
 
+      /** Constructor to create specific DNA whose alleles are allocated from
+       * the given Arena (if not NULL).  The arena must outlive the
+       * Individual. */
+      inline Individual( const Gene & gene, Arena * arena );
+
       /// Copy Constructor
       inline Individual(const Individual &);
 
@@ -123,6 +123,8 @@ namespace olson_tools {
         
         //! Return true if x is cached and fill in the function value.
         bool isCached(const Vector & x, Vector & f) {
+          /* This must be exclusive too (no SyncRWLock):  the lookup
+           * rearranges the splay tree underneath. */
           Sync sync;/* auto unlocking syncronize object. */
           return impl->isCached( x, f );
         }
@@ -68,7 +68,6 @@ namespace olson_tools {
           }/* exec() */
         };
 
-        typedef olson_tools::PThreadTaskSet PThreadTaskSet;
 
 
         /* MEMBER STORAGE */
@@ -76,8 +75,8 @@ namespace olson_tools {
         /** Reference to MinFunc functor object. */
         const MinFunc & minFunc;
 
-        PThreadTaskSet queued_tasks;
-        PThreadTaskSet finished_tasks;
+        /** The completion queue of the spawned tasks. */
+        olson_tools::PThreadCompletion completion;
 
 
 
@@ -86,10 +85,18 @@ namespace olson_tools {
       public:
         /** Constuctor for ThreadExecutor. */
         ThreadedExecutor( const MinFunc & minFunc)
-          : minFunc(minFunc), queued_tasks(), finished_tasks() { }
+          : minFunc(minFunc), completion() { }
 
-        /** Destuctor for ThreadExecutor. */
-        virtual ~ThreadedExecutor() { }
+        /** Destuctor for ThreadExecutor.  The spawned tasks report to
+         * completion, so any that are still queued or running are waited for
+         * (and their results discarded) before it is destroyed. */
+        virtual ~ThreadedExecutor() {
+          pthreadCache.waitForAll(completion);
+
+          olson_tools::PThreadTask * t;
+          while ( (t = completion.pop()) != NULL )
+            delete static_cast<Task*>(t);
+        }
 
         /** Returns true if there is a worker free; otherwise, returns false.
          * Since this implementation uses a task queue, we'll always return true.
@@ -99,8 +106,7 @@ namespace olson_tools {
         //! Spawns a point on a free worker and returns true if successful; otherwise, returns false
         virtual bool spawn(const APPSPACK::Vector& x_in, int tag_in) {
           Task * t = new Task( minFunc, x_in, tag_in );
-          queued_tasks.insert(t);
-          pthreadCache.addTask(t);
+          pthreadCache.addTask(t, completion);
           return true;
         }
 
@@ -114,31 +120,9 @@ namespace olson_tools {
           even for successful evaluations, e.g., "success".
         */
         virtual int recv(int& tag_out, APPSPACK::Vector& f_out, std::string& msg_out) {
-          Task * t = NULL;
-
-          if ( finished_tasks.size() > 0 ) {
-            t = static_cast<Task*>( * finished_tasks.begin() );
-            finished_tasks.erase( t );
-
-          } else if ( queued_tasks.size() > 0 ) {
-            PThreadTaskSet finished = pthreadCache.waitForTasks(queued_tasks);
-            {
-              /* let's make sure that we remove the finished tasks from the queue
-               * list */
-              PThreadTaskSet tmp;
-              std::set_difference(queued_tasks.begin(), queued_tasks.end(),
-                                  finished.begin(), finished.end(),
-                                  inserter(tmp, tmp.begin()));
-              queued_tasks.swap(tmp);
-            }
-
-            t = static_cast<Task*>( * finished.begin() );
-            finished.erase( t );
-            /* now add the remaining items to the finished_tasks array for later
-             * retrieval. */
-            finished_tasks.insert( finished.begin(), finished.end() );
-
-          } else {
+          /* the next finished task (waiting if none have finished yet). */
+          Task * t = static_cast<Task*>( pthreadCache.waitForAny(completion) );
+          if ( t == NULL ) {
             msg_out = "no tasks to complete";
             return 0;
           }
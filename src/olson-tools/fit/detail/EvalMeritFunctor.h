@@ -15,18 +15,19 @@ namespace olson_tools {
   namespace fit {
     namespace detail {
 
-      /** Creates merit evaluation tasks that are then executed by
-       * the default thread cache.
+      /** Evaluates (and thereby caches) the merit of a range of the
+       * population; the body of a parallel_for over the population.
        */
       template < typename MF >
       struct EvalMeritFunctor {
-        /** reference to the relevant child. */
-        Individual<MF> & ind;
+        /** The population. */
+        Individual<MF> ** member;
 
-        EvalMeritFunctor( Individual<MF> & ind ) : ind(ind) { }
+        EvalMeritFunctor( Individual<MF> ** member ) : member(member) { }
 
-        void operator() () {
-          static_cast<void>( ind.Merit() );
+        void operator() ( const int & b, const int & e ) const {
+          for ( int i = b; i < e; ++i )
+            static_cast<void>( member[i]->Merit() );
         }
       };
 
@@ -14,32 +14,35 @@ namespace olson_tools {
   namespace fit {
     namespace detail {
 
-      /** Creates merit evaluation tasks that are then executed by
-       * the default thread cache.
+      /** Locally fits a range of the population; the body of a
+       * parallel_for over the population.
        */
       template < typename MF, typename LocalFit >
       struct LocalFitFunctor {
         /* MEMBER STORAGE */
-        /** Local fit instance. */
+        /** Local fit instance (copied for each individual). */
         LocalFit localFit;
 
         /** Local fit parameters. */
         const typename LocalFit::Parameters & params;
 
-        /** reference to the relevant child. */
-        Individual<MF> * ind;
+        /** The population. */
+        Individual<MF> ** member;
 
 
         /* MEMBER FUNCTIONS */
         /** Constructor. */
         LocalFitFunctor( const LocalFit & localFit,
                          const typename LocalFit::Parameters & params,
-                         Individual<MF> * ind )
-          : localFit(localFit), params(params), ind(ind) { }
+                         Individual<MF> ** member )
+          : localFit(localFit), params(params), member(member) { }
 
         /** Functor operation. */
-        void operator() () {
-          localFit( ind, params );
+        void operator() ( const int & b, const int & e ) const {
+          for ( int i = b; i < e; ++i ) {
+            LocalFit fit(localFit);
+            fit( member[i], params );
+          }
         }
       };
 
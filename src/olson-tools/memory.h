@@ -56,6 +56,11 @@
  * operators to manage memory usage.  This file provides a way to create a
  * cache of memory chunks so-as to avoid using the system alloc() and free()
  * functions.
+ *
+ * Each thread keeps a small cache (a "magazine") of free chunks in front of
+ * the shared free list of the class, such that most allocations and
+ * deallocations need no lock.  Chunks move between the magazine and the
+ * shared list in batches of REDEF_NEW_DEL_BATCH.
  * */
 
 /** \example testmemory.cpp
@@ -66,9 +71,239 @@
 #define MEMORY_GOO
 
 #include <olson-tools/SyncLock.h>
+#include <olson-tools/tls.h>
 
 #include <stdlib.h>
 
+#if defined(USE_PTHREAD)
+#  include <pthread.h>
+#endif
+
+/** The number of chunks moved at a time between the per-thread magazines and
+ * the shared free list (a magazine holds at most twice this number). */
+#ifndef REDEF_NEW_DEL_BATCH
+#  define REDEF_NEW_DEL_BATCH 32
+#endif
+
+/* The per-thread magazines are thread-local only when threads are in use. */
+#if defined(THREAD_SYS_DEFINED)
+#  define REDEF_NEW_DEL_TLS OLSON_TOOLS_TLS
+#else
+#  define REDEF_NEW_DEL_TLS
+#endif
+
+namespace olson_tools {
+
+  /** Allocation statistics of a class that uses REDEF_NEW_DEL_H.  The
+   * counts of each thread are added in whenever the thread exchanges a
+   * batch with the shared list (and for the calling thread, when the
+   * statistics are requested).
+   */
+  struct FreeListStats {
+    /** Allocations taken from the magazine of the thread. */
+    long hits;
+    /** Allocations that found the magazine of the thread empty. */
+    long misses;
+    /** Misses that also found the shared list empty (and used malloc). */
+    long heap_allocs;
+    /** Chunks given back to the heap (the shared list was full). */
+    long heap_frees;
+    /** The number of chunks in the shared list. */
+    int freelistsz;
+    /** The largest number of chunks that were in the shared list. */
+    int high_water;
+  };
+
+  /** The implementation of the operators of REDEF_NEW_DEL_H for class T.
+   * The shared free list (T::freelist, protected by T::syncLock) is as
+   * before; the magazines are in front of it.
+   */
+  template < typename T >
+  struct FreeListCache {
+    /* TYPEDEFS */
+    /** The per-thread cache of free chunks. */
+    struct Magazine {
+      T * head;
+      int size;
+      long hits, misses;
+      bool registered;
+    };
+
+    static const int batch = REDEF_NEW_DEL_BATCH;
+
+
+    /* STATIC STORAGE */
+    static REDEF_NEW_DEL_TLS Magazine magazine;
+
+    /** Protected by T::syncLock. */
+    static FreeListStats shared;
+
+#if defined(USE_PTHREAD)
+    /** Returns the magazine of a thread to the shared list when the thread
+     * exits. */
+    static pthread_key_t exit_key;
+    static pthread_once_t exit_once;
+
+    static void make_exit_key() {
+      pthread_key_create(&exit_key, &thread_exit);
+    }
+
+    static void thread_exit( void * m ) {
+      Magazine & mag = *static_cast<Magazine*>(m);
+      T::syncLock.lock();
+      flush(mag, mag.size);
+      T::syncLock.unlock();
+    }
+#endif
+
+    /** Make sure that the magazine of this thread is returned when the
+     * thread exits (once the thread has touched the magazine at all). */
+#if defined(USE_PTHREAD)
+    static inline void register_exit( Magazine & m ) {
+      if ( !m.registered ) {
+        pthread_once(&exit_once, &make_exit_key);
+        pthread_setspecific(exit_key, &m);
+        m.registered = true;
+      }
+    }
+#else
+    static inline void register_exit( Magazine & ) { }
+#endif
+
+
+    /* STATIC FUNCTIONS */
+    /** Add the counts of the magazine to shared (lock must be held). */
+    static inline void fold( Magazine & m ) {
+      shared.hits += m.hits;
+      shared.misses += m.misses;
+      m.hits = m.misses = 0;
+    }
+
+    /** Move n chunks from the magazine to the shared list, or to the heap
+     * once the shared list is full (lock must be held). */
+    static void flush( Magazine & m, int n ) {
+      fold(m);
+      for ( ; n > 0 && m.head; --n ) {
+        T * p = m.head;
+        m.head = p->_new_next;
+        --m.size;
+        if ( T::freelistsz >= T::freelistlimit ) {
+          free(p);
+          ++shared.heap_frees;
+        } else {
+          p->_new_next = T::freelist;
+          T::freelist = p;
+          ++T::freelistsz;
+        }
+      }
+      if ( T::freelistsz > shared.high_water )
+        shared.high_water = T::freelistsz;
+    }
+
+    static inline void * allocate( size_t sz ) {
+      Magazine & m = magazine;
+      if ( m.head ) {
+        T * p = m.head;
+        m.head = p->_new_next;
+        --m.size;
+        ++m.hits;
+        return p;
+      }
+
+      ++m.misses;
+      register_exit(m);
+
+      /* refill the magazine from the shared list. */
+      T * p = NULL;
+      int n = 0;
+      T::syncLock.lock();
+      fold(m);
+      for ( ; n < batch && T::freelist; ++n ) {
+        T * q = T::freelist;
+        T::freelist = q->_new_next;
+        --T::freelistsz;
+        q->_new_next = p;
+        p = q;
+      }
+      if ( p == NULL )
+        ++shared.heap_allocs;
+      T::syncLock.unlock();
+
+      if ( p == NULL )
+        return malloc(sz);
+
+      /* keep the first for the caller. */
+      m.head = p->_new_next;
+      m.size = n - 1;
+      return p;
+    }
+
+    static inline void release( void * vp ) {
+      if ( vp == NULL )
+        return;
+      Magazine & m = magazine;
+      register_exit(m);
+      T * p = static_cast<T*>(vp);
+      p->_new_next = m.head;
+      m.head = p;
+      if ( ++m.size >= 2 * batch ) {
+        T::syncLock.lock();
+        flush(m, batch);
+        T::syncLock.unlock();
+      }
+    }
+
+    /** Free the magazine of the calling thread and the shared list to the
+     * heap.  The magazines of other threads (at most 2*batch chunks each)
+     * are not reachable; they go to the shared list when those threads
+     * exit (with USE_PTHREAD) or are reused by those threads. */
+    static void freetoheap( const int & new_memlimit, const int & memlimit ) {
+      Magazine & m = magazine;
+      T::syncLock.lock();
+      fold(m);
+      while ( m.head ) {
+        T * p = m.head;
+        m.head = p->_new_next;
+        free(p);
+      }
+      m.size = 0;
+      while ( T::freelist ) {
+        T * p = T::freelist;
+        T::freelist = p->_new_next;
+        free(p);
+      }
+      T::freelistsz = 0;
+      T::freelistlimit = ( new_memlimit < 0 ) ? memlimit : new_memlimit;
+      T::syncLock.unlock();
+    }
+
+    static FreeListStats stats() {
+      T::syncLock.lock();
+      fold(magazine);
+      FreeListStats s = shared;
+      s.freelistsz = T::freelistsz;
+      T::syncLock.unlock();
+      return s;
+    }
+  };
+
+  template < typename T >
+  REDEF_NEW_DEL_TLS typename FreeListCache<T>::Magazine
+    FreeListCache<T>::magazine = { NULL, 0, 0, 0, false };
+
+  template < typename T >
+  FreeListStats FreeListCache<T>::shared = { 0, 0, 0, 0, 0, 0 };
+
+#if defined(USE_PTHREAD)
+  template < typename T >
+  pthread_key_t FreeListCache<T>::exit_key;
+
+  template < typename T >
+  pthread_once_t FreeListCache<T>::exit_once = PTHREAD_ONCE_INIT;
+#endif
+
+}/* namespace olson_tools */
+
 /** Memory Storage Implementation.
  * This begins the overloading of the new and delete operators.  This must be
  * used inside the class declaration which matches the class parameter.
@@ -76,6 +311,7 @@
  * The following are overloaded so that we can use a freestore
  * type list where unused already allocated individuals
  * can live to await the time when their use will be needed again
+ * (see olson_tools::FreeListCache).
  *
  * @param class The name of the class for which the new and delete operators
  *     are being overloaded.
@@ -85,38 +321,11 @@
 #define REDEF_NEW_DEL_H(class) \
   public: \
     inline void* operator new(size_t sz) { \
-	/* get free node from freelist if any */ \
-        syncLock.lock(); \
-	if (freelist) { \
-	    /* cerr<< #class <<"::new: returning from free list\n"; */ \
-	    class* p = freelist; \
-	    freelist = freelist->_new_next; \
-	    freelistsz--; \
-            syncLock.unlock(); \
-	    /* cerr<<#class<<": freelistsz = "<<freelistsz<<endl; */ \
-	    return p; \
-	}   \
-        syncLock.unlock(); \
-	/* call malloc() otherwise */ \
-	/* cerr<< #class <<"::new: Allocating memory\n"; */ \
-	return malloc(sz); \
+        return olson_tools::FreeListCache< class >::allocate(sz); \
     } \
  \
     inline void operator delete(void* vp) { \
-	class* p = (class*)vp; \
-        syncLock.lock(); \
-	if( freelistsz >= freelistlimit ) { \
-	    free( p ); \
-	}/* if */ \
-	else { \
-	    /* link freed node onto freelist */ \
-	    /* cerr<< #class <<"::delete: linking to free list\n"; */ \
-	    p->_new_next = freelist; \
-	    freelist = p; \
-	    freelistsz++; \
-	    /* cerr<<#class<<": freelistsz = "<<freelistsz<<endl; */ \
-	}/* else */ \
-        syncLock.unlock(); \
+        olson_tools::FreeListCache< class >::release(vp); \
     } /* class::operator delete() */ \
  \
   /** frees freelist back to heap.  \
@@ -125,8 +334,14 @@
    *     (below) is used). \
    */ \
   static void freetoheap( int new_memlimit = -1 ); \
+ \
+  /** Allocation statistics of this class. */ \
+  static olson_tools::FreeListStats freeliststats() { \
+      return olson_tools::FreeListCache< class >::stats(); \
+  } \
   \
 private: \
+  friend struct olson_tools::FreeListCache< class >; \
   static olson_tools::SyncLock syncLock; \
   static class *freelist; /* free-store for stuff already allocated */ \
   static int freelistsz; /* will store the size of the freelist */ \
@@ -159,16 +374,7 @@ template olson_tools::SyncLock class::syncLock = olson_tools::SyncLock(); \
  \
 template void class::freetoheap( int new_memlimit /* = -1 */) { \
   /* cerr<< #class <<"::freetoheap: This was called\n"; */ \
-  syncLock.lock(); \
-  if(freelist) { \
-    for(int i = 0;i<freelistsz;i++) { \
-       class* tmp = freelist;freelist=freelist->_new_next; \
-       free(tmp);tmp = NULL; \
-    } \
-    freelistsz = 0; \
-  } \
-  freelistlimit = ( new_memlimit < 0 ) ? memlimit : new_memlimit; \
-  syncLock.unlock(); \
+  olson_tools::FreeListCache< class >::freetoheap( new_memlimit, memlimit ); \
 } /* freetoheap */
 
 
@@ -178,4 +384,3 @@ template void class::freetoheap( int new_memlimit /* = -1 */) { \
 #define REDEF_NEW_DEL_C(class,memlimit) REDEF_NEW_DEL_C_TEMPLATE(,class,memlimit)
 
 #endif /* MEMORY_GOO */
-
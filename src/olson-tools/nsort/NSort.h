@@ -2,36 +2,169 @@
 #define olson_tools_nsort_NSort_h
 
 #include <olson-tools/nsort/map/direct.h>
+#include <olson-tools/nsort/map/static_number_values.h>
 #include <olson-tools/nsort/tweak/Null.h>
+#include <olson-tools/nsort/detail/keys.h>
+#include <olson-tools/nsort/detail/parallel.h>
+#include <olson-tools/nsort/detail/scatter.h>
 #include <olson-tools/ref_of.h>
 
+#include <boost/type_traits/is_same.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ostream>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <memory>
+#include <new>
 
 namespace olson_tools {
   namespace nsort {
 
-    /** 
+    /**
      *  This is not necessarily a stable sort.
      * @param n_values
      *     The number of integer values expected in the list to sort.
+     * @param cache_keys
+     *     Whether to evaluate the map only once per element [Default false].
+     *     See set_cache_keys(bool).
      *
      * Note that this function does NOT check for overruns in the expected values.
+     *
+     * Besides the serial sort(...), there are two multithreaded variants that
+     * give the same begin(i)/end(i)/size(i) results:
+     *  - sort_parallel(...):  each thread counts its own chunk, a global
+     *    prefix sum gives each thread its write offsets and the threads
+     *    scatter into a scratch buffer which is then copied back.  This is a
+     *    stable sort, but requires a copy of the list.
+     *  - sort_parallel_inplace(...):  the counting is the same, but the
+     *    permutation is done in place with the speculative permute and repair
+     *    rounds of the PARADIS algorithm (Cho et al., VLDB 2015).
+     *
+     * The threads come from the default PThreadCache when compiled with
+     * USE_PTHREAD, or from OpenMP (see detail/parallel.h).
+     *
+     * For lists that change only a little between sorts (such as particles
+     * that move between cells in a timestep), resort(...) moves only the
+     * elements whose values changed.
+     *
+     * For large numbers of values (such as w_species over a fine grid), the
+     * serial sort(...) runs as an in-place MSD radix sort over digits of at
+     * most radix_bits bits (see set_radix_threshold(int)).
      */
     template < typename val_map = map::direct,
                typename NSortTweaker = tweak::Null >
     class NSort {
+    public:
+      /** The number of values of val_map if it is known at compile time and
+       * small enough to keep the bins inside of the NSort object (0
+       * otherwise).  For such maps (such as _3D), an NSort constructed with
+       * n_values == fixed_values keeps its bins in a fixed-size array and the
+       * serial sort runs its loops over the bins with a constant trip
+       * count. */
+      static const int fixed_values =
+        ( map::static_number_values<val_map>::value <= 256
+          ? map::static_number_values<val_map>::value : 0 );
+
+      /** The largest number of bits per digit of the radix sort.  The
+       * digits are chosen as equal as possible, such that 2^17 values are
+       * sorted with two digits of 8 and 9 bits. */
+      static const int radix_bits = 11;
+
+      /** Buckets of the radix sort with at most this many elements are
+       * insertion-sorted by the whole key instead of by the next digit. */
+      static const int radix_small = 24;
+
     private:
       int n_values;
+
+      /** The bin end positions. */
       int * bin;
 
+      /** The scratch write positions (next to bin[]). */
+      int * ptr;
+
+      /** The storage for bin and ptr if n_values == fixed_values. */
+      int fixed_store[ fixed_values > 0 ? 2 * fixed_values : 1 ];
+
+      /** Whether the sorts cache the map values in a key array. */
+      bool cache_keys;
+
+      /** The key array (of key_size() bytes per key). */
+      void * key_store;
+
+      /** The size (in bytes) of key_store. */
+      size_t key_bytes;
+
+      /** The number of valid keys in key_store. */
+      int n_keys;
+
+      /** The length of the list described by bin[] (-1 if none). */
+      int n_sorted;
+
+      /** See set_radix_threshold(int). */
+      int radix_threshold;
+
+      /** Scratch space of the parallel sorts, kept between calls. */
+      std::vector<int> par_offsets, par_head, par_tail, par_fill;
+
+      /** Staging buffers of the write-combining scatter (one region per
+       * chunk), kept between calls.  This is left uninitialized:  only the
+       * filled part of each staging buffer is ever written out.  This is the
+       * pointer returned by malloc; the buffers themselves start at the next
+       * cache line (see reserve_stage). */
+      void * par_stage;
+
+      /** The size (in bytes) of par_stage (less the alignment padding). */
+      size_t par_stage_bytes;
+
+      /** Per-digit counts and positions of the radix sort. */
+      std::vector<int> radix_store;
+
     public:
-      NSort(const int & n_values) : n_values (n_values) {
-        bin = new int[n_values];
+      NSort(const int & n_values, const bool & cache_keys = false)
+        : n_values (n_values), cache_keys(cache_keys), key_store(NULL),
+          key_bytes(0), n_keys(0), n_sorted(-1), radix_threshold(0x10000),
+          par_stage(NULL), par_stage_bytes(0) {
+        allocate();
+      }
+
+      /** Copy constructor.  The bins are copied, but not the key cache (or
+       * any other scratch space). */
+      NSort(const NSort & that)
+        : n_values (that.n_values), cache_keys(that.cache_keys),
+          key_store(NULL), key_bytes(0), n_keys(0), n_sorted(that.n_sorted),
+          radix_threshold(that.radix_threshold),
+          par_stage(NULL), par_stage_bytes(0) {
+        allocate();
+        std::copy(that.bin, that.bin + n_values, bin);
+      }
+
+      NSort & operator= (const NSort & that) {
+        if ( this != &that ) {
+          NSort tmp(that);
+          deallocate();
+          n_values = tmp.n_values;
+          cache_keys = tmp.cache_keys;
+          n_sorted = tmp.n_sorted;
+          radix_threshold = tmp.radix_threshold;
+          n_keys = 0;
+          allocate();
+          std::copy(tmp.bin, tmp.bin + n_values, bin);
+        }
+        return *this;
       }
 
       ~NSort() {
-        delete[] bin;
+        deallocate();
+        free(key_store);
+        free(par_stage);
       }
 
       /** Get the number of bins/values used in this sort. */
@@ -60,6 +193,81 @@ namespace olson_tools {
        * Only valid after sort(...) has been called. */
       inline int size(const int & i) const { return end(i) - begin(i); }
 
+
+      /* **** BEGIN KEY CACHE **** { */
+
+      /** Enable/disable key caching.  With key caching, all of the sorts
+       * evaluate the map exactly once per element (storing the result in a
+       * compact key array) and run the permutation off of the key array
+       * instead of calling the map again for every swap.  This pays off for
+       * maps that cost more than the swap (such as w_species<_3D<...>> or maps
+       * that compute cell indices).  The key array follows the elements and
+       * stays available after the sort (see key(i) and keys<KeyT>()).
+       * */
+      inline void set_cache_keys(const bool & c) { cache_keys = c; }
+
+      /** Whether key caching is enabled. */
+      inline const bool & get_cache_keys() const { return cache_keys; }
+
+      /** The number of bytes per cached key (1, 2 or 4), chosen as the
+       * smallest that can hold n_values different values. */
+      inline int key_size() const {
+        if ( n_values <= 0x100 )        return 1;
+        else if ( n_values <= 0x10000 ) return 2;
+        else                            return 4;
+      }
+
+      /** The number of keys currently cached (the length of the last list
+       * sorted if key caching was enabled for that sort, otherwise 0). */
+      inline const int & number_keys() const { return n_keys; }
+
+      /** The cached key of the element at position i of the last list sorted
+       * with key caching enabled. */
+      inline int key(const int & i) const {
+        switch ( key_size() ) {
+          case 1:  return static_cast<const uint8_t *>(key_store)[i];
+          case 2:  return static_cast<const uint16_t*>(key_store)[i];
+          default: return static_cast<const uint32_t*>(key_store)[i];
+        }
+      }
+
+      /** Direct access to the key array.
+       * @return NULL if sizeof(KeyT) does not match key_size().
+       */
+      template < typename KeyT >
+      inline const KeyT * keys() const {
+        if ( sizeof(KeyT) != static_cast<unsigned int>(key_size()) )
+          return NULL;
+        return static_cast<const KeyT*>(key_store);
+      }
+
+      /* **** END KEY CACHE **** } */
+
+
+      /** Set the number of values above which the serial sort(...) is done
+       * as a multi-pass MSD radix sort instead of a single counting pass.
+       * The single pass keeps one counter (and one write position) per
+       * value; once these no longer fit in the cache, every element costs a
+       * cache miss for the count and another for the swap.  The radix sort
+       * first partitions the list by the leading digit (at most 2^radix_bits
+       * buckets) and then each bucket by the next digit, such that the
+       * counters always fit in the L1 cache.  The result (the list and
+       * begin(i)/end(i)) is that of the single pass sort.  Combine with key
+       * caching to evaluate the map only once per element.
+       *
+       * The radix sort is not used when the tweaker might change the map
+       * (the tweaker needs the counts of all values before the first
+       * permutation).
+       *
+       * @param n
+       *    0 disables the radix sort.  [Default 65536]
+       */
+      inline void set_radix_threshold(const int & n) { radix_threshold = n; }
+
+      /** See set_radix_threshold(int). */
+      inline const int & get_radix_threshold() const { return radix_threshold; }
+
+
       template <class Iter>
       void sort(const Iter & Ai, const Iter & Af,
                 const val_map & map = val_map(),
@@ -72,45 +280,1062 @@ namespace olson_tools {
       template <class Iter>
       void sort(const Iter & Ai, const Iter & Af,
                 val_map & map, NSortTweaker & nsortTweaker ) {
-        int * ptr = new int[n_values];
+        serial_job job(*this, Af - Ai, nsortTweaker);
+        with_keys(Ai, Af - Ai, map, job);
+      }/*sort()*/
 
-        memset(bin, 0, sizeof(int)*n_values);
-        memset(ptr, 0, sizeof(int)*n_values);
+
+      /** Multithreaded, stable, out-of-place version of sort.
+       * @param nthreads
+       *    The number of threads to use.  [Default 0:  use all available
+       *    threads for large lists.]
+       */
+      template <class Iter>
+      void sort_parallel(const Iter & Ai, const Iter & Af,
+                         const val_map & map = val_map(),
+                         const NSortTweaker & nsortTweaker = NSortTweaker(),
+                         const int & nthreads = 0) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        sort_parallel(Ai,Af,mapcopy,tweakcopy,nthreads);
+      }
+
+      template <class Iter>
+      void sort_parallel(const Iter & Ai, const Iter & Af,
+                         val_map & map, NSortTweaker & nsortTweaker,
+                         const int & nthreads = 0) {
+        const int n = Af - Ai;
+        parallel_copy_job job(*this, n, detail::n_chunks(n, nthreads),
+                              nsortTweaker);
+        with_keys(Ai, n, map, job);
+      }
+
+
+      /** Multithreaded, in-place version of sort.
+       * @param nthreads
+       *    The number of threads to use.  [Default 0:  use all available
+       *    threads for large lists.]
+       */
+      template <class Iter>
+      void sort_parallel_inplace(const Iter & Ai, const Iter & Af,
+                                 const val_map & map = val_map(),
+                                 const NSortTweaker & nsortTweaker = NSortTweaker(),
+                                 const int & nthreads = 0) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        sort_parallel_inplace(Ai,Af,mapcopy,tweakcopy,nthreads);
+      }
+
+      template <class Iter>
+      void sort_parallel_inplace(const Iter & Ai, const Iter & Af,
+                                 val_map & map, NSortTweaker & nsortTweaker,
+                                 const int & nthreads = 0) {
+        const int n = Af - Ai;
+        parallel_swap_job job(*this, n, detail::n_chunks(n, nthreads),
+                              nsortTweaker);
+        with_keys(Ai, n, map, job);
+      }
+
+
+      /** Stable, out-of-place sort of [Ai, Af) into [Oi, Oi + (Af - Ai)).
+       * The input is left unchanged.  When Oi is a pointer to POD elements,
+       * the elements are scattered with software write-combining:  each
+       * thread collects the elements of each bin in a small staging buffer
+       * and writes full buffers at once, using streaming (non-temporal)
+       * stores when the destination is much larger than the cache.
+       *
+       * With key caching enabled, the cached keys describe the output list.
+       *
+       * @param perm
+       *    If not NULL, perm[j] is set to the index (relative to Ai) of the
+       *    element that was written to Oi[j].
+       * @param nthreads
+       *    The number of threads to use.  [Default 0:  use all available
+       *    threads for large lists.]
+       */
+      template <class Iter, class Out>
+      void sort_copy(const Iter & Ai, const Iter & Af, const Out & Oi,
+                     int * perm = NULL,
+                     const val_map & map = val_map(),
+                     const NSortTweaker & nsortTweaker = NSortTweaker(),
+                     const int & nthreads = 0) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        sort_copy(Ai,Af,Oi,perm,mapcopy,tweakcopy,nthreads);
+      }
+
+      template <class Iter, class Out>
+      void sort_copy(const Iter & Ai, const Iter & Af, const Out & Oi,
+                     int * perm, val_map & map, NSortTweaker & nsortTweaker,
+                     const int & nthreads = 0) {
+        const int n = Af - Ai;
+        copy_job<Out> job(*this, n, detail::n_chunks(n, nthreads),
+                          nsortTweaker, Oi, perm);
+        with_keys(Ai, n, map, job);
+        /* the bins describe the output list, not [Ai, Af). */
+        n_sorted = -1;
+      }
+
+      /** Stable sort of the indices of [Ai, Af) only:  the list itself is
+       * not changed, but perm[j] is set to the index (relative to Ai) of the
+       * element that belongs at position j of the sorted list, and begin(i),
+       * end(i) are set as for the other sorts.  This is useful for large
+       * records, or for records that are stored in several parallel arrays
+       * (see Gather in gather.h for applying the permutation).
+       *
+       * With key caching enabled, the cached keys describe the sorted list.
+       *
+       * @param perm
+       *    Output array of length (Af - Ai).
+       * @param nthreads
+       *    The number of threads to use.  [Default 0:  use all available
+       *    threads for large lists.]
+       */
+      template <class Iter>
+      void sort_index(const Iter & Ai, const Iter & Af, int * perm,
+                      const val_map & map = val_map(),
+                      const NSortTweaker & nsortTweaker = NSortTweaker(),
+                      const int & nthreads = 0) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        sort_index(Ai,Af,perm,mapcopy,tweakcopy,nthreads);
+      }
+
+      template <class Iter>
+      void sort_index(const Iter & Ai, const Iter & Af, int * perm,
+                      val_map & map, NSortTweaker & nsortTweaker,
+                      const int & nthreads = 0) {
+        const int n = Af - Ai;
+        index_job job(*this, n, detail::n_chunks(n, nthreads),
+                      nsortTweaker, perm);
+        with_keys(Ai, n, map, job);
+        /* the bins describe the permuted list, not [Ai, Af). */
+        n_sorted = -1;
+      }
+
+      /** Stable sort of v through buffer:  v is sorted into buffer (see
+       * sort_copy) and then the two are swapped.  Keeping the buffer around
+       * between calls avoids reallocating it.
+       */
+      template <class T, class Alloc>
+      void sort_swap(std::vector<T,Alloc> & v, std::vector<T,Alloc> & buffer,
+                     const val_map & map = val_map(),
+                     const NSortTweaker & nsortTweaker = NSortTweaker(),
+                     const int & nthreads = 0) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        sort_swap(v,buffer,mapcopy,tweakcopy,nthreads);
+      }
+
+      template <class T, class Alloc>
+      void sort_swap(std::vector<T,Alloc> & v, std::vector<T,Alloc> & buffer,
+                     val_map & map, NSortTweaker & nsortTweaker,
+                     const int & nthreads = 0) {
+        buffer.resize(v.size());
+        if ( v.empty() ) {
+          sort(v.begin(), v.end(), map, nsortTweaker);
+          return;
+        }
+        sort_copy(&v[0], &v[0] + v.size(), &buffer[0], NULL, map,
+                  nsortTweaker, nthreads);
+        v.swap(buffer);
+        /* the output list is now v. */
+        n_sorted = v.size();
+      }
+
+
+      /** Incremental re-sort of a list that has been changed since the last
+       * sort (of any kind) of a list of the same length.  Since the element at
+       * position j of a sorted list has the value of the bin containing j, the
+       * map is only compared against the previous bin boundaries and only the
+       * elements whose value changed (and the elements that end up on the
+       * wrong side of the shifted bin boundaries) are moved.  The moves are
+       * swaps between these positions only; the rest of the list is not
+       * touched.
+       *
+       * This is not a stable sort.  The tweaker is only used by the full sort.
+       *
+       * @param max_moved
+       *    The largest fraction of elements that may have changed values for
+       *    the incremental sort to be used.  Beyond this (or if the length
+       *    differs from that of the last sort), a full sort(...) is done.
+       *    [Default 0.1]
+       * @return
+       *    true if the incremental sort was used.
+       */
+      template <class Iter>
+      bool resort(const Iter & Ai, const Iter & Af,
+                  const val_map & map = val_map(),
+                  const NSortTweaker & nsortTweaker = NSortTweaker(),
+                  const double & max_moved = 0.1) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        return resort(Ai,Af,mapcopy,tweakcopy,max_moved);
+      }
+
+      template <class Iter>
+      bool resort(const Iter & Ai, const Iter & Af,
+                  val_map & map, NSortTweaker & nsortTweaker,
+                  const double & max_moved = 0.1) {
+        const int n = Af - Ai;
+        if ( n == n_sorted && n > 0 ) {
+          const int limit = static_cast<int>(max_moved * n);
+          detail::map_keys<Iter,val_map> keys(Ai, map);
+          std::vector<moved> mv;
+
+          bool small = true;
+          for (int i = 0; i < n_values && small; ++i) {
+            for (int j = begin(i), e = end(i); j < e; ++j) {
+              const int k = keys(j);
+              if ( k == i )
+                continue;
+              if ( static_cast<int>(mv.size()) >= limit ) {
+                small = false;
+                break;
+              }
+              mv.push_back( moved(j, i, k) );
+            }
+          }
+
+          if ( small ) {
+            resort_moved(Ai, mv);
+            return true;
+          }
+        }
+
+        sort(Ai, Af, map, nsortTweaker);
+        return false;
+      }
+
+      /** Incremental re-sort as above, but only the elements at the positions
+       * [Ci, Cf) are checked for changed values.  Use this when the caller
+       * already knows which elements may have changed; all other elements
+       * must still have the value that they were sorted by.  The positions
+       * need not be ordered or unique.
+       */
+      template <class Iter, class CIter>
+      bool resort(const Iter & Ai, const Iter & Af,
+                  const CIter & Ci, const CIter & Cf,
+                  const val_map & map = val_map(),
+                  const NSortTweaker & nsortTweaker = NSortTweaker(),
+                  const double & max_moved = 0.1) {
+        val_map mapcopy = map;
+        NSortTweaker tweakcopy = nsortTweaker;
+        return resort(Ai,Af,Ci,Cf,mapcopy,tweakcopy,max_moved);
+      }
+
+      template <class Iter, class CIter>
+      bool resort(const Iter & Ai, const Iter & Af,
+                  const CIter & Ci, const CIter & Cf,
+                  val_map & map, NSortTweaker & nsortTweaker,
+                  const double & max_moved = 0.1) {
+        const int n = Af - Ai;
+        if ( n == n_sorted && n > 0 ) {
+          std::vector<int> pos(Ci, Cf);
+          std::sort(pos.begin(), pos.end());
+          pos.erase( std::unique(pos.begin(), pos.end()), pos.end() );
+
+          const int limit = static_cast<int>(max_moved * n);
+          detail::map_keys<Iter,val_map> keys(Ai, map);
+          std::vector<moved> mv;
+
+          bool small = true;
+          for (unsigned int c = 0; c < pos.size(); ++c) {
+            const int & j = pos[c];
+            const int i = std::upper_bound(bin, bin + n_values, j) - bin;
+            const int k = keys(j);
+            if ( k == i )
+              continue;
+            if ( static_cast<int>(mv.size()) >= limit ) {
+              small = false;
+              break;
+            }
+            mv.push_back( moved(j, i, k) );
+          }
+
+          if ( small ) {
+            resort_moved(Ai, mv);
+            return true;
+          }
+        }
+
+        sort(Ai, Af, map, nsortTweaker);
+        return false;
+      }
+
+
+    private:
+      /** Whether bin and ptr are in fixed_store. */
+      inline bool fixed() const { return bin == fixed_store; }
+
+      void allocate() {
+        if ( fixed_values > 0 && n_values == fixed_values )
+          bin = fixed_store;
+        else
+          bin = new int[2 * n_values];
+        ptr = bin + n_values;
+      }
+
+      void deallocate() {
+        if ( !fixed() )
+          delete[] bin;
+      }
+
+      /** Make sure that the key array can hold n keys of type KeyT. */
+      template < typename KeyT >
+      KeyT * reserve_keys(const int & n) {
+        if ( sizeof(KeyT) * n > key_bytes ) {
+          free(key_store);
+          key_bytes = sizeof(KeyT) * n;
+          key_store = malloc( key_bytes );
+          if ( key_store == NULL ) {
+            key_bytes = n_keys = 0;
+            throw std::bad_alloc();
+          }
+        }
+        n_keys = n;
+        return static_cast<KeyT*>(key_store);
+      }
+
+      /** Make sure that the staging space can hold bytes bytes.  The
+       * returned space is aligned to a cache line (and hence suitably aligned
+       * for any staged element type). */
+      void * reserve_stage(const size_t & bytes) {
+        if ( bytes > par_stage_bytes ) {
+          free(par_stage);
+          par_stage_bytes = bytes;
+          par_stage = malloc( par_stage_bytes + 63u );
+          if ( par_stage == NULL ) {
+            par_stage_bytes = 0;
+            throw std::bad_alloc();
+          }
+        }
+        return reinterpret_cast<void*>(
+          (reinterpret_cast<uintptr_t>(par_stage) + 63u) & ~uintptr_t(63u) );
+      }
+
+      /** Whether the tweaker might change the map. */
+      static inline bool tweaks() {
+        return ! boost::is_same<NSortTweaker, tweak::Null>::value;
+      }
+
+      /** Call job(keys) with the key source selected by the key caching
+       * option. */
+      template < class Iter, class Job >
+      void with_keys(const Iter & Ai, const int & n, val_map & map, Job & job) {
+        n_sorted = -1;
+        if ( !cache_keys ) {
+          n_keys = 0;
+          detail::map_keys<Iter,val_map> keys(Ai, map);
+          job(keys);
+          n_sorted = n;
+          return;
+        }
+
+        switch ( key_size() ) {
+          case 1: {
+            detail::cached_keys<Iter,val_map,uint8_t>
+              keys( Ai, map, reserve_keys<uint8_t>(n) );
+            job(keys);
+            break;
+          }
+          case 2: {
+            detail::cached_keys<Iter,val_map,uint16_t>
+              keys( Ai, map, reserve_keys<uint16_t>(n) );
+            job(keys);
+            break;
+          }
+          default: {
+            detail::cached_keys<Iter,val_map,uint32_t>
+              keys( Ai, map, reserve_keys<uint32_t>(n) );
+            job(keys);
+          }
+        }
+        n_sorted = n;
+      }
+
+      /* The jobs given to with_keys by the public sort functions. */
+      struct serial_job {
+        NSort & s;
+        int n;
+        NSortTweaker & tw;
+        serial_job(NSort & s, const int & n, NSortTweaker & tw)
+          : s(s), n(n), tw(tw) { }
+        template < class Keys >
+        void operator() (Keys & keys) {
+          if ( s.fixed() )
+            s.template sort_serial<fixed_values>(n, tw, keys);
+          else if ( s.use_radix() )
+            s.sort_radix(n, keys);
+          else
+            s.template sort_serial<0>(n, tw, keys);
+        }
+      };
+
+      struct parallel_copy_job {
+        NSort & s;
+        int n, nt;
+        NSortTweaker & tw;
+        parallel_copy_job(NSort & s, const int & n, const int & nt,
+                          NSortTweaker & tw)
+          : s(s), n(n), nt(nt), tw(tw) { }
+        template < class Keys >
+        void operator() (Keys & keys) { s.sort_parallel_copy(n, nt, tw, keys); }
+      };
+
+      struct parallel_swap_job {
+        NSort & s;
+        int n, nt;
+        NSortTweaker & tw;
+        parallel_swap_job(NSort & s, const int & n, const int & nt,
+                          NSortTweaker & tw)
+          : s(s), n(n), nt(nt), tw(tw) { }
+        template < class Keys >
+        void operator() (Keys & keys) { s.sort_parallel_swap(n, nt, tw, keys); }
+      };
+
+      template < class Out >
+      struct copy_job {
+        NSort & s;
+        int n, nt;
+        NSortTweaker & tw;
+        const Out & Oi;
+        int * perm;
+        copy_job(NSort & s, const int & n, const int & nt, NSortTweaker & tw,
+                 const Out & Oi, int * perm)
+          : s(s), n(n), nt(nt), tw(tw), Oi(Oi), perm(perm) { }
+        template < class Keys >
+        void operator() (Keys & keys) { s.sort_copy_impl(n, nt, tw, keys, Oi, perm); }
+      };
+
+      struct index_job {
+        NSort & s;
+        int n, nt;
+        NSortTweaker & tw;
+        int * perm;
+        index_job(NSort & s, const int & n, const int & nt, NSortTweaker & tw,
+                  int * perm)
+          : s(s), n(n), nt(nt), tw(tw), perm(perm) { }
+        template < class Keys >
+        void operator() (Keys & keys) { s.sort_index_impl(n, nt, tw, keys, perm); }
+      };
+
+      /** The serial sort:  count, prefix sum and in-place cycle-swap.
+       * @tparam NV
+       *    The number of values, if fixed at compile time (else 0).
+       */
+      template < int NV, class Keys >
+      void sort_serial(const int & n, NSortTweaker & nsortTweaker, Keys & keys) {
+        const int nv = NV > 0 ? NV : n_values;
+        for (int i = 0; i < nv; ++i)
+          bin[i] = 0;
 
         /* first count the number of occurrences for each value. */
-        for (Iter i = Ai; i < Af; ++i)
-          ++bin[map(ref_of(*i))];
+        for (int i = 0; i < n; ++i)
+          ++bin[keys.compute(i)];
 
         /* Allow user code to tweak the map according to the preliminary
          * counting statistics. */
-        nsortTweaker.tweakNSort(map, bin, static_cast<const int&>(n_values));
+        nsortTweaker.tweakNSort(keys.map, bin, static_cast<const int&>(n_values));
+        if ( Keys::cached && tweaks() )
+          for (int i = 0; i < n; ++i)
+            keys.compute(i);
 
         /* now change this array of occurrences to an array of start
          * positions. */
-        for (int i = 0, cur_ptr = 0; i < n_values; ++i) {
+        for (int i = 0, cur_ptr = 0; i < nv; ++i) {
           ptr[i]   = cur_ptr;
           cur_ptr += bin[i];
           bin[i]   = cur_ptr;
         }
 
-        for (int i = 0; i < n_values; ++i) {
+        permute_serial<NV>(keys, ptr);
+      }
+
+      /** In-place cycle-swap of the elements at [ptr[i], end(i)) for all i.
+       * All elements outside of these ranges must already be in place. */
+      template < int NV, class Keys >
+      void permute_serial(Keys & keys, int * ptr) {
+        const int nv = NV > 0 ? NV : n_values;
+        for (int i = 0; i < nv; ++i) {
           const int & end_pos = end(i);
           int & pos = ptr[i];
 
           while (pos < end_pos) {
-            int & pos2 = ptr[map(ref_of(*(Ai + pos)))];
+            int & pos2 = ptr[keys(pos)];
 
             if (pos == pos2) {
               /* don't need to swap current position, move to next... */
               pos++;
               continue;
             }
-            std::iter_swap(Ai+pos, Ai + pos2++);
+            std::iter_swap(keys.Ai + pos, keys.Ai + pos2);
+            keys.swap(pos, pos2++);
           }/*while*/
         }/*for*/
+      }
 
-        delete[] ptr;
-      }/*sort()*/
+
+      /* **** BEGIN RADIX IMPLEMENTATION **** { */
+
+      inline bool use_radix() const {
+        return radix_threshold > 0 && n_values > radix_threshold && !tweaks();
+      }
+
+      /** In-place MSD radix sort.  The key bits are split into the fewest
+       * digits of at most radix_bits bits; the leading digit takes what is
+       * left over. */
+      template < class Keys >
+      void sort_radix(const int & n, Keys & keys) {
+        int key_bits = 0;
+        while ( (1 << key_bits) < n_values )
+          ++key_bits;
+        const int n_digits = (key_bits + radix_bits - 1) / radix_bits;
+        const int bits = (key_bits + n_digits - 1) / n_digits;
+        const int shift = (n_digits - 1) * bits;
+
+        radix_store.resize( 3 * n_digits << radix_bits );
+        memset(bin, 0, sizeof(int)*n_values);
+
+        /* the per-key counts are collected in bin[]... */
+        radix_pass(keys, 0, n, shift, key_bits - shift, bits, true);
+
+        /* ...and turned into the bin end positions. */
+        for (int i = 0, cur_ptr = 0; i < n_values; ++i) {
+          cur_ptr += bin[i];
+          bin[i] = cur_ptr;
+        }
+      }
+
+      /** Partition [b, e) by the digit (key >> shift) of digit_bits bits and
+       * recurse into each bucket with the next digit of bits bits.  At the
+       * last digit (shift == 0), all elements of a bucket have the same key
+       * and their number is written to bin[key].
+       * @param compute
+       *    Whether the keys must be evaluated (first pass).
+       */
+      template < class Keys >
+      void radix_pass(Keys & keys, const int & b, const int & e,
+                      const int & shift, const int & digit_bits,
+                      const int & bits, const bool & compute) {
+        if ( !compute && e - b <= radix_small ) {
+          insertion_sort(keys, b, e);
+          for (int i = b; i < e; ++i)
+            ++bin[keys(i)];
+          return;
+        }
+
+        const int nd = 1 << digit_bits;
+        const int mask = nd - 1;
+        const int level = shift / bits;
+        int * count = &radix_store[(3 * level) << radix_bits];
+        int * ptr = count + (1 << radix_bits);
+        int * end = ptr + (1 << radix_bits);
+
+        for (int j = 0; j < nd; ++j)
+          count[j] = 0;
+        if ( compute )
+          for (int i = b; i < e; ++i)
+            ++count[(keys.compute(i) >> shift) & mask];
+        else
+          for (int i = b; i < e; ++i)
+            ++count[(keys(i) >> shift) & mask];
+
+        for (int j = 0, cur_ptr = b; j < nd; ++j) {
+          ptr[j] = cur_ptr;
+          cur_ptr += count[j];
+          end[j] = cur_ptr;
+        }
+
+        /* cycle-swap as in permute_serial, but by digit. */
+        for (int j = 0; j < nd; ++j) {
+          int & pos = ptr[j];
+          while (pos < end[j]) {
+            int & pos2 = ptr[(keys(pos) >> shift) & mask];
+            if (pos == pos2) {
+              ++pos;
+              continue;
+            }
+            std::iter_swap(keys.Ai + pos, keys.Ai + pos2);
+            keys.swap(pos, pos2++);
+          }
+        }
+
+        if ( shift == 0 ) {
+          if ( b < e ) {
+            /* the top bucket may be cut short by n_values. */
+            const int base = keys(b) & ~mask;
+            int * c = bin + base;
+            for (int j = 0, f = std::min(nd, n_values - base); j < f; ++j)
+              c[j] += count[j];
+          }
+          return;
+        }
+
+        /* the deeper levels use their own part of radix_store. */
+        for (int j = 0; j < nd; ++j)
+          if ( count[j] > 0 )
+            radix_pass(keys, end[j] - count[j], end[j], shift - bits, bits,
+                       bits, false);
+      }
+
+      /** Sort [b, e) by the whole key. */
+      template < class Keys >
+      void insertion_sort(Keys & keys, const int & b, const int & e) {
+        for (int i = b + 1; i < e; ++i)
+          for (int j = i; j > b && keys(j) < keys(j-1); --j) {
+            std::iter_swap(keys.Ai + j, keys.Ai + (j-1));
+            keys.swap(j, j-1);
+          }
+      }
+
+      /* **** END RADIX IMPLEMENTATION **** } */
+
+
+      /* **** BEGIN INCREMENTAL IMPLEMENTATION **** { */
+
+      /** An element whose value changed from bin 'from' to bin 'to'. */
+      struct moved {
+        int pos, from, to;
+        moved(const int & pos, const int & from, const int & to)
+          : pos(pos), from(from), to(to) { }
+      };
+
+      inline void set_key(const int & i, const int & k) {
+        switch ( key_size() ) {
+          case 1:  static_cast<uint8_t *>(key_store)[i] = k; break;
+          case 2:  static_cast<uint16_t*>(key_store)[i] = k; break;
+          default: static_cast<uint32_t*>(key_store)[i] = k;
+        }
+      }
+
+      /** Moves the elements listed in mv (ordered by position) into their new
+       * bins and updates bin[] (and the key cache).  The only positions that
+       * can hold an element that doesn't belong to the (new) bin of the
+       * position are the positions in mv and the positions that changed bins
+       * because the bin boundaries shifted.  These 'holes' are collected per
+       * bin and then filled by cycle-swapping as in permute_serial. */
+      template < class Iter >
+      void resort_moved(const Iter & Ai, const std::vector<moved> & mv) {
+        if ( mv.empty() )
+          return;
+
+        /* the new bin boundaries. */
+        std::vector<int> old_end(bin, bin + n_values), delta(n_values, 0);
+        for (unsigned int m = 0; m < mv.size(); ++m) {
+          --delta[mv[m].from];
+          ++delta[mv[m].to];
+        }
+        for (int i = 0, d = 0; i < n_values; ++i) {
+          d += delta[i];
+          bin[i] += d;
+        }
+
+        /* positions that changed bins (with the old bin as value), in
+         * order. */
+        std::vector<int> spos, skey;
+        for (int i = 0, o = 0; i < n_values; ++i) {
+          const int nb = begin(i), ne = end(i);
+          const int ob = (i == 0 ? 0 : old_end[i-1]), oe = old_end[i];
+          const int ranges[2][2] = { { nb, std::min(ne, ob) },
+                                     { std::max(nb, oe), ne } };
+          for (int r = 0; r < 2; ++r)
+            for (int p = ranges[r][0]; p < ranges[r][1]; ++p) {
+              while (old_end[o] <= p) ++o;
+              spos.push_back(p);
+              skey.push_back(o);
+            }
+        }
+
+        const bool update_keys = cache_keys && n_keys == n_sorted;
+        if ( !update_keys )
+          n_keys = 0;
+
+        /* merge the two lists into the per-bin lists of holes. */
+        std::vector<int> hpos, hkey, hptr(n_values + 1, 0);
+        unsigned int s = 0, m = 0;
+        for (int nbin = 0; s < spos.size() || m < mv.size(); ) {
+          int p, k;
+          if ( m == mv.size() || (s < spos.size() && spos[s] < mv[m].pos) ) {
+            p = spos[s];
+            k = skey[s++];
+          } else {
+            p = mv[m].pos;
+            k = mv[m++].to;
+            if ( s < spos.size() && spos[s] == p )
+              ++s;
+          }
+
+          while (bin[nbin] <= p) ++nbin;
+          if ( update_keys )
+            set_key(p, nbin);
+          if ( k != nbin ) {
+            hpos.push_back(p);
+            hkey.push_back(k);
+            ++hptr[nbin + 1];
+          }
+        }
+
+        /* the holes are ordered by position, hence grouped by bin. */
+        for (int i = 0; i < n_values; ++i)
+          hptr[i+1] += hptr[i];
+        const std::vector<int> hend(hptr.begin() + 1, hptr.end());
+
+        for (int i = 0; i < n_values; ++i) {
+          int & h = hptr[i];
+          while (h < hend[i]) {
+            const int k = hkey[h];
+            if (k == i) {
+              ++h;
+              continue;
+            }
+            int & h2 = hptr[k];
+            std::iter_swap(Ai + hpos[h], Ai + hpos[h2]);
+            std::swap(hkey[h], hkey[h2++]);
+          }
+        }
+      }
+
+      /* **** END INCREMENTAL IMPLEMENTATION **** } */
+
+
+      /* **** BEGIN PARALLEL IMPLEMENTATION **** { */
+
+      template < class Keys >
+      void sort_parallel_copy(const int & n, const int & nt,
+                              NSortTweaker & nsortTweaker, Keys & keys) {
+        typedef typename Keys::iterator_type Iter;
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+
+        std::vector<int> & offsets = par_offsets;
+        count_parallel(n, nt, nsortTweaker, keys, offsets);
+
+        /* uninitialized scratch space:  the scatter copy-constructs into it
+         * and the copy back destroys. */
+        std::allocator<value_type> alloc;
+        value_type * scratch = alloc.allocate(n);
+
+        scatter<detail::construct_element>(keys, scratch, NULL, n, nt, offsets);
+
+        copy_chunk<Iter> copy(scratch, keys.Ai, n, nt);
+        detail::run_chunks(nt, copy);
+
+        alloc.deallocate(scratch, n);
+        fill_keys(keys);
+      }
+
+      template < class Keys, class Out >
+      void sort_copy_impl(const int & n, const int & nt,
+                          NSortTweaker & nsortTweaker, Keys & keys,
+                          const Out & Oi, int * perm) {
+        std::vector<int> & offsets = par_offsets;
+        count_parallel(n, nt, nsortTweaker, keys, offsets);
+        scatter<detail::assign_element>(keys, Oi, perm, n, nt, offsets);
+        fill_keys(keys);
+      }
+
+      template < class Keys >
+      void sort_index_impl(const int & n, const int & nt,
+                           NSortTweaker & nsortTweaker, Keys & keys,
+                           int * perm) {
+        std::vector<int> & offsets = par_offsets;
+        count_parallel(n, nt, nsortTweaker, keys, offsets);
+        detail::index_chunk<Keys> s(keys, perm, n, nt, n_values, offsets);
+        detail::run_chunks(nt, s);
+        fill_keys(keys);
+      }
+
+      /** The keys of a sorted list are just the bin values. */
+      template < class Keys >
+      void fill_keys(Keys & keys) {
+        if ( Keys::cached )
+          for (int i = 0; i < n_values; ++i)
+            for (int j = begin(i); j < end(i); ++j)
+              keys.set(j, i);
+      }
+
+      /** Stable scatter of the list to Oi (direct). */
+      template < class Store, class Keys, class Out >
+      void scatter(const Keys & keys, const Out & Oi, int * perm,
+                   const int & n, const int & nt, std::vector<int> & offsets) {
+        detail::scatter_chunk<Keys,Out,Store>
+          s(keys, Oi, perm, n, nt, n_values, offsets);
+        detail::run_chunks(nt, s);
+      }
+
+      /** Stable scatter of the list to Oi (write-combining for trivially
+       * copyable and destructible elements, which is all that copying them
+       * through raw staging memory requires). */
+      template < class Store, class Keys, class T >
+      void scatter(const Keys & keys, T * Oi, int * perm,
+                   const int & n, const int & nt, std::vector<int> & offsets) {
+        scatter_ptr<Store>(keys, Oi, perm, n, nt, offsets,
+                           boost::integral_constant< bool,
+                             boost::has_trivial_copy<T>::value &&
+                             boost::has_trivial_destructor<T>::value >());
+      }
+
+      template < class Store, class Keys, class T >
+      void scatter_ptr(const Keys & keys, T * Oi, int * perm,
+                       const int & n, const int & nt,
+                       std::vector<int> & offsets, boost::true_type) {
+        typedef detail::staged_scatter_chunk<Keys,T> staged;
+        if ( staged::useful(n_values) ) {
+          const size_t stride = staged::stage_stride(n_values);
+          par_fill.resize( static_cast<size_t>(nt) * n_values );
+          staged s(keys, Oi, perm, n, nt, n_values, offsets,
+                   static_cast<char*>(reserve_stage(nt * stride)), stride,
+                   par_fill);
+          detail::run_chunks(nt, s);
+        } else
+          scatter_ptr<Store>(keys, Oi, perm, n, nt, offsets, boost::false_type());
+      }
+
+      template < class Store, class Keys, class T >
+      void scatter_ptr(const Keys & keys, T * Oi, int * perm,
+                       const int & n, const int & nt,
+                       std::vector<int> & offsets, boost::false_type) {
+        detail::scatter_chunk<Keys,T*,Store>
+          s(keys, Oi, perm, n, nt, n_values, offsets);
+        detail::run_chunks(nt, s);
+      }
+
+      template < class Keys >
+      void sort_parallel_swap(const int & n, const int & nt,
+                              NSortTweaker & nsortTweaker, Keys & keys) {
+        std::vector<int> & offsets = par_offsets;
+        count_parallel(n, nt, nsortTweaker, keys, offsets);
+
+        /* [head[i], tail[i]) is the part of bin i that still holds elements
+         * that might not belong there. */
+        std::vector<int> & head = par_head, & tail = par_tail;
+        head.resize(n_values);
+        tail.assign(bin, bin + n_values);
+        for (int i = 0; i < n_values; ++i)
+          head[i] = begin(i);
+
+        int remaining = n;
+        if ( nt > 1 ) {
+          permute_chunk<Keys> permute(keys, nt, n_values, head, tail);
+          repair_chunk<Keys> repair(keys, nt, n_values, head, tail,
+                                    permute.ph, permute.pt);
+
+          while ( remaining > 0 ) {
+            permute.partition();
+            detail::run_chunks(nt, permute);
+            detail::run_chunks(nt, repair);
+
+            int r = 0;
+            for (int i = 0; i < n_values; ++i)
+              r += tail[i] - head[i];
+
+            /* finish serially once the rounds stop making good progress. */
+            const bool slow = r > remaining / 2;
+            remaining = r;
+            if ( slow )
+              break;
+          }
+        }
+
+        /* serial cycle-swap of whatever remains. */
+        if ( remaining > 0 )
+          permute_serial<0>(keys, &head[0]);
+      }
+
+      /** Counts the occurrences in each chunk, fills bin[] with the global end
+       * positions and offsets[t*n_values + i] with the position at which chunk
+       * t should write its first element of value i. */
+      template <class Keys>
+      void count_parallel(const int & n, const int & nt,
+                          NSortTweaker & nsortTweaker, Keys & keys,
+                          std::vector<int> & offsets) {
+        offsets.assign(nt * n_values, 0);
+        {
+          count_chunk<Keys> count(keys, n, nt, n_values, offsets);
+          detail::run_chunks(nt, count);
+        }
+
+        memset(bin, 0, sizeof(int)*n_values);
+        for (int t = 0; t < nt; ++t)
+          for (int i = 0; i < n_values; ++i)
+            bin[i] += offsets[t*n_values + i];
+
+        nsortTweaker.tweakNSort(keys.map, bin, static_cast<const int&>(n_values));
+
+        if ( tweaks() ) {
+          /* the tweaker may have changed the map; count again with the
+           * tweaked map (only the per-chunk counts can have changed). */
+          offsets.assign(nt * n_values, 0);
+          count_chunk<Keys> count(keys, n, nt, n_values, offsets);
+          detail::run_chunks(nt, count);
+        }
+
+        for (int i = 0, cur_ptr = 0; i < n_values; ++i) {
+          for (int t = 0; t < nt; ++t) {
+            int & o = offsets[t*n_values + i];
+            const int c = o;
+            o = cur_ptr;
+            cur_ptr += c;
+          }
+          bin[i] = cur_ptr;
+        }
+      }
+
+      template <class Keys>
+      struct count_chunk {
+        Keys & keys;
+        int n, nt, n_values;
+        std::vector<int> & counts;
+
+        count_chunk(Keys & keys, const int & n, const int & nt,
+                    const int & n_values, std::vector<int> & counts)
+          : keys(keys), n(n), nt(nt), n_values(n_values), counts(counts) { }
+
+        void operator() (const int & t) {
+          int * c = &counts[t*n_values];
+          const int f = detail::chunk_begin(n, nt, t + 1);
+          for (int i = detail::chunk_begin(n, nt, t); i < f; ++i)
+            ++c[keys.compute(i)];
+        }
+      };
+
+      /** Copies the chunk of the scratch space back and destroys it. */
+      template <class Iter>
+      struct copy_chunk {
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        value_type * Ii;
+        Iter Oi;
+        int n, nt;
+
+        copy_chunk(value_type * Ii, const Iter & Oi, const int & n,
+                   const int & nt)
+          : Ii(Ii), Oi(Oi), n(n), nt(nt) { }
+
+        void operator() (const int & t) {
+          const int b = detail::chunk_begin(n, nt, t), e = detail::chunk_begin(n, nt, t + 1);
+          std::copy(Ii + b, Ii + e, Oi + b);
+          for (value_type * i = Ii + b; i < Ii + e; ++i)
+            i->~value_type();
+        }
+      };
+
+      /** Speculative permutation (PARADIS):  each thread owns a sub-range
+       * [ph, pt) of every bin and cycle-swaps elements only within its own
+       * sub-ranges.  Afterwards [original ph, ph) holds correctly placed
+       * elements and [ph, pt) whatever could not be placed. */
+      template <class Keys>
+      struct permute_chunk {
+        typedef typename Keys::iterator_type Iter;
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        Keys & keys;
+        int nt, n_values;
+        const std::vector<int> & head, & tail;
+        std::vector<int> ph, pt;
+
+        permute_chunk(Keys & keys, const int & nt, const int & n_values,
+                      const std::vector<int> & head,
+                      const std::vector<int> & tail)
+          : keys(keys), nt(nt), n_values(n_values), head(head), tail(tail),
+            ph(nt*n_values), pt(nt*n_values) { }
+
+        /** Divide the remainder of each bin evenly among the threads. */
+        void partition() {
+          for (int i = 0; i < n_values; ++i) {
+            const int len = tail[i] - head[i];
+            for (int t = 0; t < nt; ++t) {
+              ph[t*n_values + i] = head[i] + detail::chunk_begin(len, nt, t);
+              pt[t*n_values + i] = head[i] + detail::chunk_begin(len, nt, t + 1);
+            }
+          }
+        }
+
+        void operator() (const int & t) {
+          const Iter & Ai = keys.Ai;
+          int * h = &ph[t*n_values];
+          const int * e = &pt[t*n_values];
+
+          for (int i = 0; i < n_values; ++i) {
+            for (int pos = h[i]; pos < e[i]; ++pos) {
+              /* the element in hand and its key. */
+              value_type v = *(Ai + pos);
+              int k = keys(pos);
+
+              while (k != i && h[k] < e[k]) {
+                value_type tmp = *(Ai + h[k]);
+                const int tk = keys(h[k]);
+                *(Ai + h[k]) = v;
+                keys.set(h[k]++, k);
+                v = tmp;
+                k = tk;
+              }
+
+              if (k == i) {
+                /* keep the placed elements at the front of our range. */
+                *(Ai + pos) = *(Ai + h[i]);
+                keys.move(pos, h[i]);
+                *(Ai + h[i]) = v;
+                keys.set(h[i]++, k);
+              } else {
+                *(Ai + pos) = v;
+                keys.set(pos, k);
+              }
+            }
+          }
+        }
+      };
+
+      /** Repair (PARADIS):  within each bin, swap the misplaced elements
+       * left by permute_chunk toward the end of the bin, leaving only
+       * correctly placed elements in front of the new head[i]. */
+      template <class Keys>
+      struct repair_chunk {
+        Keys & keys;
+        int nt, n_values;
+        std::vector<int> & head, & tail;
+        const std::vector<int> & ph, & pt;
+
+        repair_chunk(Keys & keys, const int & nt, const int & n_values,
+                     std::vector<int> & head, std::vector<int> & tail,
+                     const std::vector<int> & ph, const std::vector<int> & pt)
+          : keys(keys), nt(nt), n_values(n_values), head(head), tail(tail),
+            ph(ph), pt(pt) { }
+
+        void operator() (const int & t) {
+          const int ie = detail::chunk_begin(n_values, nt, t + 1);
+          for (int i = detail::chunk_begin(n_values, nt, t); i < ie; ++i) {
+            int end = tail[i];
+
+            for (int s = 0; s < nt; ++s) {
+              int pos = ph[s*n_values + i];
+              const int stop = pt[s*n_values + i];
+
+              while (pos < stop && pos < end) {
+                if (keys(pos) == i) {
+                  ++pos;
+                  continue;
+                }
+
+                /* find a correctly valued element from the back. */
+                do --end;
+                while (end > pos && keys(end) != i);
+
+                if (end == pos)
+                  break;
+                std::iter_swap(keys.Ai + pos, keys.Ai + end);
+                keys.swap(pos++, end);
+              }
+
+              if (pos >= end)
+                break;
+            }
+
+            /* [end, tail) now only holds elements that belong elsewhere. */
+            head[i] = end;
+          }
+        }
+      };
+
+      /* **** END PARALLEL IMPLEMENTATION **** } */
     };/* NSort class */
 
   }/* namespace nsort */
@@ -0,0 +1,351 @@
+#ifndef olson_tools_nsort_Tree_h
+#define olson_tools_nsort_Tree_h
+
+#include <olson-tools/nsort/NSort.h>
+#include <olson-tools/nsort/map/position_base.h>
+#include <olson-tools/nsort/detail/parallel.h>
+#include <olson-tools/Vector.h>
+#include <olson-tools/ref_of.h>
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+namespace olson_tools {
+  namespace nsort {
+
+    namespace detail {
+      /** The directions that are split by the map DIMS (_1D, _2D or _3D). */
+      template < typename DIMS, unsigned int ndims = DIMS::spatial_dimensions >
+      struct split_dirs;
+
+      template < typename DIMS >
+      struct split_dirs<DIMS,1u> {
+        static const int n = 1;
+        static int dir(const int & /*i*/) { return DIMS::dir0; }
+      };
+
+      template < typename DIMS >
+      struct split_dirs<DIMS,2u> {
+        static const int n = 2;
+        static int dir(const int & i) { return i == 0 ? DIMS::dir0 : DIMS::dir1; }
+      };
+
+      template < typename DIMS >
+      struct split_dirs<DIMS,3u> {
+        static const int n = 3;
+        static int dir(const int & i) {
+          return i == 0 ? DIMS::dir0 : (i == 1 ? DIMS::dir1 : DIMS::dir2);
+        }
+      };
+    }/* namespace detail */
+
+    /** Adaptive tree (binary, quad- or octree) built by recursively sorting a
+     * list with NSort.  DIMS is one of the pivot maps map::_1D, map::_2D or
+     * map::_3D; each node is split at a pivot point chosen from the elements
+     * of the node into 2, 4 or 8 children:
+     *    \verbatim
+            Tree< map::_3D<0,1,2> > octree(16);
+            octree.build(particles.begin(), particles.end());
+          \endverbatim
+     * The elements (or pointers to elements) must have a position x, as
+     * required by the pivot maps.
+     *
+     * The list is reordered such that every node covers a contiguous range
+     * [begin, end) of the list.  The nodes are stored in a single flat array
+     * with the root at 0 and the children of each node stored next to each
+     * other (in the order of the map values).  Each build thread reuses its
+     * own NSort and scratch space for all of its nodes and between builds.
+     * */
+    template < typename DIMS >
+    class Tree {
+      /* TYPEDEFS */
+    public:
+      typedef map::pivot_ctor<DIMS> map_type;
+
+      /** The number of children of each internal node. */
+      static const int n_children = 1 << DIMS::spatial_dimensions;
+
+      /** How the pivot of a node is chosen. */
+      enum PivotRule {
+        /** The center of the bounding box of the elements. */
+        CENTER,
+        /** The mean position of the elements. */
+        MEAN,
+        /** The median of the elements in each direction. */
+        MEDIAN
+      };
+
+      /** A node of the tree. */
+      struct Node {
+        /** The point at which this node is split (if not a leaf). */
+        Vector<double,3> pivot;
+        /** The range [begin, end) of the list in this node. */
+        int begin, end;
+        /** The index of the first child (or -1 for a leaf). */
+        int child;
+
+        Node(const int & begin = 0, const int & end = 0)
+          : pivot(0.0), begin(begin), end(end), child(-1) { }
+
+        inline bool leaf() const { return child < 0; }
+        inline int size() const { return end - begin; }
+      };
+
+    private:
+      /** Used to map a bare position. */
+      struct position {
+        Vector<double,3> x;
+      };
+
+      /** The scratch space of one build thread. */
+      struct workspace {
+        NSort<map_type> s;
+        std::vector<double> coords;
+        workspace() : s(n_children) { }
+      };
+
+      /* STORAGE MEMBERS */
+      int leaf_size;
+      PivotRule rule;
+      int max_depth;
+
+      std::vector<Node> node_list;
+      std::vector<workspace*> ws;
+      std::vector< std::vector<Node> > subtrees;
+
+      /* not copyable (the workspaces are owned). */
+      Tree(const Tree &);
+      Tree & operator= (const Tree &);
+
+      /* MEMBER FUNCTIONS */
+    public:
+      /** Constructor.
+       * @param leaf_size
+       *    Nodes with no more than this many elements are not split.
+       * @param rule
+       *    How to choose the pivots [Default MEDIAN].
+       * @param max_depth
+       *    The maximum depth of the tree (the root has depth 0).
+       */
+      Tree( const int & leaf_size = 16,
+            const PivotRule & rule = MEDIAN,
+            const int & max_depth = 32 )
+        : leaf_size(leaf_size), rule(rule), max_depth(max_depth) { }
+
+      ~Tree() {
+        for (unsigned int i = 0; i < ws.size(); ++i)
+          delete ws[i];
+      }
+
+      /** Build the tree for the list [Ai, Af), reordering the list.
+       * @param nthreads
+       *    The number of threads to use.  [Default 0:  use all available
+       *    threads for large lists.]
+       */
+      template < class Iter >
+      void build( const Iter & Ai, const Iter & Af, const int & nthreads = 0 ) {
+        const int nt = detail::n_chunks(Af - Ai, nthreads);
+        while ( static_cast<int>(ws.size()) < nt )
+          ws.push_back( new workspace );
+
+        node_list.assign( 1, Node(0, Af - Ai) );
+        if ( nt == 1 ) {
+          build_node(Ai, node_list, 0, 0, *ws[0]);
+          return;
+        }
+
+        /* split the top of the tree serially until there are enough
+         * subtrees to keep the threads busy. */
+        typedef std::vector< std::pair<int,int> > node_depths;
+        node_depths frontier(1, std::make_pair(0, 0)), next;
+        while ( !frontier.empty() &&
+                static_cast<int>(frontier.size()) < 4 * nt ) {
+          next.clear();
+          for (unsigned int f = 0; f < frontier.size(); ++f) {
+            const int & i = frontier[f].first;
+            const int & d = frontier[f].second;
+            if ( d >= max_depth || !split(Ai, node_list[i], *ws[0]) )
+              continue;
+            const int c = add_children(node_list, i, ws[0]->s);
+            for (int j = 0; j < n_children; ++j)
+              if ( node_list[c + j].size() > leaf_size )
+                next.push_back( std::make_pair(c + j, d + 1) );
+          }
+          frontier.swap(next);
+        }
+
+        if ( frontier.empty() )
+          return;
+
+        /* largest subtrees first. */
+        std::vector< std::pair<int, std::pair<int,int> > > order;
+        for (unsigned int f = 0; f < frontier.size(); ++f)
+          order.push_back(
+            std::make_pair( -node_list[frontier[f].first].size(), frontier[f] ) );
+        std::sort(order.begin(), order.end());
+        for (unsigned int f = 0; f < order.size(); ++f)
+          frontier[f] = order[f].second;
+
+        if ( subtrees.size() < frontier.size() )
+          subtrees.resize( frontier.size() );
+
+        subtree_chunk<Iter> sub(*this, Ai, frontier, nt);
+        detail::run_chunks(nt, sub);
+
+        /* splice the subtrees into the node array. */
+        for (unsigned int f = 0; f < frontier.size(); ++f) {
+          const std::vector<Node> & local = subtrees[f];
+          const int o = node_list.size() - 1;
+          for (unsigned int k = 1; k < local.size(); ++k) {
+            node_list.push_back( local[k] );
+            if ( !local[k].leaf() )
+              node_list.back().child += o;
+          }
+          Node & root = node_list[frontier[f].first];
+          root = local[0];
+          if ( !root.leaf() )
+            root.child += o;
+        }
+      }
+
+      /** The nodes of the tree; the root is nodes()[0]. */
+      inline const std::vector<Node> & nodes() const { return node_list; }
+
+      /** The number of nodes. */
+      inline int size() const { return node_list.size(); }
+
+      /** The ith node. */
+      inline const Node & operator[] ( const int & i ) const {
+        return node_list[i];
+      }
+
+      /** The index of the leaf that contains the position x. */
+      int find_leaf( const Vector<double,3> & x ) const {
+        const position p = { x };
+        int i = 0;
+        while ( !node_list[i].leaf() ) {
+          map_type map(node_list[i].pivot);
+          i = node_list[i].child + map(p);
+        }
+        return i;
+      }
+
+    private:
+      /** Builds the subtrees of the frontier nodes t, t+nt, ... */
+      template < class Iter >
+      struct subtree_chunk {
+        Tree & tree;
+        Iter Ai;
+        const std::vector< std::pair<int,int> > & frontier;
+        int nt;
+
+        subtree_chunk( Tree & tree, const Iter & Ai,
+                       const std::vector< std::pair<int,int> > & frontier,
+                       const int & nt )
+          : tree(tree), Ai(Ai), frontier(frontier), nt(nt) { }
+
+        void operator() (const int & t) {
+          for (unsigned int f = t; f < frontier.size(); f += nt) {
+            std::vector<Node> & local = tree.subtrees[f];
+            local.assign( 1, tree.node_list[frontier[f].first] );
+            tree.build_node(Ai, local, 0, frontier[f].second, *tree.ws[t]);
+          }
+        }
+      };
+
+      /** Depth-first build of the subtree of nodes[i]. */
+      template < class Iter >
+      void build_node( const Iter & Ai, std::vector<Node> & nodes,
+                       const int & i, const int & depth, workspace & w ) const {
+        if ( depth >= max_depth || !split(Ai, nodes[i], w) )
+          return;
+        const int c = add_children(nodes, i, w.s);
+        for (int j = 0; j < n_children; ++j)
+          build_node(Ai, nodes, c + j, depth + 1, w);
+      }
+
+      /** Choose the pivot of the node and sort its elements by the map.
+       * @return false if the node should be a leaf.
+       */
+      template < class Iter >
+      bool split( const Iter & Ai, Node & node, workspace & w ) const {
+        const int n = node.size();
+        if ( n <= leaf_size )
+          return false;
+
+        node.pivot = choose_pivot(Ai, node, w);
+        w.s.sort( Ai + node.begin, Ai + node.end, map_type(node.pivot) );
+
+        /* don't split if it does not separate anything (such as for many
+         * identical positions). */
+        for (int j = 0; j < n_children; ++j)
+          if ( w.s.size(j) == n )
+            return false;
+        return true;
+      }
+
+      /** Append the children of nodes[i] (as just sorted by s).
+       * @return the index of the first child.
+       */
+      static int add_children( std::vector<Node> & nodes, const int & i,
+                               const NSort<map_type> & s ) {
+        const int c = nodes.size();
+        const int b = nodes[i].begin;
+        nodes[i].child = c;
+        for (int j = 0; j < n_children; ++j)
+          nodes.push_back( Node(b + s.begin(j), b + s.end(j)) );
+        return c;
+      }
+
+      template < class Iter >
+      Vector<double,3> choose_pivot( const Iter & Ai, const Node & node,
+                                     workspace & w ) const {
+        typedef detail::split_dirs<DIMS> dirs;
+        Vector<double,3> pivot(0.0);
+
+        for (int k = 0; k < dirs::n; ++k) {
+          const int a = dirs::dir(k);
+          switch ( rule ) {
+            case CENTER: {
+              double lo = ref_of(*(Ai + node.begin)).x[a], hi = lo;
+              for (int i = node.begin + 1; i < node.end; ++i) {
+                const double & x = ref_of(*(Ai + i)).x[a];
+                if ( x < lo ) lo = x;
+                if ( x > hi ) hi = x;
+              }
+              pivot[a] = 0.5 * (lo + hi);
+              break;
+            }
+
+            case MEAN: {
+              double sum = 0.0;
+              for (int i = node.begin; i < node.end; ++i)
+                sum += ref_of(*(Ai + i)).x[a];
+              pivot[a] = sum / node.size();
+              break;
+            }
+
+            default: {
+              w.coords.resize( node.size() );
+              for (int i = node.begin; i < node.end; ++i)
+                w.coords[i - node.begin] = ref_of(*(Ai + i)).x[a];
+              std::vector<double>::iterator m =
+                w.coords.begin() + node.size() / 2;
+              std::nth_element(w.coords.begin(), m, w.coords.end());
+              pivot[a] = *m;
+            }
+          }
+        }
+
+        return pivot;
+      }
+    };/* Tree */
+
+    template < typename DIMS >
+    const int Tree<DIMS>::n_children;
+
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_Tree_h
@@ -0,0 +1,76 @@
+#ifndef olson_tools_nsort_detail_keys_h
+#define olson_tools_nsort_detail_keys_h
+
+#include <olson-tools/ref_of.h>
+
+#include <algorithm>
+
+namespace olson_tools {
+  namespace nsort {
+    namespace detail {
+
+      /** Key source that evaluates the map every time a key is needed.  The
+       * key sources give the sorting passes the value of the element at a
+       * given position and are told about every element move so that a key
+       * array (see cached_keys) can follow the elements.  */
+      template < class Iter, class Map >
+      struct map_keys {
+        typedef Iter iterator_type;
+        static const bool cached = false;
+
+        Iter Ai;
+        Map & map;
+
+        map_keys( const Iter & Ai, Map & map ) : Ai(Ai), map(map) { }
+
+        /** The key of the element at pos. */
+        inline int operator() ( const int & pos ) const {
+          return map(ref_of(*(Ai + pos)));
+        }
+
+        /** Evaluate (and store, if cached) the key of the element at pos. */
+        inline int compute( const int & pos ) { return (*this)(pos); }
+
+        inline void set( const int & /*pos*/, const int & /*k*/ ) { }
+        inline void move( const int & /*dst*/, const int & /*src*/ ) { }
+        inline void swap( const int & /*a*/, const int & /*b*/ ) { }
+      };
+
+      /** Key source backed by an array of keys that is filled during the
+       * counting pass. */
+      template < class Iter, class Map, typename KeyT >
+      struct cached_keys {
+        typedef Iter iterator_type;
+        static const bool cached = true;
+
+        Iter Ai;
+        Map & map;
+        KeyT * keys;
+
+        cached_keys( const Iter & Ai, Map & map, KeyT * keys )
+          : Ai(Ai), map(map), keys(keys) { }
+
+        inline int operator() ( const int & pos ) const { return keys[pos]; }
+
+        inline int compute( const int & pos ) {
+          return keys[pos] = static_cast<KeyT>( map(ref_of(*(Ai + pos))) );
+        }
+
+        inline void set( const int & pos, const int & k ) {
+          keys[pos] = static_cast<KeyT>(k);
+        }
+
+        inline void move( const int & dst, const int & src ) {
+          keys[dst] = keys[src];
+        }
+
+        inline void swap( const int & a, const int & b ) {
+          std::swap( keys[a], keys[b] );
+        }
+      };
+
+    }/* namespace detail */
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_detail_keys_h
@@ -0,0 +1,70 @@
+#ifndef olson_tools_nsort_detail_parallel_h
+#define olson_tools_nsort_detail_parallel_h
+
+#include <olson-tools/parallel_for.h>
+
+namespace olson_tools {
+  namespace nsort {
+    namespace detail {
+
+      /** The number of threads available to the parallel sorts.  With
+       * USE_PTHREAD this is the size of the default PThreadCache, with OpenMP
+       * it is omp_get_max_threads(), and otherwise 1. */
+      inline int max_threads() {
+#if defined(USE_PTHREAD)
+        return olson_tools::get_max_threads();
+#elif defined(_OPENMP)
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+      }
+
+      /** Choose the number of chunks for a parallel pass over n elements.
+       * @param requested
+       *    The caller's request; 0 means use max_threads() (but do not split
+       *    into chunks smaller than min_chunk).
+       */
+      inline int n_chunks( const int & n, const int & requested,
+                           const int & min_chunk = 4096 ) {
+        int nt = requested;
+        if ( nt <= 0 ) {
+          nt = max_threads();
+          if ( nt > n / min_chunk )
+            nt = n / min_chunk;
+        }
+        if ( nt > n ) nt = n;
+        return nt > 1 ? nt : 1;
+      }
+
+      /** The first index of chunk t of nt chunks of [0,n). */
+      inline int chunk_begin( const int & n, const int & nt, const int & t ) {
+        return static_cast<int>( (static_cast<long long>(n) * t) / nt );
+      }
+
+      /** Calls a chunk functor for each chunk of a range of chunks. */
+      template < typename F >
+      struct chunk_range {
+        F * f;
+        chunk_range( F & f ) : f(&f) { }
+        void operator() ( const int & b, const int & e ) const {
+          for (int t = b; t < e; ++t)
+            (*f)(t);
+        }
+      };
+
+      /** Call f(t) for all t in [0, n), concurrently if possible (see
+       * olson_tools::parallel_for).  f is shared (not copied) by all of the
+       * threads, so anything that it writes must be partitioned by t.  Chunk
+       * 0 is always executed by the calling thread.
+       */
+      template < typename F >
+      inline void run_chunks( const int & n, F & f ) {
+        olson_tools::parallel_for( 0, n, 1, chunk_range<F>(f) );
+      }
+
+    }/* namespace detail */
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_detail_parallel_h
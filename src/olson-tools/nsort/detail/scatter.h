@@ -0,0 +1,222 @@
+#ifndef olson_tools_nsort_detail_scatter_h
+#define olson_tools_nsort_detail_scatter_h
+
+#include <olson-tools/nsort/detail/parallel.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <new>
+
+namespace olson_tools {
+  namespace nsort {
+    namespace detail {
+
+      /** Size (in bytes) of each per-bin staging buffer of the
+       * write-combining scatter. */
+      static const unsigned int stage_bytes = 256u;
+
+      /** Largest total staging size (in bytes) for which the write-combining
+       * scatter is used; beyond this the staging buffers no longer stay in
+       * cache and a direct scatter is used instead. */
+      static const unsigned int max_stage_bytes = 1u << 20;
+
+      /** Smallest destination (in bytes) for which streaming (non-temporal)
+       * stores are used.  Smaller destinations are better left in cache. */
+      static const unsigned int stream_min_bytes = 1u << 23;
+
+      /** Copy bytes from src to dst, using streaming stores if requested and
+       * available.  stream_fence() must be called before the data is read by
+       * another thread. */
+      inline void stream_copy( void * dst, const void * src,
+                               size_t bytes, const bool & stream ) {
+#if defined(__SSE2__)
+        if ( stream ) {
+          char * d = static_cast<char*>(dst);
+          const char * s = static_cast<const char*>(src);
+
+          size_t head = (16u - (reinterpret_cast<uintptr_t>(d) & 15u)) & 15u;
+          if ( head > bytes ) head = bytes;
+          memcpy(d, s, head);
+          d += head; s += head; bytes -= head;
+
+          for (; bytes >= 16u; d += 16, s += 16, bytes -= 16u)
+            _mm_stream_si128( reinterpret_cast<__m128i*>(d),
+                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)) );
+          memcpy(d, s, bytes);
+          return;
+        }
+#endif
+        memcpy(dst, src, bytes);
+      }
+
+      /** Orders the streaming stores of stream_copy. */
+      inline void stream_fence() {
+#if defined(__SSE2__)
+        _mm_sfence();
+#endif
+      }
+
+      /** Store policy:  assign to an existing element. */
+      struct assign_element {
+        template < class Out, class V >
+        static inline void store( const Out & o, const V & v ) { *o = v; }
+      };
+
+      /** Store policy:  copy-construct into uninitialized memory. */
+      struct construct_element {
+        template < class T, class V >
+        static inline void store( T * o, const V & v ) {
+          ::new (static_cast<void*>(o)) T(v);
+        }
+      };
+
+      /** Direct (stable) scatter of chunk t of the list:  element i goes to
+       * Oi + offsets[t*n_values + key(i)]++.
+       * @see NSort::count_parallel for the offsets.
+       */
+      template < class Keys, class Out, class Store >
+      struct scatter_chunk {
+        const Keys & keys;
+        Out Oi;
+        int * perm;
+        int n, nt, n_values;
+        std::vector<int> & offsets;
+
+        scatter_chunk( const Keys & keys, const Out & Oi, int * perm,
+                       const int & n, const int & nt, const int & n_values,
+                       std::vector<int> & offsets )
+          : keys(keys), Oi(Oi), perm(perm), n(n), nt(nt),
+            n_values(n_values), offsets(offsets) { }
+
+        void operator() ( const int & t ) {
+          int * o = &offsets[t*n_values];
+          const int f = chunk_begin(n, nt, t + 1);
+          for (int i = chunk_begin(n, nt, t); i < f; ++i) {
+            const int j = o[keys(i)]++;
+            Store::store( Oi + j, *(keys.Ai + i) );
+            if ( perm )
+              perm[j] = i;
+          }
+        }
+      };
+
+      /** Scatter of the indices only (stable):  perm[j] is set to the index
+       * of the element that belongs at position j. */
+      template < class Keys >
+      struct index_chunk {
+        const Keys & keys;
+        int * perm;
+        int n, nt, n_values;
+        std::vector<int> & offsets;
+
+        index_chunk( const Keys & keys, int * perm, const int & n,
+                     const int & nt, const int & n_values,
+                     std::vector<int> & offsets )
+          : keys(keys), perm(perm), n(n), nt(nt), n_values(n_values),
+            offsets(offsets) { }
+
+        void operator() ( const int & t ) {
+          int * o = &offsets[t*n_values];
+          const int f = chunk_begin(n, nt, t + 1);
+          for (int i = chunk_begin(n, nt, t); i < f; ++i)
+            perm[ o[keys(i)]++ ] = i;
+        }
+      };
+
+      /** Write-combining (stable) scatter of chunk t of the list of trivially
+       * copyable elements into raw memory.  Elements are first collected in a small
+       * staging buffer per bin, which is written out (with streaming stores
+       * for large destinations) once full.  This turns the random writes of
+       * the direct scatter into full cache-line writes.
+       *
+       * The staging buffers of chunk t start at stage + t*stride (see
+       * stage_stride()) and the fill counts of chunk t at fill[t*n_values].
+       * Both are owned (and kept between sorts) by the caller; the staging
+       * buffers need not be initialized, but must be aligned for T.
+       */
+      template < class Keys, class T >
+      struct staged_scatter_chunk {
+        const Keys & keys;
+        T * Oi;
+        int * perm;
+        int n, nt, n_values;
+        std::vector<int> & offsets;
+        char * stage;
+        size_t stride;
+        std::vector<int> & fill;
+        bool stream;
+
+        staged_scatter_chunk( const Keys & keys, T * Oi, int * perm,
+                              const int & n, const int & nt,
+                              const int & n_values, std::vector<int> & offsets,
+                              char * stage, const size_t & stride,
+                              std::vector<int> & fill )
+          : keys(keys), Oi(Oi), perm(perm), n(n), nt(nt), n_values(n_values),
+            offsets(offsets), stage(stage), stride(stride), fill(fill),
+            stream( sizeof(T) * static_cast<size_t>(n) >= stream_min_bytes ) { }
+
+        /** Elements per staging buffer. */
+        static inline int stage_length() {
+          return sizeof(T) < stage_bytes ? stage_bytes / sizeof(T) : 1;
+        }
+
+        /** Bytes of staging space per chunk (rounded up to whole cache lines
+         * so that the chunks do not share lines). */
+        static inline size_t stage_stride( const int & n_values ) {
+          const size_t b = sizeof(T) * stage_length()
+                         * static_cast<size_t>(n_values);
+          return (b + 63u) & ~size_t(63u);
+        }
+
+        /** Whether staging is worthwhile for this many bins. */
+        static inline bool useful( const int & n_values ) {
+          return sizeof(T) < stage_bytes &&
+                 static_cast<size_t>(n_values) * stage_bytes <= max_stage_bytes;
+        }
+
+        void operator() ( const int & t ) {
+          const int B = stage_length();
+          T * stage = reinterpret_cast<T*>( this->stage + t * stride );
+          int * fill = &this->fill[t*n_values];
+          std::fill( fill, fill + n_values, 0 );
+          int * o = &offsets[t*n_values];
+
+          const int f = chunk_begin(n, nt, t + 1);
+          for (int i = chunk_begin(n, nt, t); i < f; ++i) {
+            const int k = keys(i);
+            int & c = fill[k];
+            if ( perm )
+              perm[o[k] + c] = i;
+            new (&stage[k*B + c]) T( *(keys.Ai + i) );
+
+            if ( ++c == B ) {
+              stream_copy( Oi + o[k], &stage[k*B], sizeof(T) * B, stream );
+              o[k] += B;
+              c = 0;
+            }
+          }
+
+          /* flush the partially filled staging buffers. */
+          for (int k = 0; k < n_values; ++k) {
+            if ( fill[k] ) {
+              memcpy( Oi + o[k], &stage[k*B], sizeof(T) * fill[k] );
+              o[k] += fill[k];
+            }
+          }
+
+          stream_fence();
+        }
+      };
+
+    }/* namespace detail */
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_detail_scatter_h
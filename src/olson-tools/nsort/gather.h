@@ -0,0 +1,143 @@
+#ifndef olson_tools_nsort_gather_h
+#define olson_tools_nsort_gather_h
+
+#include <olson-tools/nsort/detail/parallel.h>
+
+#include <vector>
+#include <algorithm>
+
+namespace olson_tools {
+  namespace nsort {
+
+    /** Applies a permutation (such as from NSort::sort_index) to any number
+     * of parallel arrays:  dst[j] = src[perm[j]] for each array.  This allows
+     * a structure-of-arrays particle store to be sorted without sorting an
+     * array of pointers:
+     *    \verbatim
+            std::vector<int> perm(n);
+            s.sort_index(cell.begin(), cell.end(), &perm[0]);
+            Gather()(&x[0], &x_new[0])
+                    (&v[0], &v_new[0])
+                    (&species[0], &species_new[0])
+                    .apply(&perm[0], n);
+          \endverbatim
+     *
+     * The arrays are processed together in blocks of the permutation, such
+     * that each block of perm is read from cache for all but the first array.
+     * The blocks are divided among the threads.
+     * */
+    class Gather {
+      /* TYPEDEFS */
+    public:
+      /** The number of permutation entries per block. */
+      static const int block = 1024;
+
+    private:
+      typedef void (*gather_fun)( const void * src, void * dst,
+                                  const int * perm,
+                                  const int & b, const int & e );
+
+      struct array {
+        const void * src;
+        void * dst;
+        gather_fun gather;
+      };
+
+      /** dst[j] = src[perm[j]] for j in [b, e). */
+      template < class T >
+      static void gather_range( const void * src, void * dst,
+                                const int * perm,
+                                const int & b, const int & e ) {
+        const T * s = static_cast<const T*>(src);
+        T * d = static_cast<T*>(dst);
+        static const int ahead = 8;
+        for (int j = b; j < e; ++j) {
+#if defined(__GNUC__)
+          if ( j + ahead < e )
+            __builtin_prefetch( s + perm[j + ahead] );
+#endif
+          d[j] = s[perm[j]];
+        }
+      }
+
+      /** Gathers the blocks of chunk t of nt. */
+      struct gather_chunk {
+        const std::vector<array> & arrays;
+        const int * perm;
+        int n, nt;
+
+        gather_chunk( const std::vector<array> & arrays, const int * perm,
+                      const int & n, const int & nt )
+          : arrays(arrays), perm(perm), n(n), nt(nt) { }
+
+        void operator() ( const int & t ) {
+          const int f = detail::chunk_begin(n, nt, t + 1);
+          for (int b = detail::chunk_begin(n, nt, t); b < f; b += block) {
+            const int e = b + block < f ? b + block : f;
+            for (unsigned int a = 0; a < arrays.size(); ++a)
+              arrays[a].gather( arrays[a].src, arrays[a].dst, perm, b, e );
+          }
+        }
+      };
+
+      /* STORAGE MEMBERS */
+      std::vector<array> arrays;
+
+      /* MEMBER FUNCTIONS */
+    public:
+      /** Add an array to the gather.  src and dst must not overlap.
+       * @return *this so that several arrays can be added in one statement.
+       */
+      template < class T >
+      Gather & operator() ( const T * src, T * dst ) {
+        array a = { src, dst, &gather_range<T> };
+        arrays.push_back(a);
+        return *this;
+      }
+
+      /** Remove all arrays. */
+      void clear() { arrays.clear(); }
+
+      /** The number of arrays. */
+      int size() const { return arrays.size(); }
+
+      /** Gather all of the arrays.
+       * @param perm
+       *    The permutation (of length n).
+       * @param nthreads
+       *    The number of threads to use.  [Default 0:  use all available
+       *    threads for large arrays.]
+       */
+      void apply( const int * perm, const int & n,
+                  const int & nthreads = 0 ) const {
+        const int nt = detail::n_chunks(n, nthreads, 4 * block);
+        gather_chunk g(arrays, perm, n, nt);
+        detail::run_chunks(nt, g);
+      }
+    };
+
+    /** Gather a single array:  dst[j] = src[perm[j]] for j in [0, n). */
+    template < class T >
+    inline void gather( const int * perm, const int & n,
+                        const T * src, T * dst, const int & nthreads = 0 ) {
+      Gather()(src, dst).apply(perm, n, nthreads);
+    }
+
+    /** Permute v by gathering it into buffer and then swapping the two.
+     * Keeping the buffer around between calls avoids reallocating it.
+     */
+    template < class T, class Alloc >
+    inline void apply_permutation( const int * perm, std::vector<T,Alloc> & v,
+                                   std::vector<T,Alloc> & buffer,
+                                   const int & nthreads = 0 ) {
+      buffer.resize(v.size());
+      if ( v.empty() )
+        return;
+      gather(perm, v.size(), &v[0], &buffer[0], nthreads);
+      v.swap(buffer);
+    }
+
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_gather_h
@@ -4,6 +4,7 @@
 
 #include <olson-tools/nsort/map/position_base.h>
 #include <olson-tools/nsort/map/depth_to_for1d.h>
+#include <olson-tools/nsort/map/static_number_values.h>
 
 #include <olson-tools/IteratorRange.h>
 
@@ -38,7 +39,7 @@ namespace olson_tools {
 
 
         _1D() {}
-        template <class T> _1D(const T & t) {}
+        template <class T> _1D(const T & /*t*/) {}
       
         inline int getNumberValues() const { return 2; }
         template<class _Particle>
@@ -46,6 +47,11 @@ namespace olson_tools {
           return p.x[_dir] >= pivot[_dir];
         }
       };
+
+      template <unsigned int _dir, class Map>
+      struct tag_number_values< tag::_1D<_dir>, Map > {
+        static const int value = 2;
+      };
     }
   }/*namespace nsort */
 }/*namespace olson_tools */
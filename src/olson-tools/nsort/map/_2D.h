@@ -4,6 +4,7 @@
 
 #include <olson-tools/nsort/map/_1D.h>
 #include <olson-tools/nsort/map/depth_to_for2d.h>
+#include <olson-tools/nsort/map/static_number_values.h>
 
 namespace olson_tools {
   namespace nsort {
@@ -37,7 +38,7 @@ namespace olson_tools {
       
       
         _2D() {}
-        template <class T> _2D(const T & t) {}
+        template <class T> _2D(const T & /*t*/) {}
       
         inline int getNumberValues() const { return 4; }
         template<class _Particle>
@@ -45,6 +46,11 @@ namespace olson_tools {
           return oneD::operator()(p) + 2*(p.x[_dir] >= oneD::pivot[_dir]);
         }
       };
+
+      template <unsigned int _dir0, unsigned int _dir1, class Map>
+      struct tag_number_values< tag::_2D<_dir0,_dir1>, Map > {
+        static const int value = 4;
+      };
     }
   }
 }
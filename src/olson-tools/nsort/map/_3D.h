@@ -4,6 +4,7 @@
 
 #include <olson-tools/nsort/map/_2D.h>
 #include <olson-tools/nsort/map/depth_to_for3d.h>
+#include <olson-tools/nsort/map/static_number_values.h>
 
 namespace olson_tools {
   namespace nsort {
@@ -36,7 +37,7 @@ namespace olson_tools {
 
       
         _3D() {}
-        template <class T> _3D(const T & t) {}
+        template <class T> _3D(const T & /*t*/) {}
       
         inline int getNumberValues() const { return 8; }
         template<class _Particle>
@@ -44,6 +45,12 @@ namespace olson_tools {
           return twoD::operator()(p) + 4*(p.x[_dir] >= twoD::pivot[_dir]);
         }
       };
+
+      template <unsigned int _dir0, unsigned int _dir1, unsigned int _dir2,
+                class Map>
+      struct tag_number_values< tag::_3D<_dir0,_dir1,_dir2>, Map > {
+        static const int value = 8;
+      };
     }
   }
 }
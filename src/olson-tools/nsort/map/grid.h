@@ -0,0 +1,139 @@
+
+#ifndef olson_tools_nsort_map_grid_h
+#define olson_tools_nsort_map_grid_h
+
+#include <olson-tools/Vector.h>
+#include <olson-tools/nsort/map/static_number_values.h>
+
+namespace olson_tools {
+  namespace nsort {
+    namespace map {
+      namespace tag {
+        /** Simple tag class that can be used to detect this map. */
+        template <unsigned int nx, unsigned int ny, unsigned int nz>
+        struct grid {};
+
+        /** Simple tag class that can be used to detect this map. */
+        struct runtime_grid {};
+      }
+
+      /** The bounds of a uniform grid of cells over the box [xmin, xmax).
+       * This holds what is common to the grid maps (grid, runtime_grid and
+       * morton).
+       * */
+      struct grid_base {
+        /** The lower corner of the grid. */
+        Vector<double,3> xmin;
+        /** The inverse of the size of the box in each direction. */
+        Vector<double,3> inv_L;
+
+        grid_base() : xmin(0.0), inv_L(1.0) {}
+
+        grid_base( const Vector<double,3> & xmin,
+                   const Vector<double,3> & xmax ) {
+          set_bounds(xmin, xmax);
+        }
+
+        /** Set the box that is divided into cells. */
+        void set_bounds( const Vector<double,3> & xmin,
+                         const Vector<double,3> & xmax ) {
+          this->xmin = xmin;
+          for (int a = 0; a < 3; ++a)
+            inv_L[a] = 1.0 / (xmax[a] - xmin[a]);
+        }
+
+        /** The cell index (of n cells) of position x in direction a.  Positions
+         * outside of the box are put into the edge cells, since NSort does not
+         * check for out of range values. */
+        inline int cell( const double & x, const int & a,
+                         const unsigned int & n ) const {
+          const int i = static_cast<int>( (x - xmin[a]) * inv_L[a] * n );
+          if ( i < 0 )                       return 0;
+          if ( i >= static_cast<int>(n) )    return n - 1;
+          return i;
+        }
+      };
+
+      /** maps x[0],x[1],x[2] to the index of the cell of a uniform _nx by _ny
+       * by _nz grid, with x varying fastest:
+       *   <code>ix + _nx*(iy + _ny*iz)</code>.
+       * Setting _ny (and _nz) to 1 gives a 1D (2D) grid.
+       *
+       * This sorts a list into all of the cells of a grid in a single NSort
+       * pass (instead of recursing with _3D).  Combine with w_species to sort
+       * by cell and species at once:
+       *    \verbatim
+              w_species< grid<16,16,16> > map(n_species, grid<16,16,16>(xmin,xmax));
+            \endverbatim
+       * */
+      template < unsigned int _nx, unsigned int _ny = 1u, unsigned int _nz = 1u >
+      struct grid : grid_base {
+        /* TYPEDEFS */
+        typedef tag::grid<_nx,_ny,_nz> tag;
+        typedef void super;
+
+        /** The number of spatial dimensions. */
+        static const unsigned int spatial_dimensions =
+          (_nz > 1u ? 3u : (_ny > 1u ? 2u : 1u));
+
+        static const unsigned int nx = _nx;
+        static const unsigned int ny = _ny;
+        static const unsigned int nz = _nz;
+
+        grid() {}
+        grid( const Vector<double,3> & xmin, const Vector<double,3> & xmax )
+          : grid_base(xmin, xmax) {}
+        template <class T> grid(const T & /*t*/) {}
+
+        inline int getNumberValues() const { return _nx * _ny * _nz; }
+
+        template<class _Particle>
+        inline int operator()(const _Particle & p) const {
+          int i = 0;
+          if ( _nz > 1u ) i = cell(p.x[2], 2, _nz);
+          if ( _ny > 1u ) i = i * _ny + cell(p.x[1], 1, _ny);
+          return i * _nx + cell(p.x[0], 0, _nx);
+        }
+      };
+
+      template <unsigned int _nx, unsigned int _ny, unsigned int _nz, class Map>
+      struct tag_number_values< tag::grid<_nx,_ny,_nz>, Map > {
+        static const int value = _nx * _ny * _nz;
+      };
+
+      /** The same as grid, but with the number of cells in each direction
+       * given at runtime. */
+      struct runtime_grid : grid_base {
+        /* TYPEDEFS */
+        typedef tag::runtime_grid tag;
+        typedef void super;
+
+        /** The number of cells in each direction. */
+        unsigned int n[3];
+
+        runtime_grid( const Vector<double,3> & xmin = 0.0,
+                      const Vector<double,3> & xmax = 1.0,
+                      const unsigned int & nx = 1u,
+                      const unsigned int & ny = 1u,
+                      const unsigned int & nz = 1u )
+          : grid_base(xmin, xmax) {
+          n[0] = nx;
+          n[1] = ny;
+          n[2] = nz;
+        }
+
+        inline int getNumberValues() const { return n[0] * n[1] * n[2]; }
+
+        template<class _Particle>
+        inline int operator()(const _Particle & p) const {
+          return cell(p.x[0], 0, n[0])
+               + n[0] * ( cell(p.x[1], 1, n[1])
+                        + n[1] *  cell(p.x[2], 2, n[2]) );
+        }
+      };
+
+    }/* namespace map */
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_map_grid_h
@@ -3,6 +3,8 @@
 #ifndef olson_tools_nsort_map_identity_h
 #define olson_tools_nsort_map_identity_h
 
+#include <olson-tools/nsort/map/static_number_values.h>
+
 namespace olson_tools {
   namespace nsort {
     namespace map {
@@ -22,6 +24,11 @@ namespace olson_tools {
         identity() {}
         template <class TT> identity(const TT & tt) : T(tt) {}
       };
+
+      /** identity does not change the number of values. */
+      template <class Map>
+      struct tag_number_values< tag::identity, Map >
+        : static_number_values< typename Map::super > { };
     }/*namespace map */
   }/*namespace nsort */
 }/* namespace olson_tools */
@@ -0,0 +1,91 @@
+
+#ifndef olson_tools_nsort_map_morton_h
+#define olson_tools_nsort_map_morton_h
+
+#include <olson-tools/nsort/map/grid.h>
+#include <olson-tools/nsort/map/static_number_values.h>
+
+#include <boost/static_assert.hpp>
+
+namespace olson_tools {
+  namespace nsort {
+    namespace map {
+      namespace tag {
+        /** Simple tag class that can be used to detect this map. */
+        template <unsigned int bits, unsigned int dims>
+        struct morton {};
+      }
+
+      /** maps x[0],x[1](,x[2]) to the Morton (Z-order) index of the cell of a
+       * 2^_bits per side grid:  the bits of the cell indices are interleaved
+       * (x in the lowest bit).  Sorting by this map orders the list along a
+       * space filling curve such that neighboring elements of the list are
+       * also (mostly) close in space.  Since the leading bits of the index
+       * are those of a coarser grid, the bins of a morton<_bits> sort are
+       * also contiguous groups of the cells of any morton<b> for b < _bits.
+       *
+       * Note that NSort uses one bin per value, so that _bits should be kept
+       * small enough for 2^(_dims*_bits) bins to be reasonable.
+       * */
+      template < unsigned int _bits, unsigned int _dims = 3u >
+      struct morton : grid_base {
+        BOOST_STATIC_ASSERT( _dims == 2u || _dims == 3u );
+        BOOST_STATIC_ASSERT( _bits * _dims <= 30u );
+
+        /* TYPEDEFS */
+        typedef tag::morton<_bits,_dims> tag;
+        typedef void super;
+
+        /** The number of spatial dimensions. */
+        static const unsigned int spatial_dimensions = _dims;
+        /** The number of bits per dimension. */
+        static const unsigned int bits = _bits;
+
+        morton() {}
+        morton( const Vector<double,3> & xmin, const Vector<double,3> & xmax )
+          : grid_base(xmin, xmax) {}
+        template <class T> morton(const T & /*t*/) {}
+
+        inline int getNumberValues() const { return 1 << (_bits * _dims); }
+
+        template<class _Particle>
+        inline int operator()(const _Particle & p) const {
+          const unsigned int n = 1u << _bits;
+          if ( _dims == 2u )
+            return   spread2( cell(p.x[0], 0, n) )
+                   | spread2( cell(p.x[1], 1, n) ) << 1;
+          else
+            return   spread3( cell(p.x[0], 0, n) )
+                   | spread3( cell(p.x[1], 1, n) ) << 1
+                   | spread3( cell(p.x[2], 2, n) ) << 2;
+        }
+
+        /** Spread the lower 15 bits of i to every other bit. */
+        static inline unsigned int spread2(unsigned int i) {
+          i = (i | (i << 8)) & 0x00ff00ffu;
+          i = (i | (i << 4)) & 0x0f0f0f0fu;
+          i = (i | (i << 2)) & 0x33333333u;
+          i = (i | (i << 1)) & 0x55555555u;
+          return i;
+        }
+
+        /** Spread the lower 10 bits of i to every third bit. */
+        static inline unsigned int spread3(unsigned int i) {
+          i = (i | (i << 16)) & 0x030000ffu;
+          i = (i | (i <<  8)) & 0x0300f00fu;
+          i = (i | (i <<  4)) & 0x030c30c3u;
+          i = (i | (i <<  2)) & 0x09249249u;
+          return i;
+        }
+      };
+
+      template <unsigned int _bits, unsigned int _dims, class Map>
+      struct tag_number_values< tag::morton<_bits,_dims>, Map > {
+        static const int value = 1 << (_bits * _dims);
+      };
+
+    }/* namespace map */
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_map_morton_h
@@ -3,6 +3,7 @@
 
 #include <olson-tools/Vector.h>
 #include <olson-tools/IteratorRange.h>
+#include <olson-tools/nsort/map/static_number_values.h>
 
 namespace olson_tools {
   namespace nsort {
@@ -94,6 +95,11 @@ namespace olson_tools {
         }
         /* ** END CONSTRUCTORS ** */
       };
+
+      /** pivot_ctor does not change the number of values. */
+      template <class Map>
+      struct tag_number_values< tag::pivot_ctor, Map >
+        : static_number_values< typename Map::super > { };
       
     }/* namespace map*/
   }/* namespace nsort */
@@ -0,0 +1,46 @@
+
+#ifndef olson_tools_nsort_map_ptr_h
+#define olson_tools_nsort_map_ptr_h
+
+#include <olson-tools/ref_of.h>
+#include <olson-tools/nsort/map/static_number_values.h>
+
+namespace olson_tools {
+  namespace nsort {
+    namespace map {
+      namespace tag {
+        struct ptr {};
+      }
+
+      /** Wraps a map of value types such that it can be used on pointers to
+       * the values (values are passed on as they are).  The NSort key sources
+       * already dereference pointers before calling the map, but this wrapper
+       * is needed when the map is called directly on the elements of a list of
+       * pointers.
+       * */
+      template <class T>
+      struct ptr : T {
+        typedef tag::ptr tag;
+        typedef T super;
+
+        ptr() {}
+        template <class TT> ptr(const TT & tt) : T(tt) {}
+
+        /** Map operation used when performing sorting. */
+        template<class Particle>
+        inline int operator()(const Particle & p) const {
+          return T::operator()(ref_of(p));
+        }
+
+      };/*struct ptr */
+
+      /** ptr does not change the number of values. */
+      template <class Map>
+      struct tag_number_values< tag::ptr, Map >
+        : static_number_values< typename Map::super > { };
+    }/*namespace map */
+  }/*namespace nsort */
+}/*namespace olson_tools */
+
+
+#endif // olson_tools_nsort_map_ptr_h
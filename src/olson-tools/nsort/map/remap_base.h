@@ -4,7 +4,7 @@
 
 #include <olson-tools/nsort/map/_3D.h>
 
-#include <set>
+#include <algorithm>
 
 namespace olson_tools {
   namespace nsort {
@@ -30,18 +30,25 @@ namespace olson_tools {
 
         /** The remap map. */
         int m_remap[nval];
-      
+
+      private:
+        /** The m_remap[] for which n_unique was last counted. */
+        mutable int m_counted[nval];
+        /** The number of unique values in m_counted[]. */
+        mutable int n_unique;
+
+      public:
 
         /* FUNCTION MEMBERS */
         /** Default constructor calls 'reset'.
          * @see reset. */
-        remap_base() {
+        remap_base() : n_unique(-1) {
           reset();
         }
 
         /** Single arg constructor required by wrapping components.*/
         template <class TT>
-        remap_base(const TT & tt) : T(tt) {
+        remap_base(const TT & tt) : T(tt), n_unique(-1) {
           reset();
         }
 
@@ -53,12 +60,18 @@ namespace olson_tools {
 
         /** Returns the number of unique values.  This function cannot be
          * optimized away during compilation because it relies on runtime
-         * calculations.
+         * calculations.  The count is cached and only redone (without heap
+         * allocation) when m_remap[] has changed since the last call.
          * */
         inline int getNumberValues() const {
-          /** \todo Is there a way to make this not rely on heap allocation? */
-          std::set<int> s(m_remap, m_remap+nval);
-          return s.size();
+          if ( n_unique < 0 || !std::equal(m_remap, m_remap+nval, m_counted) ) {
+            std::copy(m_remap, m_remap+nval, m_counted);
+            int s[nval];
+            std::copy(m_remap, m_remap+nval, s);
+            std::sort(s, s+nval);
+            n_unique = std::unique(s, s+nval) - s;
+          }
+          return n_unique;
         }
 
         /** Actual remap operation used when performing sorting. */
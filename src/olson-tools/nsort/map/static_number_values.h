@@ -0,0 +1,44 @@
+#ifndef olson_tools_nsort_map_static_number_values_h
+#define olson_tools_nsort_map_static_number_values_h
+
+namespace olson_tools {
+  namespace nsort {
+    namespace map {
+      namespace detail {
+        /** Whether T has a nested tag type. */
+        template < typename T >
+        struct has_tag {
+          typedef char yes;
+          typedef char (&no)[2];
+          template < typename U > static yes test( typename U::tag * );
+          template < typename U > static no  test( ... );
+          static const bool value = sizeof(test<T>(0)) == sizeof(yes);
+        };
+      }
+
+      /** The number of values of a map that is known at compile time (as for
+       * the 8 values of _3D), or 0 if it is only known at runtime.  This is
+       * looked up by the tag of the map:  maps with a fixed number of values
+       * specialize tag_number_values for their tag (see _3D.h) and wrappers
+       * that do not change the number of values (such as pivot_ctor) forward
+       * to their super.  All other maps (including maps without a tag) give 0.
+       * */
+      template < typename Map, bool = detail::has_tag<Map>::value >
+      struct static_number_values {
+        static const int value = 0;
+      };
+
+      template < typename Tag, typename Map >
+      struct tag_number_values {
+        static const int value = 0;
+      };
+
+      template < typename Map >
+      struct static_number_values<Map,true>
+        : tag_number_values< typename Map::tag, Map > { };
+
+    }/* namespace map */
+  }/* namespace nsort */
+}/* namespace olson_tools */
+
+#endif // olson_tools_nsort_map_static_number_values_h
@@ -0,0 +1,142 @@
+#include <olson-tools/nsort/map/grid.h>
+#include <olson-tools/nsort/map/morton.h>
+#include <olson-tools/nsort/map/w_species.h>
+#include <olson-tools/nsort/map/ptr.h>
+#include <olson-tools/nsort/NSort.h>
+#include <olson-tools/Vector.h>
+
+#define BOOST_TEST_MODULE  grid
+
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <vector>
+
+
+namespace {
+  using olson_tools::Vector;
+  using olson_tools::V3;
+  struct Particle {
+    Vector<double, 3> x;
+    unsigned int species;
+
+    Particle(const Vector<double,3> & x = 0.0,
+             const unsigned int & species = 0 ) : x(x), species(species) {}
+  };
+
+  const unsigned int & species( const Particle & p ) {
+    return p.species;
+  }
+
+  double frand() { return std::rand() / (RAND_MAX + 1.0); }
+}
+
+
+BOOST_AUTO_TEST_SUITE( map_grid );
+
+BOOST_AUTO_TEST_CASE( grid_3D ) {
+  using olson_tools::nsort::map::grid;
+  typedef grid<4,3,2> map_t;
+  map_t map(V3(-1,-1,-1), V3(1,2,3));
+
+  int d = map_t::spatial_dimensions;
+  BOOST_CHECK_EQUAL( d, 3 );
+  BOOST_CHECK_EQUAL( map.getNumberValues(), 24 );
+
+  Particle p;
+  p.x = V3(-1,-1,-1);
+  BOOST_CHECK_EQUAL( map(p), 0 );
+
+  /* cell (1,2,1) */
+  p.x = V3(-0.25, 1.5, 1.5);
+  BOOST_CHECK_EQUAL( map(p), 1 + 4*(2 + 3*1) );
+
+  /* outside of the box:  edge cells. */
+  p.x = V3(-5, 10, 10);
+  BOOST_CHECK_EQUAL( map(p), 0 + 4*(2 + 3*1) );
+  p.x = V3(1, 2, 3);
+  BOOST_CHECK_EQUAL( map(p), 23 );
+
+  /* 1D and 2D */
+  d = grid<8>::spatial_dimensions;
+  BOOST_CHECK_EQUAL( d, 1 );
+  d = grid<8,8>::spatial_dimensions;
+  BOOST_CHECK_EQUAL( d, 2 );
+  grid<8> map1(V3(0,0,0), V3(8,1,1));
+  p.x = V3(5.5, 100., 100.);
+  BOOST_CHECK_EQUAL( map1(p), 5 );
+}
+
+BOOST_AUTO_TEST_CASE( runtime_grid ) {
+  using olson_tools::nsort::map::grid;
+  using olson_tools::nsort::map::runtime_grid;
+  grid<5,4,3> cmap(V3(0,0,0), V3(1,1,1));
+  runtime_grid rmap(V3(0,0,0), V3(1,1,1), 5, 4, 3);
+  BOOST_CHECK_EQUAL( rmap.getNumberValues(), 60 );
+
+  for (int i = 0; i < 1000; ++i) {
+    Particle p( V3(frand(), frand(), frand()) );
+    BOOST_CHECK_EQUAL( rmap(p), cmap(p) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( morton ) {
+  using olson_tools::nsort::map::morton;
+  morton<2> map(V3(0,0,0), V3(4,4,4));
+  BOOST_CHECK_EQUAL( map.getNumberValues(), 64 );
+
+  Particle p;
+  /* (1,2,3) = (01,10,11) -> z1 y1 x1 z0 y0 x0 = 1 1 0 1 0 1 */
+  p.x = V3(1.5, 2.5, 3.5);
+  BOOST_CHECK_EQUAL( map(p), 0x35 );
+
+  morton<3,2> map2(V3(0,0,0), V3(8,8,8));
+  BOOST_CHECK_EQUAL( map2.getNumberValues(), 64 );
+  /* (5,3) = (101,011) -> y2 x2 y1 x1 y0 x0 = 0 1 1 0 1 1 */
+  p.x = V3(5.5, 3.5, 0.);
+  BOOST_CHECK_EQUAL( map2(p), 0x1b );
+
+  /* the first bits are those of a coarser morton map. */
+  morton<1> coarse(V3(0,0,0), V3(4,4,4));
+  for (int i = 0; i < 1000; ++i) {
+    p.x = V3(4*frand(), 4*frand(), 4*frand());
+    BOOST_CHECK_EQUAL( map(p) >> 3, coarse(p) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( compose ) {
+  using olson_tools::nsort::map::grid;
+  using olson_tools::nsort::map::morton;
+  using olson_tools::nsort::map::w_species;
+  using olson_tools::nsort::map::ptr;
+  using olson_tools::nsort::NSort;
+  typedef w_species< grid<4,4,4> > wmap_t;
+  typedef ptr< w_species< morton<2> > > pmap_t;
+  const unsigned int n_species = 3u;
+
+  wmap_t wmap(n_species, grid<4,4,4>(V3(0,0,0), V3(1,1,1)));
+  pmap_t pmap( w_species< morton<2> >(n_species, morton<2>(V3(0,0,0), V3(1,1,1))) );
+  BOOST_CHECK_EQUAL( wmap.getNumberValues(), 192 );
+  BOOST_CHECK_EQUAL( pmap.getNumberValues(), 192 );
+
+  std::vector<Particle> v;
+  for (int i = 0; i < 5000; ++i)
+    v.push_back( Particle(V3(frand(), frand(), frand()), std::rand() % n_species) );
+  std::vector<Particle*> pv;
+  for (unsigned int i = 0; i < v.size(); ++i)
+    pv.push_back( &v[i] );
+
+  /* a single pass sort into (cell, species) bins. */
+  NSort<wmap_t> s(wmap.getNumberValues());
+  s.sort(v.begin(), v.end(), wmap);
+  for (int i = 0; i < s.size(); ++i)
+    for (int j = s.begin(i); j < s.end(i); ++j)
+      BOOST_CHECK_EQUAL( wmap(v[j]), i );
+
+  NSort<pmap_t> ps(pmap.getNumberValues());
+  ps.sort(pv.begin(), pv.end(), pmap);
+  for (int i = 0; i < ps.size(); ++i)
+    for (int j = ps.begin(i); j < ps.end(i); ++j)
+      BOOST_CHECK_EQUAL( pmap(pv[j]), i );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
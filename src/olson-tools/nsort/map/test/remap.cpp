@@ -68,7 +68,9 @@ BOOST_AUTO_TEST_CASE( remap_1D ) {
 
 
   /* Now check after re-mapping. */
+  BOOST_CHECK_EQUAL( rmap.getNumberValues(), 2 );
   rmap.m_remap[1] = 0;
+  BOOST_CHECK_EQUAL( rmap.getNumberValues(), 1 );
   p.x[0] = -1;
   BOOST_CHECK_EQUAL( rmap(p), 0 );
 
@@ -168,6 +170,7 @@ BOOST_AUTO_TEST_CASE( remap_3D ) {
   /* Check after re-mapping by hand a few values at a time */
   rmap.m_remap[0] = 2; rmap.m_remap[2] = 4; rmap.m_remap[4] = 6;
   rmap.m_remap[3] = 5; rmap.m_remap[5] = 3; rmap.m_remap[7] = 1;
+  BOOST_CHECK_EQUAL( rmap.getNumberValues(), 6 );
   p.x[0] = -1; p.x[1] = -1; p.x[2] = -1;
   BOOST_CHECK_EQUAL( rmap(p), 2 );
 
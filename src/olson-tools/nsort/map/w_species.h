@@ -27,6 +27,10 @@ namespace olson_tools {
         const unsigned int n_species;
 
         w_species(const unsigned int & n_species) : n_species(n_species) {}
+        /** Constructor for wrapped maps that need their own parameters (such
+         * as the bounds of a grid). */
+        w_species(const unsigned int & n_species, const T & t)
+          : T(t), n_species(n_species) {}
         template <class TT> w_species(const TT & tt) : T(tt) {}
 
         inline int getNumberValues() const {
@@ -1,9 +1,68 @@
 #define BOOST_TEST_MODULE  NSort
 
 #include <olson-tools/nsort/NSort.h>
+#include <olson-tools/nsort/gather.h>
+#include <olson-tools/nsort/map/_3D.h>
+#include <olson-tools/nsort/map/w_species.h>
+#include <olson-tools/Vector.h>
 
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+  /** An element that remembers its original position. */
+  struct Item {
+    int value;
+    int index;
+  };
+
+  struct item_value {
+    int operator() ( const Item & i ) const { return i.value; }
+  };
+
+  struct Point {
+    olson_tools::Vector<double,3> x;
+  };
+
+  /** A trivially copyable, but not POD, element (like a Particle). */
+  struct Body {
+    Body( const int & value = 0, const int & index = 0 )
+      : x(double(index)), value(value), index(index) { }
+    olson_tools::Vector<double,3> x;
+    int value;
+    int index;
+  };
+
+  struct body_value {
+    int operator() ( const Body & b ) const { return b.value; }
+  };
+
+  std::vector<Item> random_items( const int & n, const int & n_values ) {
+    std::vector<Item> v(n);
+    for (int i = 0; i < n; ++i) {
+      v[i].value = std::rand() % n_values;
+      v[i].index = i;
+    }
+    return v;
+  }
+
+  /** Checks that v is sorted and consistent with the NSort bins. */
+  template < typename NSorter >
+  void check_sorted( const std::vector<Item> & v, const NSorter & s,
+                     const bool & stable ) {
+    for (int i = 0; i < s.size(); ++i) {
+      for (int j = s.begin(i); j < s.end(i); ++j) {
+        BOOST_CHECK_EQUAL( v[j].value, i );
+        if ( stable && j > s.begin(i) )
+          BOOST_CHECK_LT( v[j-1].index, v[j].index );
+      }
+    }
+    BOOST_CHECK_EQUAL( s.end(s.size()-1), static_cast<int>(v.size()) );
+  }
+}
 
 
 BOOST_AUTO_TEST_SUITE( NSort );
@@ -33,5 +92,315 @@ BOOST_AUTO_TEST_CASE( std_vector ) {
     BOOST_CHECK_EQUAL( sv[i], ans[i] );
 }
 
+BOOST_AUTO_TEST_CASE( parallel ) {
+  const int n_values = 37;
+  olson_tools::nsort::NSort<item_value> s(n_values);
+
+  /* explicit thread counts also exercise the chunking without threads. */
+  const int threads[] = {0, 1, 2, 3, 8};
+  for (unsigned int t = 0; t < sizeof(threads)/sizeof(int); ++t) {
+    std::vector<Item> v = random_items(10007, n_values);
+    s.sort_parallel(v.begin(), v.end(), item_value(), olson_tools::nsort::tweak::Null(), threads[t]);
+    check_sorted(v, s, true);
+
+    v = random_items(10007, n_values);
+    s.sort_parallel_inplace(v.begin(), v.end(), item_value(), olson_tools::nsort::tweak::Null(), threads[t]);
+    check_sorted(v, s, false);
+  }
+
+  /* degenerate distributions. */
+  std::vector<Item> v = random_items(1000, 1);
+  s.sort_parallel_inplace(v.begin(), v.end(), item_value(), olson_tools::nsort::tweak::Null(), 4);
+  check_sorted(v, s, false);
+
+  v = random_items(5, n_values);
+  s.sort_parallel_inplace(v.begin(), v.end(), item_value(), olson_tools::nsort::tweak::Null(), 8);
+  check_sorted(v, s, false);
+}
+
+BOOST_AUTO_TEST_CASE( cached_keys ) {
+  using olson_tools::nsort::tweak::Null;
+
+  /* 1 and 2 byte keys. */
+  const int n_values[] = {37, 300};
+  for (unsigned int nv = 0; nv < 2; ++nv) {
+    olson_tools::nsort::NSort<item_value> s(n_values[nv], true);
+    BOOST_CHECK_EQUAL( s.key_size(), nv == 0 ? 1 : 2 );
+
+    for (int variant = 0; variant < 3; ++variant) {
+      std::vector<Item> v = random_items(10007, n_values[nv]);
+      switch ( variant ) {
+        case 0: s.sort(v.begin(), v.end()); break;
+        case 1: s.sort_parallel(v.begin(), v.end(), item_value(), Null(), 3); break;
+        case 2: s.sort_parallel_inplace(v.begin(), v.end(), item_value(), Null(), 3); break;
+      }
+      check_sorted(v, s, variant == 1);
+
+      /* the keys must follow the elements. */
+      BOOST_CHECK_EQUAL( s.number_keys(), static_cast<int>(v.size()) );
+      for (unsigned int i = 0; i < v.size(); ++i)
+        BOOST_CHECK_EQUAL( s.key(i), v[i].value );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( radix ) {
+  /* {n_values, radix threshold, n}:  two digits, two small digits, three
+   * digits (mostly small buckets). */
+  const int cases[][3] = { {300000, 0x10000, 100003},
+                           {5000, 1000, 10007},
+                           {5000000, 0x10000, 20011} };
+  for (unsigned int c = 0; c < 3; ++c) {
+    for (int cache = 0; cache < 2; ++cache) {
+      olson_tools::nsort::NSort<item_value> s(cases[c][0], cache == 1);
+      s.set_radix_threshold(cases[c][1]);
+
+      std::vector<Item> v = random_items(cases[c][2], cases[c][0]);
+      s.sort(v.begin(), v.end());
+      check_sorted(v, s, false);
+
+      if ( cache == 1 ) {
+        BOOST_CHECK_EQUAL( s.number_keys(), static_cast<int>(v.size()) );
+        for (unsigned int i = 0; i < v.size(); ++i)
+          BOOST_CHECK_EQUAL( s.key(i), v[i].value );
+      }
+    }
+  }
+
+  /* the same list and bins as the single pass. */
+  olson_tools::nsort::NSort<item_value> s(300000), s1(300000);
+  s1.set_radix_threshold(0);
+  std::vector<Item> v = random_items(50000, 300000), v1 = v;
+  s.sort(v.begin(), v.end());
+  s1.sort(v1.begin(), v1.end());
+  for (int i = 0; i < 300000; ++i)
+    BOOST_CHECK_EQUAL( s.end(i), s1.end(i) );
+}
+
+BOOST_AUTO_TEST_CASE( copy ) {
+  using olson_tools::nsort::tweak::Null;
+  const int n_values = 37;
+  olson_tools::nsort::NSort<item_value> s(n_values);
+
+  /* the large size is written with streaming stores. */
+  const int sizes[] = {10007, 1100000};
+  const int threads[] = {1, 3};
+  for (unsigned int n = 0; n < 2; ++n) {
+    for (unsigned int t = 0; t < 2; ++t) {
+      const std::vector<Item> v = random_items(sizes[n], n_values);
+      std::vector<Item> out(v.size());
+      std::vector<int> perm(v.size());
+
+      /* write-combining path (POD pointers). */
+      s.sort_copy(&v[0], &v[0] + v.size(), &out[0], &perm[0], item_value(), Null(), threads[t]);
+      check_sorted(out, s, true);
+      for (unsigned int i = 0; i < v.size(); ++i)
+        BOOST_CHECK_EQUAL( out[i].index, v[perm[i]].index );
+
+      /* direct path (iterators). */
+      std::vector<Item> out2(v.size());
+      s.sort_copy(v.begin(), v.end(), out2.begin(), NULL, item_value(), Null(), threads[t]);
+      check_sorted(out2, s, true);
+    }
+  }
+
+  /* elements that are not POD, but may still be staged. */
+  olson_tools::nsort::NSort<body_value> sb(n_values);
+  std::vector<Body> b, bout(100003);
+  for (int i = 0; i < 100003; ++i)
+    b.push_back( Body(std::rand() % n_values, i) );
+  sb.sort_copy(&b[0], &b[0] + b.size(), &bout[0], NULL, body_value(), Null(), 3);
+  for (int i = 0; i < sb.size(); ++i) {
+    for (int j = sb.begin(i); j < sb.end(i); ++j) {
+      BOOST_CHECK_EQUAL( bout[j].value, i );
+      BOOST_CHECK_EQUAL( bout[j].x[2], double(bout[j].index) );
+      if ( j > sb.begin(i) )
+        BOOST_CHECK_LT( bout[j-1].index, bout[j].index );
+    }
+  }
+
+  std::vector<Item> v = random_items(10007, n_values), buffer;
+  s.sort_swap(v, buffer);
+  check_sorted(v, s, true);
+  BOOST_CHECK_EQUAL( buffer.size(), v.size() );
+}
+
+BOOST_AUTO_TEST_CASE( resort ) {
+  using olson_tools::nsort::tweak::Null;
+  const int n_values = 37;
+  olson_tools::nsort::NSort<item_value> s(n_values, true);
+
+  std::vector<Item> v = random_items(10007, n_values);
+  /* nothing to go on before the first sort. */
+  BOOST_CHECK( !s.resort(v.begin(), v.end()) );
+  check_sorted(v, s, false);
+
+  for (int round = 0; round < 10; ++round) {
+    /* change the values of a few percent of the elements. */
+    std::vector<int> changed;
+    for (int c = 0; c < 300; ++c) {
+      const int i = std::rand() % v.size();
+      v[i].value = std::rand() % n_values;
+      changed.push_back(i);
+    }
+
+    std::vector<int> before(v.size());
+    for (unsigned int i = 0; i < v.size(); ++i)
+      before[i] = v[i].index;
+
+    if ( round % 2 )
+      BOOST_CHECK( s.resort(v.begin(), v.end()) );
+    else
+      BOOST_CHECK( s.resort(v.begin(), v.end(), changed.begin(), changed.end()) );
+    check_sorted(v, s, false);
+
+    /* still a permutation of the same elements. */
+    std::vector<int> after(v.size());
+    for (unsigned int i = 0; i < v.size(); ++i)
+      after[i] = v[i].index;
+    std::sort(before.begin(), before.end());
+    std::sort(after.begin(), after.end());
+    BOOST_CHECK( before == after );
+
+    BOOST_CHECK_EQUAL( s.number_keys(), static_cast<int>(v.size()) );
+    for (unsigned int i = 0; i < v.size(); ++i)
+      BOOST_CHECK_EQUAL( s.key(i), v[i].value );
+  }
+
+  /* too many changes:  full sort. */
+  for (unsigned int i = 0; i < v.size(); ++i)
+    v[i].value = std::rand() % n_values;
+  BOOST_CHECK( !s.resort(v.begin(), v.end(), item_value(), Null(), 0.1) );
+  check_sorted(v, s, false);
+
+  /* nothing changed. */
+  BOOST_CHECK( s.resort(v.begin(), v.end()) );
+  check_sorted(v, s, false);
+}
+
+BOOST_AUTO_TEST_CASE( resort_after_copy ) {
+  using olson_tools::nsort::tweak::Null;
+  const int n_values = 37;
+  olson_tools::nsort::NSort<item_value> s(n_values, true);
+
+  /* the bins of sort_copy describe the output, so a resort of the input
+   * must fall back to a full sort (even if the caller claims that only a
+   * few elements changed since). */
+  std::vector<Item> v = random_items(10007, n_values);
+  std::vector<Item> out(v.size());
+  s.sort_copy(&v[0], &v[0] + v.size(), &out[0], NULL, item_value(), Null(), 2);
+  check_sorted(out, s, true);
+
+  std::vector<int> changed;
+  changed.push_back(3);
+  changed.push_back(1000);
+  BOOST_CHECK( !s.resort(v.begin(), v.end(), changed.begin(), changed.end()) );
+  check_sorted(v, s, false);
+  for (unsigned int i = 0; i < v.size(); ++i)
+    BOOST_CHECK_EQUAL( s.key(i), v[i].value );
+
+  /* the same through the iterator path. */
+  v = random_items(10007, n_values);
+  s.sort_copy(v.begin(), v.end(), out.begin());
+  BOOST_CHECK( !s.resort(v.begin(), v.end()) );
+  check_sorted(v, s, false);
+
+  /* after sort_swap, the bins do describe v. */
+  std::vector<Item> buffer;
+  v = random_items(10007, n_values);
+  s.sort_swap(v, buffer);
+  v[17].value = (v[17].value + 1) % n_values;
+  BOOST_CHECK( s.resort(v.begin(), v.end()) );
+  check_sorted(v, s, false);
+}
+
+BOOST_AUTO_TEST_CASE( index ) {
+  using olson_tools::nsort::tweak::Null;
+  using olson_tools::nsort::map::direct;
+  using olson_tools::Vector;
+  const int n_values = 37;
+  olson_tools::nsort::NSort<> s(n_values);
+
+  /* a structure of arrays, sorted by the cell array. */
+  const int n = 100003;
+  std::vector<int> cell(n);
+  std::vector< Vector<double,3> > x(n);
+  std::vector<double> w(n);
+  for (int i = 0; i < n; ++i) {
+    cell[i] = std::rand() % n_values;
+    x[i] = static_cast<double>(i);
+    w[i] = 0.5 * i;
+  }
+
+  const int threads[] = {1, 3};
+  for (unsigned int t = 0; t < 2; ++t) {
+    std::vector<int> perm(n);
+    s.sort_index(cell.begin(), cell.end(), &perm[0], direct(), Null(), threads[t]);
+
+    /* the same permutation as the stable sort_copy. */
+    std::vector<int> sorted(n), perm2(n);
+    s.sort_copy(&cell[0], &cell[0] + n, &sorted[0], &perm2[0], direct(), Null(), threads[t]);
+    BOOST_CHECK( perm == perm2 );
+
+    std::vector<int> cell2(n);
+    std::vector< Vector<double,3> > x2(n);
+    std::vector<double> w2(n);
+    olson_tools::nsort::Gather gather;
+    gather(&cell[0], &cell2[0])(&x[0], &x2[0])(&w[0], &w2[0]);
+    BOOST_CHECK_EQUAL( gather.size(), 3 );
+    gather.apply(&perm[0], n, threads[t]);
+
+    for (int i = 0; i < n_values; ++i)
+      for (int j = s.begin(i); j < s.end(i); ++j) {
+        BOOST_CHECK_EQUAL( cell2[j], i );
+        BOOST_CHECK_EQUAL( x2[j][2], static_cast<double>(perm[j]) );
+        BOOST_CHECK_EQUAL( w2[j], 0.5 * perm[j] );
+        if ( j > s.begin(i) )
+          BOOST_CHECK_LT( perm[j-1], perm[j] );
+      }
+
+    /* in place (through a buffer). */
+    std::vector<double> buffer;
+    std::vector<double> w3(w);
+    olson_tools::nsort::apply_permutation(&perm[0], w3, buffer, threads[t]);
+    BOOST_CHECK( w3 == w2 );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( fixed_values ) {
+  using namespace olson_tools::nsort::map;
+  using olson_tools::nsort::NSort;
+  typedef pivot_ctor< _3D<0,1,2> > map3D;
+
+  BOOST_CHECK_EQUAL( static_cast<int>(NSort<map3D>::fixed_values), 8 );
+  BOOST_CHECK_EQUAL( static_cast<int>(NSort< pivot_ctor< w_species< _3D<0,1,2> > > >::fixed_values), 0 );
+  BOOST_CHECK_EQUAL( static_cast<int>(NSort<item_value>::fixed_values), 0 );
+
+  std::vector<Point> v(1000);
+  for (unsigned int i = 0; i < v.size(); ++i)
+    for (int d = 0; d < 3; ++d)
+      v[i].x[d] = std::rand() / (RAND_MAX + 1.0) - 0.5;
+
+  /* with the fixed bins, repeatedly (reusing the scratch). */
+  NSort<map3D> s(8);
+  for (int r = 0; r < 3; ++r) {
+    std::random_shuffle(v.begin(), v.end());
+    s.sort(v.begin(), v.end());
+    for (int i = 0; i < 8; ++i)
+      for (int j = s.begin(i); j < s.end(i); ++j)
+        BOOST_CHECK_EQUAL( map3D()(v[j]), i );
+  }
+  BOOST_CHECK_EQUAL( s.end(7), static_cast<int>(v.size()) );
+
+  /* copies have their own bins. */
+  NSort<map3D> c(s);
+  for (int i = 0; i < 8; ++i)
+    BOOST_CHECK_EQUAL( c.end(i), s.end(i) );
+  NSort<map3D> big(16);
+  big = s;
+  BOOST_CHECK_EQUAL( big.size(), 8 );
+  BOOST_CHECK_EQUAL( big.end(7), s.end(7) );
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
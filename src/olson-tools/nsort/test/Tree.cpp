@@ -0,0 +1,133 @@
+#define BOOST_TEST_MODULE  Tree
+
+#include <olson-tools/nsort/Tree.h>
+#include <olson-tools/nsort/map/_2D.h>
+#include <olson-tools/nsort/map/_3D.h>
+#include <olson-tools/Vector.h>
+
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+  using olson_tools::Vector;
+  using olson_tools::V3;
+
+  struct Particle {
+    Vector<double,3> x;
+    int id;
+  };
+
+  double frand() { return std::rand() / (RAND_MAX + 1.0); }
+
+  std::vector<Particle> random_particles( const int & n ) {
+    std::vector<Particle> v(n);
+    for (int i = 0; i < n; ++i) {
+      /* clustered toward the origin to make the tree adaptive. */
+      const double r = frand() * frand();
+      v[i].x = V3(r * frand(), r * frand(), r * frand());
+      v[i].id = i;
+    }
+    return v;
+  }
+
+  /** Checks the structure of the tree and that every element of every leaf
+   * is on the correct side of the pivots of the leaf's ancestors. */
+  template < typename TreeT, typename Iter >
+  void check_tree( const TreeT & tree, const Iter & Ai, const int & n,
+                   const int & leaf_size ) {
+    typedef typename TreeT::Node Node;
+    typedef typename TreeT::map_type map_type;
+    BOOST_REQUIRE( tree.size() > 0 );
+    BOOST_CHECK_EQUAL( tree[0].begin, 0 );
+    BOOST_CHECK_EQUAL( tree[0].end, n );
+
+    int n_leaf_elements = 0;
+    for (int i = 0; i < tree.size(); ++i) {
+      const Node & node = tree[i];
+      if ( node.leaf() ) {
+        n_leaf_elements += node.size();
+        continue;
+      }
+
+      BOOST_CHECK_GT( node.size(), leaf_size );
+      BOOST_CHECK_GT( node.child, i );
+      map_type map(node.pivot);
+      int b = node.begin;
+      for (int j = 0; j < TreeT::n_children; ++j) {
+        const Node & c = tree[node.child + j];
+        BOOST_CHECK_EQUAL( c.begin, b );
+        b = c.end;
+        for (int k = c.begin; k < c.end; ++k)
+          BOOST_CHECK_EQUAL( map(olson_tools::ref_of(*(Ai + k))), j );
+      }
+      BOOST_CHECK_EQUAL( b, node.end );
+    }
+    BOOST_CHECK_EQUAL( n_leaf_elements, n );
+
+    /* every element can be found in its own leaf. */
+    for (int k = 0; k < n; k += 97) {
+      const Node & leaf = tree[ tree.find_leaf(olson_tools::ref_of(*(Ai + k)).x) ];
+      BOOST_CHECK( leaf.begin <= k && k < leaf.end );
+    }
+  }
+}
+
+
+BOOST_AUTO_TEST_SUITE( Tree );
+
+BOOST_AUTO_TEST_CASE( octree ) {
+  typedef olson_tools::nsort::Tree< olson_tools::nsort::map::_3D<0,1,2> > Octree;
+  const Octree::PivotRule rules[] = { Octree::CENTER, Octree::MEAN, Octree::MEDIAN };
+  const int threads[] = {1, 3};
+
+  for (int r = 0; r < 3; ++r) {
+    Octree tree(8, rules[r]);
+    for (int t = 0; t < 2; ++t) {
+      std::vector<Particle> v = random_particles(20000);
+      tree.build(v.begin(), v.end(), threads[t]);
+      check_tree(tree, v.begin(), v.size(), 8);
+
+      /* still a permutation of the list. */
+      std::vector<int> seen(v.size(), 0);
+      for (unsigned int i = 0; i < v.size(); ++i)
+        ++seen[v[i].id];
+      BOOST_CHECK( std::count(seen.begin(), seen.end(), 1) == int(v.size()) );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( quadtree_pointers ) {
+  typedef olson_tools::nsort::Tree< olson_tools::nsort::map::_2D<0,1> > Quadtree;
+  std::vector<Particle> v = random_particles(5000);
+  std::vector<Particle*> pv;
+  for (unsigned int i = 0; i < v.size(); ++i)
+    pv.push_back( &v[i] );
+
+  Quadtree tree(4);
+  tree.build(pv.begin(), pv.end(), 2);
+  check_tree(tree, pv.begin(), pv.size(), 4);
+}
+
+BOOST_AUTO_TEST_CASE( degenerate ) {
+  typedef olson_tools::nsort::Tree< olson_tools::nsort::map::_3D<0,1,2> > Octree;
+  /* identical positions cannot be separated:  a single leaf. */
+  std::vector<Particle> v(100);
+  for (unsigned int i = 0; i < v.size(); ++i) {
+    v[i].x = V3(1.,1.,1.);
+    v[i].id = i;
+  }
+
+  Octree tree(4);
+  tree.build(v.begin(), v.end());
+  BOOST_CHECK_EQUAL( tree.size(), 1 );
+  BOOST_CHECK( tree[0].leaf() );
+
+  /* empty list. */
+  v.clear();
+  tree.build(v.begin(), v.end());
+  BOOST_CHECK_EQUAL( tree.size(), 1 );
+  BOOST_CHECK_EQUAL( tree[0].size(), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -7,9 +7,9 @@ namespace olson_tools {
       /** Default NSort tweaker does nothing. */
       struct Null {
         template < typename Map >
-        inline void tweakNSort( Map & map,
-                                const int * const bin,
-                                const int & n_values ) const {}
+        inline void tweakNSort( Map & /*map*/,
+                                const int * const /*bin*/,
+                                const int & /*n_values*/ ) const {}
       };
     }/* namespace tweak */
   }/* namespace nsort */
@@ -0,0 +1,329 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * Recursive range splitting (parallel_for and parallel_reduce) on top of the
+ * thread cache.
+ *
+ * */
+
+#ifndef olson_tools_parallel_for_h
+#define olson_tools_parallel_for_h
+
+#if defined(USE_PTHREAD)
+#  include <olson-tools/PThreadCache.h>
+#elif defined(_OPENMP)
+#  include <omp.h>
+#endif
+
+namespace olson_tools {
+
+  namespace detail {
+
+    /** The grain to use for a range of n if the caller asked for grain (0
+     * means:  about four pieces per thread). */
+    template < typename I >
+    inline I auto_grain( const I & n, const I & grain, const int & nthreads ) {
+      if ( grain > 0 )
+        return grain;
+      const I g = n / static_cast<I>( 4 * (nthreads > 1 ? nthreads : 1) );
+      return g > 0 ? g : 1;
+    }
+
+    /** Serial reduction over the same tree as the threaded versions such that
+     * the result does not depend on which backend is used. */
+    template < typename I, typename T, typename Body, typename Join >
+    inline T reduce_serial( const I & b, const I & e, const I & grain,
+                            const T & identity,
+                            const Body & body, const Join & join ) {
+      if ( e - b <= grain )
+        return body(b, e, identity);
+      const I m = b + (e - b) / 2;
+      T left = reduce_serial(b, m, grain, identity, body, join);
+      return join( left, reduce_serial(m, e, grain, identity, body, join) );
+    }
+
+#if defined(USE_PTHREAD)
+    template < typename I, typename Body >
+    inline void for_split( PThreadCache & cache,
+                           const I & b, const I & e, const I & grain,
+                           const Body & body );
+
+    /** The right half of a split range (lives on the stack of the thread
+     * that split the range). */
+    template < typename I, typename Body >
+    struct for_task : PThreadTask {
+      PThreadCache & cache;
+      I b, e, grain;
+      const Body & body;
+
+      for_task( PThreadCache & cache, const I & b, const I & e,
+                const I & grain, const Body & body )
+        : cache(cache), b(b), e(e), grain(grain), body(body) { }
+
+      virtual void exec() {
+        for_split(cache, b, e, grain, body);
+      }
+    };
+
+    /** Offer the right half of [b,e) to the cache, do the left half and then
+     * wait for (or help with) the right half. */
+    template < typename I, typename Body >
+    inline void for_split( PThreadCache & cache,
+                           const I & b, const I & e, const I & grain,
+                           const Body & body ) {
+      if ( e - b <= grain ) {
+        body(b, e);
+        return;
+      }
+
+      const I m = b + (e - b) / 2;
+      PThreadCompletion completion;
+      for_task<I,Body> right(cache, m, e, grain, body);
+      cache.addTask(&right, completion);
+      try {
+        for_split(cache, b, m, grain, body);
+      } catch (...) {
+        /* right refers to this stack frame. */
+        cache.waitForAll(completion);
+        throw;
+      }
+      cache.waitForAll(completion);
+    }
+
+    template < typename I, typename T, typename Body, typename Join >
+    inline T reduce_split( PThreadCache & cache,
+                           const I & b, const I & e, const I & grain,
+                           const T & identity,
+                           const Body & body, const Join & join );
+
+    /** The right half of a split reduction. */
+    template < typename I, typename T, typename Body, typename Join >
+    struct reduce_task : PThreadTask {
+      PThreadCache & cache;
+      I b, e, grain;
+      const T & identity;
+      const Body & body;
+      const Join & join;
+      T result;
+
+      reduce_task( PThreadCache & cache, const I & b, const I & e,
+                   const I & grain, const T & identity,
+                   const Body & body, const Join & join )
+        : cache(cache), b(b), e(e), grain(grain), identity(identity),
+          body(body), join(join), result(identity) { }
+
+      virtual void exec() {
+        result = reduce_split(cache, b, e, grain, identity, body, join);
+      }
+    };
+
+    template < typename I, typename T, typename Body, typename Join >
+    inline T reduce_split( PThreadCache & cache,
+                           const I & b, const I & e, const I & grain,
+                           const T & identity,
+                           const Body & body, const Join & join ) {
+      if ( e - b <= grain )
+        return body(b, e, identity);
+
+      const I m = b + (e - b) / 2;
+      PThreadCompletion completion;
+      reduce_task<I,T,Body,Join>
+        right(cache, m, e, grain, identity, body, join);
+      cache.addTask(&right, completion);
+      try {
+        T left = reduce_split(cache, b, m, grain, identity, body, join);
+        cache.waitForAll(completion);
+        return join(left, right.result);
+      } catch (...) {
+        cache.waitForAll(completion);
+        throw;
+      }
+    }
+
+#elif defined(_OPENMP)
+    /* (the bounds are passed by value so that they can be firstprivate.) */
+    template < typename I, typename Body >
+    inline void for_split( const I b, const I e, const I grain,
+                           const Body & body ) {
+      I end = e;
+      const Body * bp = &body;
+      /* spawn the right halves and keep the left-most piece. */
+      while ( end - b > grain ) {
+        const I m = b + (end - b) / 2;
+        #pragma omp task firstprivate(m, end, grain, bp)
+        for_split(m, end, grain, *bp);
+        end = m;
+      }
+      body(b, end);
+      #pragma omp taskwait
+    }
+
+    template < typename I, typename T, typename Body, typename Join >
+    inline T reduce_split( const I b, const I e, const I grain,
+                           const T & identity,
+                           const Body & body, const Join & join ) {
+      if ( e - b <= grain )
+        return body(b, e, identity);
+
+      const I m = b + (e - b) / 2;
+      T right(identity);
+      T * rp = &right;
+      const T * ip = &identity;
+      const Body * bp = &body;
+      const Join * jp = &join;
+      #pragma omp task firstprivate(m, e, grain, rp, ip, bp, jp)
+      *rp = reduce_split(m, e, grain, *ip, *bp, *jp);
+      T left = reduce_split(b, m, grain, identity, body, join);
+      #pragma omp taskwait
+      return join(left, right);
+    }
+#endif
+
+  }/* namespace detail */
+
+  /** Call body(b_i, e_i) for sub-ranges [b_i, e_i) that cover [b, e), in
+   * parallel where possible.  The range is split in halves recursively until
+   * the pieces are no larger than grain.  The right halves are offered to the
+   * other threads while the splitting thread continues with the left half;
+   * they are only taken by threads that are otherwise idle (work stealing),
+   * so that the range is divided only as finely as the load requires.  The
+   * left-most piece is always done by the calling thread.
+   *
+   * Nothing is allocated per piece:  the pending halves live on the stacks
+   * of the splitting threads.  Bodies may themselves call parallel_for (a
+   * thread that waits for its halves executes other pieces meanwhile).
+   *
+   * With USE_PTHREAD the threads of the given PThreadCache are used [default
+   * olson_tools::pthreadCache], with OpenMP the pieces are OpenMP tasks (in a
+   * new parallel region if not already in one), and otherwise body(b, e) is
+   * called once.
+   *
+   * @param grain
+   *    The largest piece to not split further [0:  about four pieces per
+   *    thread].
+   * @param body
+   *    A functor with a const operator()(const I & b, const I & e); it is
+   *    shared (not copied) by all of the threads.
+   */
+#if defined(USE_PTHREAD)
+  template < typename I, typename Body >
+  inline void parallel_for( const I & b, const I & e, const I & grain,
+                            const Body & body,
+                            PThreadCache & cache = pthreadCache ) {
+    if ( e <= b )
+      return;
+    detail::for_split( cache, b, e,
+                       detail::auto_grain(e - b, grain,
+                                          cache.get_max_threads()),
+                       body );
+  }
+#elif defined(_OPENMP)
+  template < typename I, typename Body >
+  inline void parallel_for( const I & b, const I & e, const I & grain,
+                            const Body & body ) {
+    if ( e <= b )
+      return;
+    const I g = detail::auto_grain(e - b, grain, omp_get_max_threads());
+    if ( omp_in_parallel() )
+      detail::for_split(b, e, g, body);
+    else {
+      #pragma omp parallel
+      {
+        #pragma omp single
+        detail::for_split(b, e, g, body);
+      }
+    }
+  }
+#else
+  template < typename I, typename Body >
+  inline void parallel_for( const I & b, const I & e, const I & /*grain*/,
+                            const Body & body ) {
+    if ( e <= b )
+      return;
+    body(b, e);
+  }
+#endif
+
+  /** Reduce over [b, e):  the pieces of the range (split as in
+   * parallel_for) are each reduced with body(b_i, e_i, identity) and the
+   * results of the two halves of each split are combined by
+   * join(left, right).
+   *
+   * The splits depend only on [b, e) and grain, so that the result does not
+   * depend on the timing of the threads (nor on the backend).  An explicit
+   * grain also makes it independent of the number of threads.
+   *
+   * @param body
+   *    A functor with a const T operator()(const I & b, const I & e,
+   *    const T & init).
+   * @param join
+   *    A functor with a const T operator()(const T & left, const T & right).
+   */
+#if defined(USE_PTHREAD)
+  template < typename I, typename T, typename Body, typename Join >
+  inline T parallel_reduce( const I & b, const I & e, const I & grain,
+                            const T & identity,
+                            const Body & body, const Join & join,
+                            PThreadCache & cache = pthreadCache ) {
+    if ( e <= b )
+      return identity;
+    return detail::reduce_split( cache, b, e,
+                                 detail::auto_grain(e - b, grain,
+                                                    cache.get_max_threads()),
+                                 identity, body, join );
+  }
+#else
+  template < typename I, typename T, typename Body, typename Join >
+  inline T parallel_reduce( const I & b, const I & e, const I & grain,
+                            const T & identity,
+                            const Body & body, const Join & join ) {
+    if ( e <= b )
+      return identity;
+#  if defined(_OPENMP)
+    const I g = detail::auto_grain(e - b, grain, omp_get_max_threads());
+    if ( omp_in_parallel() )
+      return detail::reduce_split(b, e, g, identity, body, join);
+
+    T result(identity);
+    #pragma omp parallel
+    {
+      #pragma omp single
+      result = detail::reduce_split(b, e, g, identity, body, join);
+    }
+    return result;
+#  else
+    return detail::reduce_serial( b, e, detail::auto_grain(e - b, grain, 1),
+                                  identity, body, join );
+#  endif
+  }
+#endif
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_parallel_for_h
@@ -29,9 +29,13 @@
  *
  */
 
-#include "MersenneTwister.h"
+#include <olson-tools/random/random.h>
 #include <math.h>
 
+#if defined(USE_PTHREAD)
+#  include <pthread.h>
+#endif
+
 
 #define MTRNGrand mtrngrand_
 #define MTRNGrandV mtrngrandv_
@@ -44,13 +48,94 @@
 #define MTRNGseedV1 mtrngrandv1_
 #define MTRNGseedV2 mtrngrandv2_
 #define MTRNGseed mtrngseed_
+#define MTRNGgetSeed mtrnggetseed_
+#define MTRNGstream mtrngstream_
 #define MTRNGsave mtrngsave_
 #define MTRNGload mtrngload_
 
-MTRand __my_rand = MTRand();
-
 typedef unsigned long uint32;
 
+namespace olson_tools {
+  namespace random {
+    namespace detail {
+      OLSON_TOOLS_TLS ThreadRand * thread_rng = NULL;
+
+      /* zero until the master seed is first set. */
+      unsigned long seed_epoch = 0;
+
+      namespace {
+        /* The following are protected by seed_lock. */
+        int seed_lock = 0;
+        uint32 master_seed = 0;
+        uint32 next_stream = 0;
+
+        struct SeedKey {
+          SeedKey() {
+            while ( __atomic_exchange_n( &seed_lock, 1, __ATOMIC_ACQUIRE ) )
+              ;
+          }
+          ~SeedKey() { __atomic_store_n( &seed_lock, 0, __ATOMIC_RELEASE ); }
+        };
+
+        /** Set the master seed such that every generator reseeds. */
+        void set_master_seed( const uint32 & s ) {
+          master_seed = s;
+          __atomic_store_n( &seed_epoch, seed_epoch + 1, __ATOMIC_RELEASE );
+        }
+
+        /** Seed t with its stream of the master seed. */
+        void reseed( ThreadRand & t ) {
+          if ( seed_epoch == 0 )
+            set_master_seed( MTRand().randInt() );
+
+          if ( t.stream == 0 )
+            t.rng.seed( master_seed );
+          else {
+            uint32 key[2] = { master_seed, t.stream };
+            t.rng.seed( key, 2 );
+          }
+          t.epoch = seed_epoch;
+        }
+
+    #if defined(USE_PTHREAD)
+        /* deletes the generator of a thread as it exits. */
+        pthread_key_t exit_key;
+        bool exit_key_created = false;
+
+        void delete_thread_rand( void * t ) {
+          delete static_cast<ThreadRand*>(t);
+          thread_rng = NULL;
+        }
+    #endif
+
+        /** The generator of the calling thread, created if necessary. */
+        ThreadRand & get_thread_rand() {
+          if ( !thread_rng ) {
+            thread_rng = new ThreadRand( next_stream++ );
+          #if defined(USE_PTHREAD)
+            if ( !exit_key_created )
+              exit_key_created =
+                pthread_key_create( &exit_key, &delete_thread_rand ) == 0;
+            if ( exit_key_created )
+              pthread_setspecific( exit_key, thread_rng );
+          #endif
+          }
+          return *thread_rng;
+        }
+      }
+
+      MTRand & refresh_thread_rand() {
+        SeedKey key;
+        ThreadRand & t = get_thread_rand();
+        reseed( t );
+        return t.rng;
+      }
+    }/* namespace olson_tools::random::detail */
+  }/* namespace olson_tools::random */
+}/* namespace olson_tools */
+
+using olson_tools::random::thread_rand;
+
 void function_to_shut_compiler_up();
 
 extern "C" {
@@ -69,6 +154,8 @@ extern "C" {
     /* static */ void   MTRNGseedV1( uint32 * oneSeed );
     /* static */ void   MTRNGseedV2( uint32 *const bigSeed );
     /* static */ void   MTRNGseed();
+    /* static */ void   MTRNGgetSeed( uint32 * oneSeed );
+    /* static */ void   MTRNGstream( uint32 * stream );
 	
     // Saving and loading generator state
     /* static */ void   MTRNGsave( uint32* saveArray );  // to array of size SAVE
@@ -76,57 +163,77 @@ extern "C" {
 }// extern
 
 /* static */ double MTRNGrand() {				/* real number in [0,1] */
-    return __my_rand();
+    return thread_rand()();
 }
 
 /* static */ double MTRNGrandV( const double n[] ) {	/* real number in [0,n] */
-    return __my_rand.rand(*n);
+    return thread_rand().rand(*n);
 }
 
 /* static */ double MTRNGrandExc() {			/* real number in [0,1) */
-    return __my_rand.randExc();
+    return thread_rand().randExc();
 }
 
 /* static */ double MTRNGrandExcV( const double n[] ){	/* real number in [0,n) */
-    return __my_rand.randExc(*n);
+    return thread_rand().randExc(*n);
 }
 
 /* static */ double MTRNGrandDblExc() {			/* real number in (0,1) */
-    return __my_rand.randDblExc();
+    return thread_rand().randDblExc();
 }
 
 /* static */ double MTRNGrandDblExcV( const double n[] ) {	/* real number in (0,n) */
-    return __my_rand.randDblExc(*n);
+    return thread_rand().randDblExc(*n);
 }
 
 /* static */ uint32 MTRNGrandInt() {			/* integer in [0,2^32-1] */
-    return __my_rand.randInt();
+    return thread_rand().randInt();
 }
 
 /* static */ uint32 MTRNGrandIntV( const uint32 n[] ) {	/* integer in [0,n] for n < 2^32 */
-    return __my_rand.randInt(*n);
+    return thread_rand().randInt(*n);
 }
 	
 // Re-seeding functions with same behavior as initializers
 /* static */ void MTRNGseedV1( uint32 * oneSeed ) {
-    __my_rand.seed(*oneSeed);
+    using namespace olson_tools::random::detail;
+    SeedKey key;
+    set_master_seed( *oneSeed );
 }
 
 /* static */ void MTRNGseedV2( uint32 *const bigSeed ) {
-    __my_rand.seed(bigSeed);
+    thread_rand().seed(bigSeed);
 }
 
 /* static */ void MTRNGseed() {
-    __my_rand.seed();
+    using namespace olson_tools::random::detail;
+    uint32 s = MTRand().randInt();
+    SeedKey key;
+    set_master_seed( s );
+}
+
+/* static */ void MTRNGgetSeed( uint32 * oneSeed ) {
+    using namespace olson_tools::random::detail;
+    thread_rand(); /* makes sure that there is a master seed. */
+    SeedKey key;
+    *oneSeed = master_seed;
+}
+
+/* static */ void MTRNGstream( uint32 * stream ) {
+    using namespace olson_tools::random::detail;
+    SeedKey key;
+    ThreadRand & t = get_thread_rand();
+    t.stream = *stream;
+    reseed( t );
 }
 	
 // Saving and loading generator state
 /* static */ void MTRNGsave( uint32* saveArray ) {  // to array of size SAVE
-    __my_rand.save(saveArray);
+    thread_rand().save(saveArray);
 }
 
 /* static */ void MTRNGload( uint32 *const loadArray ) {
-    __my_rand.load(loadArray);
+    thread_rand().load(loadArray);
 }
 
 
@@ -145,8 +252,9 @@ double gauss_deviate__(const double sigma[]) {
  *@memo Random Gaussian Deviate
 */
 /* static */ double gauss_deviate( const double & sigma) {
-  static int iset = 0;
-  static double gset, csigma = 0;
+  /* the spare deviate is kept per thread, as is the generator. */
+  static OLSON_TOOLS_TLS int iset = 0;
+  static OLSON_TOOLS_TLS double gset, csigma = 0;
 
   if ( iset == 1 && sigma == csigma ) { // We have an extra deviate handy, so
     iset = 0; // Unset flag.
@@ -161,7 +269,7 @@ double gauss_deviate__(const double sigma[]) {
        * in each direction.  See if they are in the unit circle, and
        * if they are not, try again.
       */
-#define LGR_RANGE_RAND	(2.0*__my_rand() - 1.0)
+#define LGR_RANGE_RAND	(2.0*thread_rand()() - 1.0)
       v1 = LGR_RANGE_RAND;
       v2 = LGR_RANGE_RAND;
 #undef LGR_RANGE_RAND
@@ -198,6 +306,8 @@ void function_to_shut_compiler_up() {
     MTRNGseedV1( &ui );
     MTRNGseedV2( &ui );
     MTRNGseed();
+    MTRNGgetSeed( &ui );
+    MTRNGstream( &ui );
 	
     // Saving and loading generator state
     MTRNGsave( uiA );  // to array of size SAVE
@@ -35,8 +35,19 @@
 /** \file
  * Several random number utilities.
  * By default, each of these will use a pre-initialized MTRand (MersenneTwister) class
- * to allocate random numbers.  This private MTRand instance will be
- * initialized via MTRand::seed().
+ * to allocate random numbers.
+ *
+ * Each thread has its own MTRand instance (see olson_tools::random::thread_rand),
+ * such that these may be called from several threads at once.  The
+ * generator of each thread produces one stream of a master seed:  stream 0
+ * is seeded with the master seed itself (exactly as a single MTRand would
+ * be), and stream k > 0 is seeded with the key {master seed, k} via the
+ * array initialization of MTRand.  Streams are handed out in the order in
+ * which the threads first draw a number.  To replay a parallel run, set the
+ * master seed (MTRNGseedV1; MTRNGgetSeed tells the seed that was used) and
+ * have each thread pick its stream explicitly (MTRNGstream), for instance
+ * with its thread number.  If not set, the master seed is taken from
+ * /dev/urandom (or a hash of time() and clock()).
  *
  * NOTE:
  * The screwy necessity of having pointers to arguments for gauss_deviate and
@@ -59,16 +70,55 @@
     * RNG class. 
     * */
 #  include <olson-tools/random/MersenneTwister.h>
+#  include <olson-tools/tls.h>
 #endif 
 
 typedef unsigned long uint32;
 
 #ifdef __cplusplus
 
-/** pre-allocated MersenneTwister class for use in generating random numbers
- * using the following routines.
+namespace olson_tools {
+  namespace random {
+    namespace detail {
+      /** The generator of one thread. */
+      struct ThreadRand {
+        MTRand rng;
+        /** The stream of the master seed that rng produces. */
+        uint32 stream;
+        /** The value of seed_epoch when rng was last seeded. */
+        unsigned long epoch;
+
+        explicit ThreadRand( const uint32 & stream )
+          : rng(0UL), stream(stream), epoch(0) { }
+      };
+
+      /** The generator of the calling thread (NULL until first used). */
+      extern OLSON_TOOLS_TLS ThreadRand * thread_rng;
+
+      /** Changes every time that the master seed is set. */
+      extern unsigned long seed_epoch;
+
+      /** Create or reseed the generator of the calling thread. */
+      MTRand & refresh_thread_rand();
+    }/* namespace olson_tools::random::detail */
+
+    /** The MersenneTwister generator of the calling thread.  It is (re)seeded
+     * from the master seed whenever that changes.
+     */
+    inline MTRand & thread_rand() {
+      detail::ThreadRand * t = detail::thread_rng;
+      if ( t && t->epoch == __atomic_load_n( &detail::seed_epoch,
+                                             __ATOMIC_ACQUIRE ) )
+        return t->rng;
+      return detail::refresh_thread_rand();
+    }
+  }/* namespace olson_tools::random */
+}/* namespace olson_tools */
+
+/** The generator used by the following routines (kept for older code, this
+ * is now the generator of the calling thread).
  */
-extern MTRand __my_rand;
+#  define __my_rand (olson_tools::random::thread_rand())
 
 #  define EXTERNC extern "C"
 #  define INLINECPP(fun,code) inline fun { code }
@@ -160,7 +210,9 @@ namespace olson_tools {
 #  ifndef DOXYGEN_SKIP
 #   define MTRNGseedV1 mtrngrandv1_
 #  endif // DOXYGEN_SKIP
-    /** Seed the generator with a simple uint32_t.
+    /** Set the master seed with a simple uint32_t.  Stream 0 is seeded
+     * exactly as MTRand::seed( oneSeed ); every thread reseeds its generator
+     * before it next draws a number.
      * @see MTRand::seed( uint32 oneSeed ).
      */
     EXTERNC void   MTRNGseedV1( uint32 * oneSeed );
@@ -168,7 +220,8 @@ namespace olson_tools {
 #  ifndef DOXYGEN_SKIP
 #   define MTRNGseedV2 mtrngrandv2_
 #  endif // DOXYGEN_SKIP
-    /** Seed the generator with an array of 624 uint32's.
+    /** Seed the generator of the calling thread with an array of 624
+     * uint32's (the other threads are not affected).
      * There are 2^19937-1 possible initial states.  This function allows
      * any one of those to be chosen by providing 19937 bits.  The lower
      * 31 bits of the first element, bigSeed[0], are discarded.  Any bits
@@ -183,17 +236,32 @@ namespace olson_tools {
 #  ifndef DOXYGEN_SKIP
 #   define MTRNGseed mtrngseed_
 #  endif // DOXYGEN_SKIP
-    /** Seed the generator with an array from /dev/urandom if available.
+    /** Set the master seed from /dev/urandom if available.
      * Otherwise use a hash of time() and clock() values.
-     * @see MTRand::seed().
+     * @see MTRand::seed(), MTRNGseedV1, MTRNGgetSeed.
      */
     EXTERNC void   MTRNGseed();
+
+#  ifndef DOXYGEN_SKIP
+#   define MTRNGgetSeed mtrnggetseed_
+#  endif // DOXYGEN_SKIP
+    /** Get the master seed (for replaying a run with MTRNGseedV1). */
+    EXTERNC void   MTRNGgetSeed( uint32 * oneSeed );
+
+#  ifndef DOXYGEN_SKIP
+#   define MTRNGstream mtrngstream_
+#  endif // DOXYGEN_SKIP
+    /** Have the calling thread use the given stream of the master seed (and
+     * reseed its generator accordingly).  Each thread should use a different
+     * stream.
+     */
+    EXTERNC void   MTRNGstream( uint32 * stream );
 	
     // Saving and loading generator state
 #  ifndef DOXYGEN_SKIP
 #   define MTRNGsave mtrngsave_
 #  endif // DOXYGEN_SKIP
-    /** Save generator to array of a size MTRand::SAVE.
+    /** Save generator of the calling thread to array of a size MTRand::SAVE.
      * @param saveArray An array of size MTRand::SAVE to which the generator should be
      *    saved.
      * @see MTRand::save( uint32* saveArray ).
@@ -203,7 +271,7 @@ namespace olson_tools {
 #  ifndef DOXYGEN_SKIP
 #   define MTRNGload mtrngload_
 #  endif // DOXYGEN_SKIP
-    /** Load generator from array of a size MTRand::SAVE.
+    /** Load generator of the calling thread from array of a size MTRand::SAVE.
      * @param loadArray An array of size MTRand::SAVE from which the generator should be
      *    loaded.
      * @see MTRand::save( uint32* saveArray ).
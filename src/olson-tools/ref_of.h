@@ -72,6 +72,13 @@ namespace olson_tools {
     return Value<T>::ref(*t);
   }
 
+  /** Version for temporaries, such as the proxy references returned by
+   * VectorArray iterators. */
+  template < typename T >
+  inline const T & ref_of(const T & t) {
+    return t;
+  }
+
 }/* namespace olson_tools */
 
 #endif // olson_tools_ref_of_h
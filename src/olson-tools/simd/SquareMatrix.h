@@ -0,0 +1,62 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * SSE2/AVX specialization of SquareMatrix<double,3> X Vector<double,3>.
+ *
+ * This file is not meant to be included directly.  It is pulled in by
+ * olson-tools/SquareMatrix.h when USE_SIMD_VECTOR is defined.
+ *
+ * Copyright 2004-2008 Spencer Olson
+ */
+
+#ifndef olson_tools_simd_SquareMatrix_h
+#define olson_tools_simd_SquareMatrix_h
+
+#include <olson-tools/simd/Vector.h>
+
+namespace olson_tools {
+
+  /** Matrix X Vector multiplication (SIMD specialization for 3x3 doubles).
+   * Each row of the matrix is multiplied by the vector and the three
+   * horizontal sums are formed together. */
+  template <>
+  inline Vector<double,3u>
+  SquareMatrix<double,3u>::operator* (const Vector<double,3u> & that) const {
+    const simd::pd4 v = simd::load3(that.val);
+    Vector<double,3u> result;
+    simd::store3( result.val,
+                  simd::hsum3x3( simd::mul(simd::load3(val[0]), v),
+                                 simd::mul(simd::load3(val[1]), v),
+                                 simd::mul(simd::load3(val[2]), v) ) );
+    return result;
+  }
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_simd_SquareMatrix_h
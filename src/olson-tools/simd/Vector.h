@@ -0,0 +1,554 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * SSE2/AVX specializations of Vector<double,3> and Vector<double,4>.
+ *
+ * This file is not meant to be included directly.  It is pulled in by
+ * olson-tools/Vector.h when USE_SIMD_VECTOR is defined (and the compiler
+ * targets at least SSE2).  Both specializations store four doubles, so that
+ * each Vector maps onto one AVX register (or two SSE2 registers).  The
+ * storage is deliberately not over-aligned:  heap storage (new[], malloc,
+ * std::allocator) only guarantees 16 byte alignment in C++98, so all of the
+ * kernels use unaligned loads and stores instead.
+ *
+ * Note that defining USE_SIMD_VECTOR changes sizeof(Vector<double,3>) from 24
+ * to 32 bytes.  It must therefore be defined consistently for all code that
+ * shares Vector<double,3> objects.  VNCAST/V3C casts of plain double[3]
+ * arrays remain valid since Vector<double,3> never reads or writes the
+ * padding element.
+ *
+ * Copyright 2004-2008 Spencer Olson
+ */
+
+#ifndef olson_tools_simd_Vector_h
+#define olson_tools_simd_Vector_h
+
+#include <olson-tools/simd/pd.h>
+#include <string.h>
+
+namespace olson_tools {
+
+  namespace simd {
+    /** Load/store policy for a Vector<double,L> (L = 3 or 4). */
+    template < unsigned int L > struct lanes;
+
+    template <> struct lanes<3u> {
+      static inline pd4 load(const double * p) { return load3(p); }
+      static inline void store(double * p, const pd4 & a) { store3(p, a); }
+    };
+
+    template <> struct lanes<4u> {
+      static inline pd4 load(const double * p) { return load4(p); }
+      static inline void store(double * p, const pd4 & a) { store4(p, a); }
+    };
+  }/* namespace simd */
+
+  /** SIMD specialization of the 3-Vector of doubles.  The storage is padded to
+   * four doubles.  The padding element is never touched.
+   * @see Vector.
+   */
+  template <>
+  class Vector<double,3u> {
+    /* TYPEDEFS */
+  public:
+    /** The length of the val array. */
+    static const unsigned int length = 3u;
+
+  private:
+    typedef simd::lanes<3u> lanes;
+
+  public:
+    /** The internal storage array of the vector elements (plus padding). */
+    double val[4];
+
+    /** Default constructor does not do anything. */
+    inline Vector () {}
+
+    /** Copy constructor (which does not read the padding of that, since that
+     * may be cast onto a plain double[3]). */
+    inline Vector (const Vector & that) {
+      memcpy( val, that.val, 3u * sizeof(double) );
+    }
+
+    /** Copy constructor--from a Vector of different type. */
+    template < typename T2 >
+    inline Vector (const Vector<T2,3u> & that) {
+      val[0] = that.val[0]; val[1] = that.val[1]; val[2] = that.val[2];
+    }
+
+    /** Copy constructor--from an array. */
+    inline Vector (const double that[3]) {
+      lanes::store(val, lanes::load(that));
+    }
+
+    /** Assignment constructor.
+     * Assigns all elements of the vector to the given value that.
+     */
+    inline Vector (const double that) { *this = that; }
+
+    /** Zero the Vector. */
+    inline const Vector & zero () {
+      lanes::store(val, simd::set1(0.0));
+      return *this;
+    }
+
+    /** Index operator--non-const version. */
+    inline double & operator[] (const int & i) { return val[i]; }
+
+    /** Index operator--const version. */
+    inline const double & operator[] (const int & i) const { return val[i]; }
+
+    /** Assignment operator. */
+    inline const Vector & operator= (const Vector & that) {
+      lanes::store(val, lanes::load(that.val));
+      return *this;
+    }
+
+    /** Assignment operator--from Vector of different type. */
+    template < typename TR >
+    inline const Vector & operator= (const Vector<TR,3u>& that) {
+      val[0] = that.val[0]; val[1] = that.val[1]; val[2] = that.val[2];
+      return *this;
+    }
+
+    /** Assignment operator--from array of same type. */
+    inline const Vector & operator= (const double that[3]) {
+      lanes::store(val, lanes::load(that));
+      return *this;
+    }
+
+    /** Assignment operator--from scalar value.  All elements will be assigned
+     * to this scalar.  */
+    inline const Vector & operator= (const double & that) {
+      lanes::store(val, simd::set1(that));
+      return *this;
+    }
+
+
+    /* ***** MATH TYPE OPERATIONS THAT ARE MEMBERS. */
+    /** Apply std::abs(double) to all elements and save. */
+    inline const Vector & save_fabs() {
+      lanes::store(val, simd::fabs(lanes::load(val)));
+      return *this;
+    }
+
+    /** Apply sqrt(double) to all elements and save. */
+    inline const Vector & save_sqrt() {
+      lanes::store(val, simd::sqrt(lanes::load(val)));
+      return *this;
+    }
+
+    /** Vector X Scalar immediate multiplication. */  
+    inline const Vector & operator*= (const double & that) {
+      lanes::store(val, simd::mul(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** Vector X Scalar immediate division. */  
+    inline const Vector & operator/= (const double & that) {
+      lanes::store(val, simd::div(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** Vector - Scalar immediate subtraction. */  
+    inline const Vector & operator-= (const double & that) {
+      lanes::store(val, simd::sub(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** Vector - Vector immediate subtraction. */  
+    inline const Vector & operator-= (const Vector & that) {
+      lanes::store(val, simd::sub(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** Vector + Vector immediate addition. */  
+    inline const Vector & operator+= (const Vector & that) {
+      lanes::store(val, simd::add(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** Vector + Scalar immediate addition. */  
+    inline const Vector & operator+= (const double & that) {
+      lanes::store(val, simd::add(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** component by component multiplication.
+     * @return reference to this (type Vector<double,3>).
+     */
+    template <typename T2>
+    inline const Vector & compMult(const Vector<T2,3u> & that) {
+      val[0] *= that.val[0]; val[1] *= that.val[1]; val[2] *= that.val[2];
+      return *this;
+    }
+
+    /** component by component multiplication. */
+    inline const Vector & compMult(const Vector & that) {
+      lanes::store(val, simd::mul(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** component by component division.
+     * @return reference to this (type Vector<double,3>).
+     */
+    template <typename T2>
+    inline const Vector & compDiv(const Vector<T2,3u> & that) {
+      val[0] /= that.val[0]; val[1] /= that.val[1]; val[2] /= that.val[2];
+      return *this;
+    }
+
+    /** component by component division. */
+    inline const Vector & compDiv(const Vector & that) {
+      lanes::store(val, simd::div(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** Compute the magnitude of this vector. */
+    inline double abs () const {
+      simd::pd4 a = lanes::load(val);
+      return std::sqrt(simd::hsum(simd::mul(a,a)));
+    }
+
+    /** The product of all components of the Vector. */
+    inline double prod() const { return val[0] * val[1] * val[2]; }
+
+    /** Return a type casted Vector from the original. */
+    template <typename T2>
+    inline Vector<T2,3u> to_type() const {
+      Vector<T2,3u> retval;
+      retval = *this;
+      return retval;
+    }
+
+    /** Add a fraction of another Vector to this Vector.
+     * @see Vector::addFraction.
+     */
+    template <typename T2>
+    inline Vector addFraction(const double & f, const Vector<T2,3u> & that) {
+      for (unsigned int i = 0; i < 3u; ++i)
+        this->val[i] += f * that.val[i];
+      return *this;
+    }
+
+    /** Add a fraction of another Vector to this Vector. */
+    inline Vector addFraction(const double & f, const Vector & that) {
+      lanes::store(val, simd::add(lanes::load(val),
+                                  simd::mul(simd::set1(f), lanes::load(that.val))));
+      return *this;
+    }
+
+    /** Convert the Vector to a string with an optional delimiter (default: [tab]).
+     * */
+    inline std::string to_string( const char & delim = '\t') const {
+      std::stringstream streamOut;
+      streamOut << val[0] << delim << val[1] << delim << val[2];
+      return streamOut.str( );
+    }
+  };
+
+
+  /** SIMD specialization of the 4-Vector of doubles.
+   * @see Vector.
+   */
+  template <>
+  class Vector<double,4u> {
+    /* TYPEDEFS */
+  public:
+    /** The length of the val array. */
+    static const unsigned int length = 4u;
+
+  private:
+    typedef simd::lanes<4u> lanes;
+
+  public:
+    /** The internal storage array of the vector elements. */
+    double val[4];
+
+    /** Default constructor does not do anything. */
+    inline Vector () {}
+
+    /** Copy constructor--from a Vector of different type. */
+    template < typename T2 >
+    inline Vector (const Vector<T2,4u> & that) {
+      using std::copy;
+      copy( that.val, that.val+4u, val);
+    }
+
+    /** Copy constructor--from an array. */
+    inline Vector (const double that[4]) {
+      lanes::store(val, lanes::load(that));
+    }
+
+    /** Assignment constructor.
+     * Assigns all elements of the vector to the given value that.
+     */
+    inline Vector (const double that) { *this = that; }
+
+    /** Zero the Vector. */
+    inline const Vector & zero () {
+      lanes::store(val, simd::set1(0.0));
+      return *this;
+    }
+
+    /** Index operator--non-const version. */
+    inline double & operator[] (const int & i) { return val[i]; }
+
+    /** Index operator--const version. */
+    inline const double & operator[] (const int & i) const { return val[i]; }
+
+    /** Assignment operator--from Vector of different type. */
+    template < typename TR >
+    inline const Vector & operator= (const Vector<TR,4u>& that) {
+      using std::copy;
+      copy( that.val, that.val+4u, val );
+      return *this;
+    }
+
+    /** Assignment operator--from array of same type. */
+    inline const Vector & operator= (const double that[4]) {
+      lanes::store(val, lanes::load(that));
+      return *this;
+    }
+
+    /** Assignment operator--from scalar value.  All elements will be assigned
+     * to this scalar.  */
+    inline const Vector & operator= (const double & that) {
+      lanes::store(val, simd::set1(that));
+      return *this;
+    }
+
+
+    /* ***** MATH TYPE OPERATIONS THAT ARE MEMBERS. */
+    /** Apply std::abs(double) to all elements and save. */
+    inline const Vector & save_fabs() {
+      lanes::store(val, simd::fabs(lanes::load(val)));
+      return *this;
+    }
+
+    /** Apply sqrt(double) to all elements and save. */
+    inline const Vector & save_sqrt() {
+      lanes::store(val, simd::sqrt(lanes::load(val)));
+      return *this;
+    }
+
+    /** Vector X Scalar immediate multiplication. */  
+    inline const Vector & operator*= (const double & that) {
+      lanes::store(val, simd::mul(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** Vector X Scalar immediate division. */  
+    inline const Vector & operator/= (const double & that) {
+      lanes::store(val, simd::div(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** Vector - Scalar immediate subtraction. */  
+    inline const Vector & operator-= (const double & that) {
+      lanes::store(val, simd::sub(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** Vector - Vector immediate subtraction. */  
+    inline const Vector & operator-= (const Vector & that) {
+      lanes::store(val, simd::sub(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** Vector + Vector immediate addition. */  
+    inline const Vector & operator+= (const Vector & that) {
+      lanes::store(val, simd::add(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** Vector + Scalar immediate addition. */  
+    inline const Vector & operator+= (const double & that) {
+      lanes::store(val, simd::add(lanes::load(val), simd::set1(that)));
+      return *this;
+    }
+
+    /** component by component multiplication.
+     * @return reference to this (type Vector<double,4>).
+     */
+    template <typename T2>
+    inline const Vector & compMult(const Vector<T2,4u> & that) {
+      for (unsigned int i = 0; i < 4u; ++i)
+        this->val[i] *= that.val[i];
+      return *this;
+    }
+
+    /** component by component multiplication. */
+    inline const Vector & compMult(const Vector & that) {
+      lanes::store(val, simd::mul(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** component by component division.
+     * @return reference to this (type Vector<double,4>).
+     */
+    template <typename T2>
+    inline const Vector & compDiv(const Vector<T2,4u> & that) {
+      for (unsigned int i = 0; i < 4u; ++i)
+        this->val[i] /= that.val[i];
+      return *this;
+    }
+
+    /** component by component division. */
+    inline const Vector & compDiv(const Vector & that) {
+      lanes::store(val, simd::div(lanes::load(val), lanes::load(that.val)));
+      return *this;
+    }
+
+    /** Compute the magnitude of this vector. */
+    inline double abs () const {
+      simd::pd4 a = lanes::load(val);
+      return std::sqrt(simd::hsum(simd::mul(a,a)));
+    }
+
+    /** The product of all components of the Vector. */
+    inline double prod() const { return val[0] * val[1] * val[2] * val[3]; }
+
+    /** Return a type casted Vector from the original. */
+    template <typename T2>
+    inline Vector<T2,4u> to_type() const {
+      Vector<T2,4u> retval;
+      retval = *this;
+      return retval;
+    }
+
+    /** Add a fraction of another Vector to this Vector.
+     * @see Vector::addFraction.
+     */
+    template <typename T2>
+    inline Vector addFraction(const double & f, const Vector<T2,4u> & that) {
+      for (unsigned int i = 0; i < 4u; ++i)
+        this->val[i] += f * that.val[i];
+      return *this;
+    }
+
+    /** Add a fraction of another Vector to this Vector. */
+    inline Vector addFraction(const double & f, const Vector & that) {
+      lanes::store(val, simd::add(lanes::load(val),
+                                  simd::mul(simd::set1(f), lanes::load(that.val))));
+      return *this;
+    }
+
+    /** Convert the Vector to a string with an optional delimiter (default: [tab]).
+     * */
+    inline std::string to_string( const char & delim = '\t') const {
+      std::stringstream streamOut;
+      streamOut << val[0] << delim << val[1] << delim << val[2] << delim << val[3];
+      return streamOut.str( );
+    }
+  };
+
+
+
+
+  /* **** BEGIN SIMD MATH OPERATIONS **** { */
+  /* These non-template overloads are preferred to the generic templates in
+   * Vector.h whenever both operands are Vector<double,3> or Vector<double,4>.
+   * */
+#define OLSON_TOOLS_SIMD_VECTOR_OPS(L)                                         \
+  /** Inner product of two Vectors. */                                         \
+  inline double operator* (const Vector<double,L> & lhs,                       \
+                           const Vector<double,L> & rhs) {                     \
+    return simd::hsum( simd::mul( simd::lanes<L>::load(lhs.val),               \
+                                  simd::lanes<L>::load(rhs.val) ) );           \
+  }                                                                            \
+                                                                               \
+  /** Vector * Scalar  multiplication. */                                      \
+  inline Vector<double,L> operator* (const Vector<double,L> & lhs,             \
+                                     const double & rhs) {                     \
+    Vector<double,L> ret;                                                      \
+    simd::lanes<L>::store( ret.val, simd::mul( simd::lanes<L>::load(lhs.val),  \
+                                               simd::set1(rhs) ) );            \
+    return ret;                                                                \
+  }                                                                            \
+                                                                               \
+  /** Scalar * Vector  multiplication. */                                      \
+  inline Vector<double,L> operator* (const double & lhs,                       \
+                                     const Vector<double,L> & rhs) {           \
+    return rhs * lhs;                                                          \
+  }                                                                            \
+                                                                               \
+  /** Vector / Scalar division. */                                             \
+  inline Vector<double,L> operator/ (const Vector<double,L> & lhs,             \
+                                     const double & rhs) {                     \
+    Vector<double,L> ret;                                                      \
+    simd::lanes<L>::store( ret.val, simd::div( simd::lanes<L>::load(lhs.val),  \
+                                               simd::set1(rhs) ) );            \
+    return ret;                                                                \
+  }                                                                            \
+                                                                               \
+  /** Vector - Vector subtraction. */                                          \
+  inline Vector<double,L> operator- (const Vector<double,L> & lhs,             \
+                                     const Vector<double,L> & rhs) {           \
+    Vector<double,L> ret;                                                      \
+    simd::lanes<L>::store( ret.val, simd::sub( simd::lanes<L>::load(lhs.val),  \
+                                               simd::lanes<L>::load(rhs.val) ) ); \
+    return ret;                                                                \
+  }                                                                            \
+                                                                               \
+  /** Vector + Vector addition. */                                             \
+  inline Vector<double,L> operator+ (const Vector<double,L> & lhs,             \
+                                     const Vector<double,L> & rhs) {           \
+    Vector<double,L> ret;                                                      \
+    simd::lanes<L>::store( ret.val, simd::add( simd::lanes<L>::load(lhs.val),  \
+                                               simd::lanes<L>::load(rhs.val) ) ); \
+    return ret;                                                                \
+  }
+
+  OLSON_TOOLS_SIMD_VECTOR_OPS(3u)
+  OLSON_TOOLS_SIMD_VECTOR_OPS(4u)
+
+#undef OLSON_TOOLS_SIMD_VECTOR_OPS
+
+  /** Vector X Vector cross product returned via a given input buffer. */
+  inline void cross (      Vector<double,3u> & retval,
+                     const Vector<double,3u> & a,
+                     const Vector<double,3u> & b) {
+    simd::store3( retval.val, simd::cross3( simd::load3(a.val),
+                                            simd::load3(b.val) ) );
+  }
+
+  /** Vector X Vector cross product returned via a temporary Vector. */
+  inline Vector<double,3u> cross (const Vector<double,3u> & a,
+                                  const Vector<double,3u> & b) {
+    Vector<double,3u> retval;
+    cross( retval, a, b );
+    return retval;
+  }
+
+  /* *** END SIMD MATH OPERATIONS *** } */
+
+}/* namespace olson_tools */
+
+#endif // olson_tools_simd_Vector_h
@@ -0,0 +1,244 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+/** \file
+ * Thin wrappers around the SSE2/AVX packed-double intrinsics used by the
+ * SIMD specializations of Vector and SquareMatrix.
+ *
+ * A pd4 holds four doubles.  With AVX (-mavx) this is a single __m256d; with
+ * only SSE2 it is a pair of __m128d.  The load3/store3 functions only touch
+ * the first three doubles of the given memory (the fourth lane is loaded as
+ * zero and is never written back), so that they remain valid when a plain
+ * double[3] has been cast to a Vector<double,3> (see VNCAST, V3C and
+ * SquareMatrix::row()).
+ *
+ * Copyright 2004-2008 Spencer Olson
+ */
+
+#ifndef olson_tools_simd_pd_h
+#define olson_tools_simd_pd_h
+
+#if defined(__AVX__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#else
+#  error olson-tools/simd requires at least SSE2
+#endif
+
+namespace olson_tools {
+  namespace simd {
+
+#if defined(__AVX__)
+    /** Four packed doubles. */
+    struct pd4 {
+      __m256d v;
+    };
+
+    inline pd4 load4(const double * p) {
+      pd4 r; r.v = _mm256_loadu_pd(p); return r;
+    }
+
+    inline pd4 load3(const double * p) {
+      /* This is cheaper than _mm256_maskload_pd and does not stall store
+       * forwarding. */
+      pd4 r;
+      r.v = _mm256_insertf128_pd( _mm256_castpd128_pd256(_mm_loadu_pd(p)),
+                                  _mm_load_sd(p+2), 1 );
+      return r;
+    }
+
+    inline void store4(double * p, const pd4 & a) {
+      _mm256_storeu_pd(p, a.v);
+    }
+
+    inline void store3(double * p, const pd4 & a) {
+      _mm_storeu_pd(p, _mm256_castpd256_pd128(a.v));
+      _mm_store_sd(p+2, _mm256_extractf128_pd(a.v, 1));
+    }
+
+    inline pd4 set1(const double & d) {
+      pd4 r; r.v = _mm256_set1_pd(d); return r;
+    }
+
+    inline pd4 add(const pd4 & a, const pd4 & b) {
+      pd4 r; r.v = _mm256_add_pd(a.v, b.v); return r;
+    }
+
+    inline pd4 sub(const pd4 & a, const pd4 & b) {
+      pd4 r; r.v = _mm256_sub_pd(a.v, b.v); return r;
+    }
+
+    inline pd4 mul(const pd4 & a, const pd4 & b) {
+      pd4 r; r.v = _mm256_mul_pd(a.v, b.v); return r;
+    }
+
+    inline pd4 div(const pd4 & a, const pd4 & b) {
+      pd4 r; r.v = _mm256_div_pd(a.v, b.v); return r;
+    }
+
+    inline pd4 sqrt(const pd4 & a) {
+      pd4 r; r.v = _mm256_sqrt_pd(a.v); return r;
+    }
+
+    inline pd4 fabs(const pd4 & a) {
+      pd4 r; r.v = _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); return r;
+    }
+
+    /** Lower two lanes. */
+    inline __m128d lo(const pd4 & a) { return _mm256_castpd256_pd128(a.v); }
+
+    /** Upper two lanes. */
+    inline __m128d hi(const pd4 & a) { return _mm256_extractf128_pd(a.v, 1); }
+
+    inline pd4 make(const __m128d & l, const __m128d & h) {
+      pd4 r;
+      r.v = _mm256_insertf128_pd(_mm256_castpd128_pd256(l), h, 1);
+      return r;
+    }
+
+    /** Horizontal sums of a, b and c returned as (sum(a), sum(b), sum(c),
+     * sum(c)).  The fourth lane of each input must be zero (as it is after
+     * load3). */
+    inline pd4 hsum3x3(const pd4 & a, const pd4 & b, const pd4 & c) {
+      /* (a01, b01, a23, b23) and (c01, c01, c23, c23) */
+      __m256d ab = _mm256_hadd_pd(a.v, b.v);
+      __m256d cc = _mm256_hadd_pd(c.v, c.v);
+      pd4 r;
+      r.v = _mm256_add_pd( _mm256_permute2f128_pd(ab, cc, 0x21),
+                           _mm256_blend_pd(ab, cc, 0xC) );
+      return r;
+    }
+#else
+    /** Four packed doubles. */
+    struct pd4 {
+      __m128d l, h;
+    };
+
+    inline pd4 load4(const double * p) {
+      pd4 r; r.l = _mm_loadu_pd(p); r.h = _mm_loadu_pd(p+2); return r;
+    }
+
+    inline pd4 load3(const double * p) {
+      pd4 r; r.l = _mm_loadu_pd(p); r.h = _mm_load_sd(p+2); return r;
+    }
+
+    inline void store4(double * p, const pd4 & a) {
+      _mm_storeu_pd(p, a.l); _mm_storeu_pd(p+2, a.h);
+    }
+
+    inline void store3(double * p, const pd4 & a) {
+      _mm_storeu_pd(p, a.l); _mm_store_sd(p+2, a.h);
+    }
+
+    inline pd4 set1(const double & d) {
+      pd4 r; r.l = r.h = _mm_set1_pd(d); return r;
+    }
+
+    inline pd4 add(const pd4 & a, const pd4 & b) {
+      pd4 r; r.l = _mm_add_pd(a.l, b.l); r.h = _mm_add_pd(a.h, b.h); return r;
+    }
+
+    inline pd4 sub(const pd4 & a, const pd4 & b) {
+      pd4 r; r.l = _mm_sub_pd(a.l, b.l); r.h = _mm_sub_pd(a.h, b.h); return r;
+    }
+
+    inline pd4 mul(const pd4 & a, const pd4 & b) {
+      pd4 r; r.l = _mm_mul_pd(a.l, b.l); r.h = _mm_mul_pd(a.h, b.h); return r;
+    }
+
+    inline pd4 div(const pd4 & a, const pd4 & b) {
+      pd4 r; r.l = _mm_div_pd(a.l, b.l); r.h = _mm_div_pd(a.h, b.h); return r;
+    }
+
+    inline pd4 sqrt(const pd4 & a) {
+      pd4 r; r.l = _mm_sqrt_pd(a.l); r.h = _mm_sqrt_pd(a.h); return r;
+    }
+
+    inline pd4 fabs(const pd4 & a) {
+      const __m128d sign = _mm_set1_pd(-0.0);
+      pd4 r; r.l = _mm_andnot_pd(sign, a.l); r.h = _mm_andnot_pd(sign, a.h);
+      return r;
+    }
+
+    /** Lower two lanes. */
+    inline __m128d lo(const pd4 & a) { return a.l; }
+
+    /** Upper two lanes. */
+    inline __m128d hi(const pd4 & a) { return a.h; }
+
+    inline pd4 make(const __m128d & l, const __m128d & h) {
+      pd4 r; r.l = l; r.h = h; return r;
+    }
+
+    /** Horizontal sums of a, b and c returned as (sum(a), sum(b), sum(c),
+     * sum(c)).  The fourth lane of each input must be zero (as it is after
+     * load3). */
+    inline pd4 hsum3x3(const pd4 & a, const pd4 & b, const pd4 & c) {
+      /* (a0+a2, a1) and (b0+b2, b1) --> (a0+a2+a1, b0+b2+b1) */
+      __m128d a2 = _mm_add_sd(a.l, a.h);
+      __m128d b2 = _mm_add_sd(b.l, b.h);
+      __m128d c2 = _mm_add_sd(c.l, c.h);
+      pd4 r;
+      r.l = _mm_add_pd(_mm_unpacklo_pd(a2, b2), _mm_unpackhi_pd(a2, b2));
+      r.h = _mm_add_pd(_mm_unpacklo_pd(c2, c2), _mm_unpackhi_pd(c2, c2));
+      return r;
+    }
+#endif
+
+    /* Operators make it possible to write kernels once for both double and
+     * pd4 (see SquareMatrixArray.h). */
+    inline pd4 operator+ (const pd4 & a, const pd4 & b) { return add(a,b); }
+    inline pd4 operator- (const pd4 & a, const pd4 & b) { return sub(a,b); }
+    inline pd4 operator* (const pd4 & a, const pd4 & b) { return mul(a,b); }
+    inline pd4 operator/ (const pd4 & a, const pd4 & b) { return div(a,b); }
+
+    /** Sum of all four lanes. */
+    inline double hsum(const pd4 & a) {
+      __m128d s = _mm_add_pd(lo(a), hi(a));
+      s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+      return _mm_cvtsd_f64(s);
+    }
+
+    /** Three-vector cross product a x b.  Only the first three lanes of a and
+     * b are used; the fourth lane of the result is undefined. */
+    inline pd4 cross3(const pd4 & a, const pd4 & b) {
+      const __m128d al = lo(a), ah = hi(a),
+                    bl = lo(b), bh = hi(b);
+      /* (y,z | x) and (z,x | y) permutations of a and b */
+      const __m128d a_yz = _mm_shuffle_pd(al, ah, 1), a_zx = _mm_shuffle_pd(ah, al, 0),
+                    b_yz = _mm_shuffle_pd(bl, bh, 1), b_zx = _mm_shuffle_pd(bh, bl, 0),
+                    a_y  = _mm_unpackhi_pd(al, al),   b_y  = _mm_unpackhi_pd(bl, bl);
+      return make( _mm_sub_pd(_mm_mul_pd(a_yz, b_zx), _mm_mul_pd(a_zx, b_yz)),
+                   _mm_sub_sd(_mm_mul_sd(al,   b_y ), _mm_mul_sd(a_y,  bl  )) );
+    }
+
+  }/* namespace simd */
+}/* namespace olson_tools */
+
+#endif // olson_tools_simd_pd_h
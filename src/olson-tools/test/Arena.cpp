@@ -0,0 +1,145 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  Arena
+
+#include <olson-tools/Arena.h>
+#include <olson-tools/distribution/Inverter.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstddef>
+
+namespace {
+  struct Point {
+    double x, y, z;
+    Point() : x(1), y(2), z(3) { }
+  };
+
+  struct Gaussian {
+    double operator() ( const double & x ) const { return std::exp(-x*x); }
+  };
+
+  bool aligned( const void * p, const std::size_t & a ) {
+    return reinterpret_cast<std::size_t>(p) % a == 0;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( Arena );
+
+BOOST_AUTO_TEST_CASE( allocate ) {
+  olson_tools::Arena arena(1024);
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 0 );
+
+  char * c = arena.allocate_array<char>(3);
+  double * d = arena.allocate_array<double>(4);
+  BOOST_CHECK( aligned(d, __alignof__(double)) );
+  BOOST_CHECK( static_cast<void*>(d) > static_cast<void*>(c) );
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 1 );
+  BOOST_CHECK_EQUAL( arena.size(), 3 + 4 * sizeof(double) );
+
+  Point * p = arena.construct_array<Point>(10);
+  for ( int i = 0; i < 10; ++i ) {
+    BOOST_CHECK_EQUAL( p[i].x, 1 );
+    BOOST_CHECK_EQUAL( p[i].z, 3 );
+  }
+  BOOST_CHECK_EQUAL( p + 1, &p[1] );
+}
+
+BOOST_AUTO_TEST_CASE( chunks ) {
+  olson_tools::Arena arena(1024);
+  arena.allocate(1000);
+  arena.allocate(1000);
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 2 );
+
+  /* a large request gets a chunk of its own. */
+  void * big = arena.allocate(4096);
+  BOOST_CHECK( big );
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 3 );
+  BOOST_CHECK_EQUAL( arena.capacity(), 2 * 1024 + 4096 );
+
+  /* reserve makes the following allocations contiguous. */
+  arena.reserve(2000);
+  char * a = static_cast<char*>( arena.allocate(1000, 1) );
+  char * b = static_cast<char*>( arena.allocate(1000, 1) );
+  BOOST_CHECK_EQUAL( static_cast<void*>(a + 1000), static_cast<void*>(b) );
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 4 );
+
+  arena.release();
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 0 );
+  BOOST_CHECK_EQUAL( arena.capacity(), 0 );
+  BOOST_CHECK_EQUAL( arena.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( reset ) {
+  olson_tools::Arena arena(1024);
+  void * first = arena.allocate(100);
+  arena.allocate(1000);
+  arena.allocate(4096);
+  const std::size_t capacity = arena.capacity();
+
+  /* after a reset, the same memory is handed out again. */
+  for ( int i = 0; i < 10; ++i ) {
+    arena.reset();
+    BOOST_CHECK_EQUAL( arena.size(), 0 );
+    BOOST_CHECK_EQUAL( arena.allocate(100), first );
+    arena.allocate(1000);
+    arena.allocate(4096);
+  }
+  BOOST_CHECK_EQUAL( arena.capacity(), capacity );
+  BOOST_CHECK_EQUAL( arena.n_chunks(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( inverter ) {
+  using olson_tools::distribution::Inverter;
+  olson_tools::Arena arena;
+
+  Inverter heap( Gaussian(), -3., 3., 1000 );
+  Inverter in_arena( Gaussian(), -3., 3., 1000, &arena );
+  BOOST_CHECK( arena.size() >= 1001 * sizeof(double) );
+
+  int lh = 0, la = 0;
+  const double * qh = heap.invertedDistribution(lh);
+  const double * qa = in_arena.invertedDistribution(la);
+  BOOST_REQUIRE_EQUAL( lh, la );
+  for ( int i = 0; i < lh; ++i )
+    BOOST_CHECK_EQUAL( qh[i], qa[i] );
+
+  /* an assignment stays in the arena. */
+  const std::size_t sz = arena.size();
+  in_arena = heap;
+  BOOST_CHECK_EQUAL( arena.size(), sz + 1001 * sizeof(double) );
+  BOOST_CHECK_EQUAL( in_arena.leverarm(0.3), heap.leverarm(0.3) );
+
+  /* a copy from an array. */
+  Inverter copy( lh, qh );
+  BOOST_CHECK_EQUAL( copy.leverarm(0.7), heap.leverarm(0.7) );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
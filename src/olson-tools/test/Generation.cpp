@@ -0,0 +1,239 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  Generation
+
+#include <olson-tools/fit/Generation.h>
+#include <olson-tools/fit/make_options.h>
+#include <olson-tools/fit/GeneSimplex.h>
+#include <olson-tools/Arena.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  using olson_tools::Arena;
+  using olson_tools::fit::Gene;
+  using olson_tools::fit::Allele_struct;
+  using olson_tools::fit::ALLELE_DYNAMIC_CONT;
+
+  /** A smooth merit function with its maximum at (1, -2, ...). */
+  struct Paraboloid {
+    merit_t operator() ( const Gene & gene ) const {
+      double m = 0;
+      for ( int i = 0; i < gene.numAlleles(); ++i ) {
+        const double d = gene[i].val - (i % 2 ? -2.0 : 1.0);
+        m -= d*d;
+      }
+      return m;
+    }
+  };
+
+  /* (no local fits are done:  local_fit_max_individuals_prctage is 0) */
+  typedef olson_tools::fit::make_options<
+    Paraboloid, olson_tools::fit::GeneSimplex<Paraboloid> >::type options;
+  typedef olson_tools::fit::Individual< Paraboloid > Individual;
+  typedef olson_tools::fit::Generation< options > Generation;
+
+  /** A gene of n dynamic alleles with values offset + i. */
+  Gene make_gene( const int & n, const double & offset,
+                  Arena * arena = NULL ) {
+    Gene g(0, NULL, arena);
+    for ( int i = 0; i < n; ++i )
+      g += Allele_struct( -10, offset + i, 10, ALLELE_DYNAMIC_CONT );
+    return g;
+  }
+
+  /** Check that the alleles [a, a+n) of g have the values offset + i. */
+  void check_gene( const Gene & g, const int & n, const double & offset,
+                   const int & a = 0 ) {
+    BOOST_REQUIRE_EQUAL( g.numAlleles(), n );
+    for ( int i = 0; i < n; ++i ) {
+      BOOST_CHECK_EQUAL( g[i].val, offset + a + i );
+      BOOST_CHECK_EQUAL( g[i].min, -10 );
+      BOOST_CHECK_EQUAL( g[i].max,  10 );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( Generation_arena );
+
+BOOST_AUTO_TEST_CASE( gene_assign ) {
+  Arena arena;
+  Gene heap = make_gene(5, 100.0);
+
+  {
+    Gene a(make_gene(3, 0.0), &arena);
+    check_gene(a, 3, 0.0);
+    const std::size_t used = arena.size();
+    BOOST_CHECK( used >= 3 * sizeof(Allele_struct) );
+
+    /* heap -> arena:  a grows within the arena. */
+    a = heap;
+    check_gene(a, 5, 100.0);
+    BOOST_CHECK( arena.size() >= used + 5 * sizeof(Allele_struct) );
+
+    /* same size:  no new allocation. */
+    const std::size_t used2 = arena.size();
+    a = make_gene(5, 200.0);
+    check_gene(a, 5, 200.0);
+    BOOST_CHECK_EQUAL( arena.size(), used2 );
+
+    /* arena -> heap. */
+    Gene h;
+    h = a;
+    check_gene(h, 5, 200.0);
+
+    /* arena -> arena. */
+    Gene b(Gene(), &arena);
+    b = a;
+    check_gene(b, 5, 200.0);
+
+    /* a heap copy of an arena gene owns heap memory. */
+    Gene c(a);
+    a = make_gene(2, 7.0);
+    check_gene(c, 5, 200.0);
+    check_gene(a, 2, 7.0);
+  }
+
+  /* the arena genes are gone before the arena, the heap gene is unchanged. */
+  check_gene(heap, 5, 100.0);
+}
+
+BOOST_AUTO_TEST_CASE( gene_append ) {
+  Arena arena;
+  Gene a(make_gene(2, 0.0), &arena);
+  Gene heap = make_gene(3, 2.0);
+
+  a += heap;
+  check_gene(a, 5, 0.0);
+  a += Allele_struct( -10, 5.0, 10, ALLELE_DYNAMIC_CONT );
+  check_gene(a, 6, 0.0);
+
+  heap += a;
+  BOOST_REQUIRE_EQUAL( heap.numAlleles(), 9 );
+  for ( int i = 0; i < 6; ++i )
+    BOOST_CHECK_EQUAL( heap[3 + i].val, i );
+
+  /* appending to an empty arena gene. */
+  Gene e(Gene(), &arena);
+  e += heap;
+  BOOST_CHECK_EQUAL( e.numAlleles(), 9 );
+  BOOST_CHECK_EQUAL( e[8].val, 5.0 );
+}
+
+BOOST_AUTO_TEST_CASE( copy_alleles ) {
+  Arena arena;
+  Gene heap = make_gene(6, 10.0);
+
+  Gene a(make_gene(2, 0.0), &arena);
+  a.copy_alleles_from_Gene(heap, 1, 3);
+  check_gene(a, 3, 10.0, 1);
+
+  /* same size again. */
+  a.copy_alleles_from_Gene(heap, 3, 5);
+  check_gene(a, 3, 10.0, 3);
+
+  /* the upper bound is clamped to the source. */
+  a.copy_alleles_from_Gene(heap, 2);
+  check_gene(a, 4, 10.0, 2);
+
+  Gene h = make_gene(1, 0.0);
+  h.copy_alleles_from_Gene(a, 0, 1);
+  check_gene(h, 2, 10.0, 2);
+}
+
+BOOST_AUTO_TEST_CASE( individuals ) {
+  Arena arena;
+  const Gene dna = make_gene(4, 0.5);
+
+  Individual heap(dna);
+  {
+    Individual * a = new (arena.allocate_array<Individual>(1))
+                       Individual(dna, &arena);
+    check_gene(a->DNA, 4, 0.5);
+    BOOST_CHECK_EQUAL( a->Merit(), Paraboloid()(dna) );
+
+    heap.DNA = make_gene(4, -3.0);
+    heap.forceUpdate();
+    *a = heap;
+    check_gene(a->DNA, 4, -3.0);
+    BOOST_CHECK_EQUAL( a->Merit(), heap.Merit() );
+
+    /* a heap copy of an arena Individual. */
+    Individual copy(*a);
+    check_gene(copy.DNA, 4, -3.0);
+
+    a->~Individual();
+    check_gene(copy.DNA, 4, -3.0);
+  }
+  check_gene(heap.DNA, 4, -3.0);
+}
+
+BOOST_AUTO_TEST_CASE( generation_steps ) {
+  options opts;
+  opts.population = 60;
+  opts.replace = 0.5;
+  /* (keep the merits unscaled) */
+  opts.encourage_diversity = false;
+
+  Gene dna;
+  for ( int i = 0; i < 3; ++i )
+    dna += Allele_struct( -5, 0, 5, ALLELE_DYNAMIC_CONT );
+
+  Generation g(opts, dna);
+  g.randinit();
+  g.sort();
+  merit_t best = g.bestMerit();
+  BOOST_CHECK( g.bestGene().isValid() );
+  BOOST_CHECK_EQUAL( g.bestMerit(), Paraboloid()(g.bestGene()) );
+
+  /* each step builds (and drops) a partial copy of the generation and a
+   * list of children, all in arenas. */
+  for ( int step = 0; step < 20; ++step ) {
+    g.tournament();
+    g.sort();
+    BOOST_CHECK( g.bestGene().isValid() );
+    BOOST_CHECK_EQUAL( g.bestGene().numAlleles(), 3 );
+    BOOST_CHECK_EQUAL( g.bestMerit(), Paraboloid()(g.bestGene()) );
+    /* the best parents survive. */
+    BOOST_CHECK( g.bestMerit() >= best );
+    best = g.bestMerit();
+  }
+
+  /* a full copy has its own arena. */
+  {
+    Generation c(g);
+    c.sort();
+    BOOST_CHECK_EQUAL( c.bestMerit(), g.bestMerit() );
+    c.proportional();
+  }
+  g.sort();
+  BOOST_CHECK_EQUAL( g.bestMerit(), best );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
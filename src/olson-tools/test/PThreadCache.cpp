@@ -0,0 +1,458 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  PThreadCache
+
+#include <olson-tools/PThreadCache.h>
+#include <olson-tools/PThreadEval.h>
+#include <olson-tools/WorkDeque.h>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <unistd.h>
+
+namespace {
+  using olson_tools::PThreadCache;
+  using olson_tools::PThreadTask;
+  using olson_tools::PThreadTaskSet;
+  using olson_tools::WorkDeque;
+
+  struct SumTask : PThreadTask {
+    int i;
+    long value;
+    SumTask( const int & i ) : i(i), value(0) { }
+    virtual void exec() {
+      for (int j = 0; j <= i; ++j)
+        value += j;
+    }
+  };
+
+  /** A task that takes a while (so that others stay queued). */
+  struct SlowTask : SumTask {
+    SlowTask( const int & i ) : SumTask(i) { }
+    virtual void exec() {
+      usleep(2000);
+      SumTask::exec();
+    }
+  };
+
+  /** Adds and waits for all of the tasks. */
+  long run_tasks( PThreadCache & cache, const int & n ) {
+    PThreadTaskSet tasks;
+    for (int i = 0; i < n; ++i) {
+      SumTask * t = new SumTask(i % 100);
+      tasks.insert(t);
+      cache.addTask(t);
+    }
+
+    long sum = 0;
+    while ( tasks.size() ) {
+      PThreadTaskSet finished = cache.waitForTasks(tasks);
+      for ( PThreadTaskSet::iterator i = finished.begin();
+            i != finished.end(); ++i ) {
+        sum += static_cast<SumTask*>(*i)->value;
+        tasks.erase(*i);
+        delete *i;
+      }
+    }
+    return sum;
+  }
+
+  long expected_sum( const int & n ) {
+    long sum = 0;
+    for (int i = 0; i < n; ++i)
+      sum += (i % 100) * (i % 100 + 1) / 2;
+    return sum;
+  }
+
+  /** A task that adds two sub-tasks to the cache and waits for them. */
+  struct Fib {
+    PThreadCache * cache;
+    int n;
+    long * result;
+
+    Fib( PThreadCache & cache, const int & n, long * result )
+      : cache(&cache), n(n), result(result) { }
+
+    void operator() () {
+      if ( n < 2 ) {
+        *result = n;
+        return;
+      }
+      long a = 0, b = 0;
+      olson_tools::PThreadEval<Fib> eval(*cache);
+      eval.eval( Fib(*cache, n - 1, &a) );
+      eval.eval( Fib(*cache, n - 2, &b) );
+      eval.joinAll();
+      *result = a + b;
+    }
+
+    template < typename Gatherer >
+    void accept( Gatherer & /*g*/ ) const { }
+  };
+
+  /** Sums i*i through the gatherer of PThreadEval::joinAll. */
+  struct Square {
+    int i;
+    long value;
+    Square( const int & i ) : i(i), value(0) { }
+    void operator() () { value = long(i) * i; }
+
+    template < typename Gatherer >
+    void accept( Gatherer & g ) const { g.update(value); }
+  };
+
+  struct SumGather {
+    long sum;
+    int count;
+    SumGather() : sum(0), count(0) { }
+    void update( const long & value ) { sum += value; ++count; }
+  };
+
+  struct Thief {
+    WorkDeque<int> & deque;
+    std::vector<int> & taken;
+    volatile bool & done;
+
+    Thief( WorkDeque<int> & deque, std::vector<int> & taken,
+           volatile bool & done )
+      : deque(deque), taken(taken), done(done) { }
+
+    static void * run( void * arg ) {
+      Thief * t = static_cast<Thief*>(arg);
+      while ( true ) {
+        int * i = t->deque.steal();
+        if ( i != NULL )
+          t->taken.push_back(*i);
+        else if ( __atomic_load_n( &t->done, __ATOMIC_ACQUIRE ) &&
+                  t->deque.size() == 0 )
+          break;
+      }
+      return NULL;
+    }
+  };
+}
+
+
+BOOST_AUTO_TEST_SUITE( PThreadCache_tests );
+
+BOOST_AUTO_TEST_CASE( WorkDeque_serial ) {
+  WorkDeque<int> d(4);
+  std::vector<int> v(100);
+  for (int i = 0; i < 100; ++i) {
+    v[i] = i;
+    d.push(&v[i]);
+  }
+  BOOST_CHECK_EQUAL( d.size(), 100 );
+
+  /* the owner takes the newest, thieves the oldest. */
+  BOOST_CHECK_EQUAL( *d.pop(), 99 );
+  BOOST_CHECK_EQUAL( *d.steal(), 0 );
+  for (int i = 98; i > 0; --i)
+    BOOST_CHECK_EQUAL( *d.pop(), i );
+  BOOST_CHECK( d.pop() == NULL );
+  BOOST_CHECK( d.steal() == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( WorkDeque_steal ) {
+  /* every item is taken exactly once. */
+  const int n = 200000, n_thieves = 3;
+  std::vector<int> v(n);
+  WorkDeque<int> d;
+  volatile bool done = false;
+
+  std::vector< std::vector<int> > taken(n_thieves + 1);
+  std::vector<Thief> thieves;
+  std::vector<pthread_t> threads(n_thieves);
+  for (int t = 0; t < n_thieves; ++t)
+    thieves.push_back( Thief(d, taken[t+1], done) );
+  for (int t = 0; t < n_thieves; ++t)
+    pthread_create(&threads[t], NULL, Thief::run, &thieves[t]);
+
+  for (int i = 0; i < n; ++i) {
+    v[i] = i;
+    d.push(&v[i]);
+    if ( i % 3 == 0 ) {
+      int * j = d.pop();
+      if ( j != NULL )
+        taken[0].push_back(*j);
+    }
+  }
+  for (int * j; (j = d.pop()) != NULL; )
+    taken[0].push_back(*j);
+  __atomic_store_n( &done, true, __ATOMIC_RELEASE );
+  for (int t = 0; t < n_thieves; ++t)
+    pthread_join(threads[t], NULL);
+
+  std::vector<int> count(n, 0);
+  for (unsigned int t = 0; t < taken.size(); ++t)
+    for (unsigned int i = 0; i < taken[t].size(); ++i)
+      ++count[ taken[t][i] ];
+  for (int i = 0; i < n; ++i)
+    BOOST_CHECK_EQUAL( count[i], 1 );
+}
+
+BOOST_AUTO_TEST_CASE( tasks ) {
+  PThreadCache cache;
+  const int threads[] = {1, 2, 4};
+  for (int t = 0; t < 3; ++t) {
+    cache.set_max_threads(threads[t]);
+    BOOST_CHECK_EQUAL( cache.get_max_threads(), threads[t] );
+    BOOST_CHECK_EQUAL( run_tasks(cache, 5000), expected_sum(5000) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( completion ) {
+  using olson_tools::PThreadCompletion;
+  PThreadCache cache;
+  const int threads[] = {1, 3};
+  for (int t = 0; t < 2; ++t) {
+    cache.set_max_threads(threads[t]);
+    const int n = 20000;
+
+    /* any:  one task at a time, in the order in which they finish. */
+    PThreadCompletion c;
+    for (int i = 0; i < n; ++i)
+      cache.addTask(new SumTask(i % 100), c);
+    long sum = 0;
+    int count = 0;
+    for (PThreadTask * task; (task = cache.waitForAny(c)) != NULL; ++count) {
+      sum += static_cast<SumTask*>(task)->value;
+      delete task;
+    }
+    BOOST_CHECK_EQUAL( count, n );
+    BOOST_CHECK_EQUAL( sum, expected_sum(n) );
+    BOOST_CHECK_EQUAL( c.outstanding(), 0 );
+    BOOST_CHECK_EQUAL( c.finished(), 0 );
+
+    /* all:  the finished tasks stay in the queue. */
+    for (int i = 0; i < n; ++i)
+      cache.addTask(new SumTask(i % 100), c);
+    cache.waitForAll(c);
+    BOOST_CHECK_EQUAL( c.outstanding(), 0 );
+    BOOST_CHECK_EQUAL( c.finished(), n );
+    sum = 0;
+    for (PThreadTask * task; (task = c.pop()) != NULL; ) {
+      sum += static_cast<SumTask*>(task)->value;
+      delete task;
+    }
+    BOOST_CHECK_EQUAL( sum, expected_sum(n) );
+
+    /* nothing left to wait for. */
+    BOOST_CHECK( cache.waitForAny(c) == NULL );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( resize_with_completion ) {
+  /* tasks that are still queued when the threads are restarted must keep
+   * reporting to their completion queue. */
+  using olson_tools::PThreadCompletion;
+  using olson_tools::ThreadPlacement;
+  PThreadCache cache;
+  cache.set_max_threads(2);
+  const int n = 20;
+  for (int r = 0; r < 2; ++r) {
+    PThreadCompletion c;
+    for (int i = 0; i < n; ++i)
+      cache.addTask(new SlowTask(i), c);
+    if ( r == 0 )
+      cache.set_max_threads(3);
+    else
+      cache.set_placement( ThreadPlacement(ThreadPlacement::COMPACT) );
+    cache.waitForAll(c);
+    BOOST_CHECK_EQUAL( c.outstanding(), 0 );
+    BOOST_CHECK_EQUAL( c.finished(), n );
+    long sum = 0;
+    for (PThreadTask * task; (task = c.pop()) != NULL; ) {
+      sum += static_cast<SumTask*>(task)->value;
+      delete task;
+    }
+    BOOST_CHECK_EQUAL( sum, expected_sum(n) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( nested ) {
+  /* tasks that wait for their own sub-tasks must not tie up the threads. */
+  PThreadCache cache;
+  cache.set_max_threads(3);
+  long result = 0;
+  Fib(cache, 16, &result)();
+  BOOST_CHECK_EQUAL( result, 987 );
+}
+
+BOOST_AUTO_TEST_CASE( eval_pool ) {
+  PThreadCache cache;
+  cache.set_max_threads(3);
+  olson_tools::PThreadEval<Square> eval(cache);
+  BOOST_CHECK_EQUAL( eval.capacity(), 0u );
+
+  const int n = 5000;
+  long expected = 0;
+  for (int i = 0; i < n; ++i)
+    expected += long(i) * i;
+
+  unsigned int capacity = 0;
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < n; ++i)
+      eval.eval( Square(i) );
+    SumGather g;
+    eval.joinAll(g);
+    BOOST_CHECK_EQUAL( g.count, n );
+    BOOST_CHECK_EQUAL( g.sum, expected );
+
+    /* the tasks of the first round are reused. */
+    if ( round == 0 )
+      capacity = eval.capacity();
+    BOOST_CHECK( eval.capacity() >= unsigned(n) );
+    BOOST_CHECK_EQUAL( eval.capacity(), capacity );
+  }
+
+  olson_tools::PThreadEval<Square> reserved(cache);
+  reserved.reserve(100);
+  BOOST_CHECK_EQUAL( reserved.capacity(), 100u );
+  /* the destructor waits for the tasks. */
+  for (int i = 0; i < 100; ++i)
+    reserved.eval( Square(i) );
+  BOOST_CHECK_EQUAL( reserved.capacity(), 100u );
+}
+
+BOOST_AUTO_TEST_CASE( copy ) {
+  PThreadCache cache;
+  cache.set_max_threads(3);
+  PThreadCache copy(cache);
+  BOOST_CHECK_EQUAL( copy.get_max_threads(), 3 );
+  BOOST_CHECK_EQUAL( run_tasks(copy, 1000), expected_sum(1000) );
+}
+
+BOOST_AUTO_TEST_CASE( instrumentation ) {
+  using olson_tools::PThreadStats;
+  PThreadCache cache;
+  cache.set_max_threads(3);
+  BOOST_CHECK_EQUAL( cache.get_instrumentation(), int(PThreadStats::NONE) );
+
+  /* nothing is counted by default. */
+  run_tasks(cache, 1000);
+  std::vector<PThreadStats> stats = cache.get_stats();
+  BOOST_CHECK_EQUAL( stats.size(), 3u );
+  for (unsigned int i = 0; i < stats.size(); ++i)
+    BOOST_CHECK_EQUAL( stats[i].tasks, 0 );
+
+  const int levels[] = { PThreadStats::COUNTERS, PThreadStats::TRACE };
+  for (int l = 0; l < 2; ++l) {
+    cache.set_instrumentation(levels[l]);
+    cache.reset_stats();
+    const int n = 2000;
+    BOOST_CHECK_EQUAL( run_tasks(cache, n), expected_sum(n) );
+
+    stats = cache.get_stats();
+    long tasks = 0, found = 0, events = 0;
+    for (unsigned int i = 0; i < stats.size(); ++i) {
+      tasks += stats[i].tasks;
+      for (int j = 0; j < 3; ++j)
+        found += stats[i].found[j];
+      for (unsigned int j = 0; j < stats[i].events.size(); ++j)
+        events += stats[i].events[j].type != NULL;
+      BOOST_CHECK( stats[i].max_queue_wait <= stats[i].queue_wait );
+    }
+    BOOST_CHECK_EQUAL( tasks, n );
+    BOOST_CHECK_EQUAL( found, n );
+    BOOST_CHECK_EQUAL( events, levels[l] == PThreadStats::TRACE ? n : 0 );
+  }
+
+  std::ostringstream summary, trace;
+  cache.print_stats(summary);
+  cache.write_trace(trace);
+  BOOST_CHECK( summary.str().find("total") != std::string::npos );
+  BOOST_CHECK( trace.str().find("\"traceEvents\":[") != std::string::npos );
+  BOOST_CHECK( trace.str().find("SumTask") != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( placement ) {
+  using olson_tools::ThreadPlacement;
+  using olson_tools::CpuTopology;
+
+  std::vector<int> cpus;
+  BOOST_CHECK( olson_tools::parse_cpu_list("0-2,5,7-8\n", cpus) );
+  const int expected[] = {0, 1, 2, 5, 7, 8};
+  BOOST_CHECK_EQUAL_COLLECTIONS( cpus.begin(), cpus.end(),
+                                 expected, expected + 6 );
+  BOOST_CHECK( !olson_tools::parse_cpu_list("3-1", cpus) );
+  BOOST_CHECK( !olson_tools::parse_cpu_list("a", cpus) );
+
+  /* two nodes of two CPUs. */
+  std::vector< std::vector<int> > nodes(2);
+  nodes[0].push_back(0); nodes[0].push_back(2);
+  nodes[1].push_back(1); nodes[1].push_back(3);
+  const CpuTopology t(nodes);
+  BOOST_CHECK_EQUAL( t.n_cpus(), 4 );
+  BOOST_CHECK_EQUAL( t.node_of(3), 1 );
+
+  const int compact[] = {0, 2, 1, 3, 0};
+  cpus = ThreadPlacement::parse("compact").assign(5, t);
+  BOOST_CHECK_EQUAL_COLLECTIONS( cpus.begin(), cpus.end(), compact, compact+5 );
+  const int scatter[] = {0, 1, 2, 3, 0};
+  cpus = ThreadPlacement::parse("scatter").assign(5, t);
+  BOOST_CHECK_EQUAL_COLLECTIONS( cpus.begin(), cpus.end(), scatter, scatter+5 );
+  const int list[] = {3, 1, 3};
+  cpus = ThreadPlacement::parse("3,1").assign(3, t);
+  BOOST_CHECK_EQUAL_COLLECTIONS( cpus.begin(), cpus.end(), list, list+3 );
+  const int none[] = {-1, -1};
+  cpus = ThreadPlacement::parse("").assign(2, t);
+  BOOST_CHECK_EQUAL_COLLECTIONS( cpus.begin(), cpus.end(), none, none+2 );
+
+  /* on this machine. */
+  const CpuTopology & sys = CpuTopology::system();
+  BOOST_CHECK( sys.n_nodes() >= 1 );
+  PThreadCache cache;
+  cache.set_max_threads(3);
+  cache.set_placement( ThreadPlacement(ThreadPlacement::COMPACT) );
+  BOOST_CHECK_EQUAL( cache.get_placement().policy, ThreadPlacement::COMPACT );
+  cpus = cache.get_thread_cpus();
+  BOOST_CHECK_EQUAL( cpus.size(), 3u );
+  for (unsigned int i = 0; i < cpus.size(); ++i)
+    BOOST_CHECK( cpus[i] == -1 || sys.node_of(cpus[i]) >= 0 );
+  BOOST_CHECK_EQUAL( run_tasks(cache, 2000), expected_sum(2000) );
+
+  /* a CPU that does not exist leaves the threads unpinned. */
+  cache.set_placement( ThreadPlacement::parse("100000") );
+  cpus = cache.get_thread_cpus();
+  for (unsigned int i = 0; i < cpus.size(); ++i)
+    BOOST_CHECK_EQUAL( cpus[i], -1 );
+  BOOST_CHECK_EQUAL( run_tasks(cache, 2000), expected_sum(2000) );
+
+  std::vector<char> buf(100000, 1);
+  cache.first_touch(&buf[0], buf.size());
+  BOOST_CHECK( std::count(buf.begin(), buf.end(), 0) == long(buf.size()) );
+  std::fill(buf.begin(), buf.end(), 1);
+  olson_tools::first_touch( &buf[0], buf.size(), std::vector<int>(3, 1), t );
+  BOOST_CHECK( std::count(buf.begin(), buf.end(), 0) == long(buf.size()) );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
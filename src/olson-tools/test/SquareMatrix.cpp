@@ -0,0 +1,201 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 1998-2008 Spencer Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  SquareMatrix
+
+#include <olson-tools/SquareMatrix.h>
+#include <olson-tools/SquareMatrixArray.h>
+#include <olson-tools/Timer.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+  using olson_tools::Vector;
+  using olson_tools::VectorArray;
+  using olson_tools::SquareMatrix;
+  using olson_tools::SquareMatrixArray;
+  using olson_tools::V3;
+
+  typedef Vector<double,3> Vec3;
+
+  double rnd() { return 2.0 * std::rand() / double(RAND_MAX) - 1.0; }
+
+  template < unsigned int L >
+  SquareMatrix<double,L> random_matrix() {
+    SquareMatrix<double,L> m;
+    for (unsigned int i = 0; i < L; ++i)
+      for (unsigned int j = 0; j < L; ++j)
+        m.val[i][j] = rnd() + (i == j ? 2.0 : 0.0);
+    return m;
+  }
+
+  template < unsigned int L >
+  double max_diff( const SquareMatrix<double,L> & a,
+                   const SquareMatrix<double,L> & b ) {
+    double d = 0.0;
+    for (unsigned int i = 0; i < L; ++i)
+      for (unsigned int j = 0; j < L; ++j)
+        d = std::max(d, std::abs(a.val[i][j] - b.val[i][j]));
+    return d;
+  }
+
+  template < unsigned int L >
+  double max_diff( const Vector<double,L> & a, const Vector<double,L> & b ) {
+    double d = 0.0;
+    for (unsigned int i = 0; i < L; ++i)
+      d = std::max(d, std::abs(a[i] - b[i]));
+    return d;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( SquareMatrix_testsuite );
+
+  BOOST_AUTO_TEST_CASE( determinant ) {
+    SquareMatrix<double,2> m2;
+    m2.val[0][0] = 1; m2.val[0][1] = 2;
+    m2.val[1][0] = 3; m2.val[1][1] = 4;
+    BOOST_CHECK_CLOSE( det(m2), -2.0, 1e-12 );
+
+    SquareMatrix<double,3> m3;
+    m3.val[0][0] = 2; m3.val[0][1] = 0; m3.val[0][2] = 1;
+    m3.val[1][0] = 1; m3.val[1][1] = 3; m3.val[1][2] = 2;
+    m3.val[2][0] = 1; m3.val[2][1] = 1; m3.val[2][2] = 2;
+    BOOST_CHECK_CLOSE( det(m3), 6.0, 1e-12 );
+
+    /* the general (LU) version must agree with the closed forms. */
+    SquareMatrix<double,4> m4 = random_matrix<4>();
+    SquareMatrix<double,4> lu = m4;
+    unsigned int perm[4];
+    double d = olson_tools::lu_decompose(lu, perm);
+    for (unsigned int i = 0; i < 4; ++i)
+      d *= lu.val[i][i];
+    BOOST_CHECK_CLOSE( det(m4), d, 1e-10 );
+  }
+
+  BOOST_AUTO_TEST_CASE( inverse_and_solve ) {
+    SquareMatrix<double,3> I3 = SquareMatrix<double,3>::identity();
+    SquareMatrix<double,4> I4 = SquareMatrix<double,4>::identity();
+
+    for (unsigned int t = 0; t < 10; ++t) {
+      SquareMatrix<double,3> m3 = random_matrix<3>();
+      BOOST_CHECK_SMALL( max_diff(m3 * inverse(m3), I3), 1e-12 );
+
+      SquareMatrix<double,4> m4 = random_matrix<4>();
+      BOOST_CHECK_SMALL( max_diff(m4 * inverse(m4), I4), 1e-12 );
+
+      Vector<double,4> b;
+      for (unsigned int i = 0; i < 4; ++i)
+        b[i] = rnd();
+      BOOST_CHECK_SMALL( max_diff(m4 * solve(m4, b), b), 1e-12 );
+    }
+
+    SquareMatrix<double,3> singular(0.0);
+    BOOST_CHECK_THROW( inverse(singular), std::runtime_error );
+    BOOST_CHECK_THROW( solve(singular, V3(1.,2.,3.)), std::runtime_error );
+  }
+
+  BOOST_AUTO_TEST_CASE( batched ) {
+    /* an odd size exercises both the packed and the remainder paths. */
+    const unsigned int N = 103;
+    SquareMatrixArray<double,3> A(N), B(N), C, Ai;
+    VectorArray<double,3> x(N), y, z;
+    SquareMatrix<double,3> R = random_matrix<3>();
+
+    for (unsigned int i = 0; i < N; ++i) {
+      A.set(i, random_matrix<3>());
+      B.set(i, random_matrix<3>());
+      x[i] = V3(rnd(), rnd(), rnd());
+    }
+
+    mult(A, x, y);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_SMALL( max_diff(y[i].get(), A.get(i) * x[i].get()), 1e-14 );
+
+    mult(R, x, y);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_SMALL( max_diff(y[i].get(), R * x[i].get()), 1e-14 );
+
+    mult(A, B, C);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_SMALL( max_diff(C.get(i), A.get(i) * B.get(i)), 1e-14 );
+
+    double d[N];
+    det(A, d);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_CLOSE( d[i], det(A.get(i)), 1e-10 );
+
+    inverse(A, Ai);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_SMALL( max_diff(Ai.get(i), inverse(A.get(i))), 1e-12 );
+
+    solve(A, x, z);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_SMALL( max_diff(z[i].get(), solve(A.get(i), x[i].get())), 1e-12);
+
+    /* in-place multiplication. */
+    mult(R, x, x);
+    for (unsigned int i = 0; i < N; ++i)
+      BOOST_CHECK_SMALL( max_diff(x[i].get(), y[i].get()), 1e-14 );
+  }
+
+  BOOST_AUTO_TEST_CASE( batched_timing ) {
+    const unsigned int N = 100000, reps = 20;
+    SquareMatrixArray<double,3> A(N, SquareMatrix<double,3>::identity());
+    VectorArray<double,3> x(N, V3(1.,2.,3.)), y;
+    SquareMatrix<double,3> * a = new SquareMatrix<double,3>[N];
+    Vec3 * v = new Vec3[N], * w = new Vec3[N];
+    for (unsigned int i = 0; i < N; ++i) {
+      a[i] = SquareMatrix<double,3>::identity();
+      v[i] = V3(1.,2.,3.);
+    }
+
+    olson_tools::Timer t0, t1;
+    t0.start();
+    for (unsigned int r = 0; r < reps; ++r)
+      for (unsigned int i = 0; i < N; ++i)
+        w[i] = a[i] * v[i];
+    t0.stop();
+
+    t1.start();
+    for (unsigned int r = 0; r < reps; ++r)
+      mult(A, x, y);
+    t1.stop();
+
+    BOOST_CHECK_EQUAL( y[N-1].get(), w[N-1] );
+    BOOST_TEST_MESSAGE( "AoS  M*V:  " << t0 );
+    BOOST_TEST_MESSAGE( "SoA  M*V:  " << t1 );
+
+    delete[] a;
+    delete[] v;
+    delete[] w;
+  }
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -32,11 +32,19 @@
 
 #include <boost/test/unit_test.hpp>
 
+#if defined(PTHREAD_SYS_DEFINED)
+#  include <unistd.h>
+#endif
+
 namespace {
   using olson_tools::Synchronize;
   using olson_tools::synchronize;
   using olson_tools::SyncLock;
   using olson_tools::SyncKey;
+  using olson_tools::SyncRWLock;
+  using olson_tools::SyncReadKey;
+  using olson_tools::SyncWriteKey;
+  using olson_tools::SyncLockStats;
 
   struct AStruct {};
 
@@ -51,6 +59,59 @@ namespace {
                          IF_THREADS(true,false) );
     }
   };
+
+#if defined(PTHREAD_SYS_DEFINED)
+  /** Increments a shared counter under a lock many times. */
+  struct Counter {
+    SyncLock lock;
+    long count;
+    int hold_us;
+
+    Counter() : count(0), hold_us(0) { }
+  };
+
+  void * increment( void * arg ) {
+    Counter & c = *static_cast<Counter*>(arg);
+    for ( int i = 0; i < 20000; ++i ) {
+      SyncKey key(c.lock);
+      long v = c.count;
+      if ( c.hold_us && i % 1000 == 0 )
+        usleep( c.hold_us );
+      c.count = v + 1;
+    }
+    return NULL;
+  }
+
+  /** Reads the shared value twice under a shared lock while a writer
+   * changes it. */
+  struct Shared {
+    SyncRWLock lock;
+    long a, b;
+    bool torn;
+
+    Shared() : a(0), b(0), torn(false) { }
+  };
+
+  void * reader( void * arg ) {
+    Shared & s = *static_cast<Shared*>(arg);
+    for ( int i = 0; i < 20000; ++i ) {
+      SyncReadKey key(s.lock);
+      if ( s.a != s.b )
+        s.torn = true;
+    }
+    return NULL;
+  }
+
+  void * writer( void * arg ) {
+    Shared & s = *static_cast<Shared*>(arg);
+    for ( int i = 0; i < 20000; ++i ) {
+      SyncWriteKey key(s.lock);
+      ++s.a;
+      ++s.b;
+    }
+    return NULL;
+  }
+#endif
 }
 
 
@@ -98,5 +159,86 @@ BOOST_AUTO_TEST_CASE( syncronize_Functor_access ) {
   BOOST_CHECK_EQUAL( f.value, 1 );
 }
 
+BOOST_AUTO_TEST_CASE( SyncRWLock_class ) {
+  SyncRWLock lock;
+  lock.lock();
+  lock.unlock();
+
+  lock.lockShared();
+#if defined(PTHREAD_SYS_DEFINED)
+  /* any number of readers. */
+  lock.lockShared();
+  lock.unlockShared();
+#endif
+  lock.unlockShared();
+
+  {
+    SyncWriteKey key(lock);
+  }
+  {
+    SyncReadKey key(lock);
+  }
+
+  SyncRWLock copy(lock);
+  copy.lock();
+  copy.unlock();
+
+  /* nothing to contend with here. */
+  BOOST_CHECK_EQUAL( lock.stats().contended, 0 );
+}
+
+#if defined(PTHREAD_SYS_DEFINED)
+BOOST_AUTO_TEST_CASE( SyncLock_contention ) {
+  const int n = 4;
+  pthread_t threads[n];
+
+  for ( int hold = 0; hold < 2; ++hold ) {
+    Counter c;
+    /* the second time, the lock is held long enough that waiters sleep. */
+    c.hold_us = hold ? 200 : 0;
+    for ( int i = 0; i < n; ++i )
+      pthread_create( threads + i, NULL, &increment, &c );
+    for ( int i = 0; i < n; ++i )
+      pthread_join( threads[i], NULL );
+
+    BOOST_CHECK_EQUAL( c.count, n * 20000 );
+    BOOST_CHECK_EQUAL( c.lock.isLocked(), false );
+
+    SyncLockStats s = c.lock.stats();
+#  if defined(SYNCLOCK_STATS)
+    BOOST_CHECK_EQUAL( s.acquisitions, n * 20000 );
+    BOOST_CHECK( s.contended <= s.acquisitions );
+    BOOST_CHECK( s.wait_ns >= 0 );
+    BOOST_TEST_MESSAGE( "hold " << c.hold_us << "us:  "
+                        << s.contended << " contended, "
+                        << s.parks << " parks, "
+                        << s.wait_ns / 1000 << " us waiting" );
+    c.lock.resetStats();
+    BOOST_CHECK_EQUAL( c.lock.stats().acquisitions, 0 );
+#  else
+    BOOST_CHECK_EQUAL( s.acquisitions, 0 );
+#  endif
+  }
+}
+
+BOOST_AUTO_TEST_CASE( SyncRWLock_contention ) {
+  const int n = 4;
+  pthread_t threads[n];
+  Shared s;
+
+  pthread_create( threads, NULL, &writer, &s );
+  for ( int i = 1; i < n; ++i )
+    pthread_create( threads + i, NULL, &reader, &s );
+  for ( int i = 0; i < n; ++i )
+    pthread_join( threads[i], NULL );
+
+  BOOST_CHECK_EQUAL( s.torn, false );
+  BOOST_CHECK_EQUAL( s.a, 20000 );
+#  if defined(SYNCLOCK_STATS)
+  BOOST_CHECK_EQUAL( s.lock.stats().acquisitions, n * 20000 );
+#  endif
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END();
 
@@ -29,13 +29,46 @@
 #define BOOST_TEST_MODULE  Vector
 
 #include <olson-tools/Vector.h>
+#include <olson-tools/SquareMatrix.h>
+#include <olson-tools/Timer.h>
 
 #include <boost/test/unit_test.hpp>
 
+#include <vector>
+#include <memory>
+#include <cstdlib>
+
 namespace {
   using olson_tools::Vector;
+  using olson_tools::SquareMatrix;
   using olson_tools::V3;
   using olson_tools::make_vector;
+
+  /** Allocator whose storage is 16 byte aligned but never 32 byte aligned
+   * (as std::allocator is allowed to return). */
+  template < typename T >
+  struct misaligned_allocator : std::allocator<T> {
+    template < typename U > struct rebind {
+      typedef misaligned_allocator<U> other;
+    };
+
+    misaligned_allocator() {}
+    template < typename U >
+    misaligned_allocator(const misaligned_allocator<U> &) {}
+
+    T * allocate(std::size_t n, const void * = 0) {
+      char * p = static_cast<char*>(std::malloc(n * sizeof(T) + 64u));
+      char * q = p + 16u;
+      while ((reinterpret_cast<std::size_t>(q) % 32u) != 16u)
+        q += 16u;
+      reinterpret_cast<char**>(q)[-1] = p;
+      return reinterpret_cast<T*>(q);
+    }
+
+    void deallocate(T * q, std::size_t) {
+      std::free(reinterpret_cast<char**>(q)[-1]);
+    }
+  };
 }
 
 BOOST_AUTO_TEST_SUITE( Vector_testsuite );
@@ -160,6 +193,129 @@ BOOST_AUTO_TEST_SUITE( Vector_testsuite );
     BOOST_CHECK_EQUAL( v2 == v3, true );
   }
 
+  BOOST_AUTO_TEST_CASE( V_math ) {
+    Vector<double,3> v1 = V3(1., 2., 3.),
+                     v2 = V3(9., 8., 7.);
+
+    BOOST_CHECK_EQUAL( v1 + v2, V3(10., 10., 10.) );
+    BOOST_CHECK_EQUAL( v2 - v1, V3(8., 6., 4.) );
+    BOOST_CHECK_EQUAL( v1 * 2., V3(2., 4., 6.) );
+    BOOST_CHECK_EQUAL( v1 / 2., V3(.5, 1., 1.5) );
+    BOOST_CHECK_EQUAL( olson_tools::cross(v1, v2), V3(-10., 20., -10.) );
+    BOOST_CHECK_CLOSE( V3(3., 4., 12.).abs(), 13., 1e-12 );
+
+    Vector<double,3> v3 = v1;
+    v3 += v2;
+    v3 -= 1.;
+    v3 *= 2.;
+    BOOST_CHECK_EQUAL( v3, V3(18., 18., 18.) );
+    v3.addFraction(.5, v1);
+    BOOST_CHECK_EQUAL( v3, V3(18.5, 19., 19.5) );
+
+    Vector<double,4> v4 = make_vector<double,4u>()(1., 2., 3., 4.);
+    BOOST_CHECK_EQUAL( v4 * v4, 30. );
+    BOOST_CHECK_EQUAL( v4 + v4, v4 * 2. );
+  }
+
+  BOOST_AUTO_TEST_CASE( V_cast_array ) {
+    /* Vectors that are cast onto plain arrays must never touch the element
+     * following the third. */
+    double a[4] = { 1., 2., 3., 42. };
+    Vector<double,3> & v = V3C(a);
+    v += V3(1., 1., 1.);
+    v = v * 2.;
+    v.zero();
+    BOOST_CHECK_EQUAL( a[3], 42. );
+    BOOST_CHECK_EQUAL( v * V3(1., 1., 1.), 0. );
+  }
+
+  BOOST_AUTO_TEST_CASE( V_in_std_vector ) {
+    /* std::allocator only promises 16 byte alignment, so copying Vectors held
+     * in a std::vector must not assume 32 byte alignment of val.
+     * misaligned_allocator makes sure that the storage is not 32 byte aligned
+     * by chance. */
+    typedef Vector<double,4> V4D;
+    typedef Vector<double,3> V3D;
+    typedef std::vector< V4D, misaligned_allocator<V4D> > V4Vec;
+    typedef std::vector< V3D, misaligned_allocator<V3D> > V3Vec;
+    const V4D one4(1.0), last4 = make_vector<double,4u>()(1., 2., 3., 4.);
+    const V3D one3(1.0), last3 = V3(1., 2., 3.);
+
+    V4Vec v4(1000, V4D(1.0));
+    v4.push_back(last4);
+    V4Vec c4(v4);
+    c4[0] = c4.back();
+    BOOST_CHECK_EQUAL( c4.size(), 1001u );
+    BOOST_CHECK_EQUAL( c4[500], one4 );
+    BOOST_CHECK_EQUAL( c4[0], last4 );
+
+    V3Vec v3(1000, V3D(1.0));
+    v3.push_back(last3);
+    V3Vec c3(v3);
+    c3[0] = c3.back();
+    BOOST_CHECK_EQUAL( c3.size(), 1001u );
+    BOOST_CHECK_EQUAL( c3[500], one3 );
+    BOOST_CHECK_EQUAL( c3[0], last3 );
+  }
+
+  BOOST_AUTO_TEST_CASE( M_times_V ) {
+    const double m_[3][3] = {{ 1., 2., 3.},
+                             { 4., 5., 6.},
+                             { 7., 8., 9.}};
+    SquareMatrix<double,3> m(m_);
+    BOOST_CHECK_EQUAL( m * V3(1., 0., -1.), V3(-2., -2., -2.) );
+    BOOST_CHECK_EQUAL( m.row(1) * V3(1., 1., 1.), 15. );
+  }
+
+  /** Simple timing of the common Vector<double,3> operations.  Compare the
+   * output of the Vector and Vector_simd tests to see the effect of
+   * USE_SIMD_VECTOR. */
+  BOOST_AUTO_TEST_CASE( V_timing ) {
+    const int N = 1000;
+    const int N_outer = 2000;
+    std::vector< Vector<double,3> > x(N, V3(1., 2., 3.)), v(N, V3(.1, .2, .3));
+    SquareMatrix<double,3> R = SquareMatrix<double,3>::identity();
+    olson_tools::Timer t_add, t_dot, t_cross, t_matrix;
+    double sum = 0;
+
+    t_add.start();
+    for (int j = 0; j < N_outer; ++j)
+      for (int i = 0; i < N; ++i)
+        x[i] = x[i] + v[i] * 1e-3;
+    t_add.stop();
+
+    t_dot.start();
+    for (int j = 0; j < N_outer; ++j)
+      for (int i = 0; i < N; ++i)
+        sum += x[i] * v[i];
+    t_dot.stop();
+
+    t_cross.start();
+    for (int j = 0; j < N_outer; ++j)
+      for (int i = 0; i < N; ++i)
+        v[i] = olson_tools::cross(x[i], v[i]) * 1e-3;
+    t_cross.stop();
+
+    t_matrix.start();
+    for (int j = 0; j < N_outer; ++j)
+      for (int i = 0; i < N; ++i)
+        x[i] = R * x[i];
+    t_matrix.stop();
+
+    BOOST_TEST_MESSAGE( "Vector<double,3> timings ("
+#if defined(USE_SIMD_VECTOR)
+                        "USE_SIMD_VECTOR"
+#else
+                        "generic"
+#endif
+                        ") [wall, cpu]:\n"
+                        "  x + v*s:  " << t_add    << "\n"
+                        "  x * v:    " << t_dot    << "\n"
+                        "  x X v:    " << t_cross  << "\n"
+                        "  R * x:    " << t_matrix << "\n"
+                        "  (" << sum << ")" );
+    BOOST_CHECK( sum > 0 );
+  }
 
 BOOST_AUTO_TEST_SUITE_END();
 
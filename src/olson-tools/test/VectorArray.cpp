@@ -0,0 +1,130 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 1998-2008 Spencer Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  VectorArray
+
+#include <olson-tools/VectorArray.h>
+#include <olson-tools/nsort/NSort.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+  using olson_tools::Vector;
+  using olson_tools::VectorArray;
+  using olson_tools::V3;
+
+  /** Sort map that splits the Vectors according to the sign of x. */
+  struct x_sign {
+    template < typename V >
+    int operator() ( const V & v ) const {
+      return v[0] >= 0.0;
+    }
+  };
+}
+
+BOOST_AUTO_TEST_SUITE( VectorArray_testsuite );
+
+  BOOST_AUTO_TEST_CASE( layout ) {
+    VectorArray<double,3> a(10, V3(1., 2., 3.));
+    BOOST_CHECK_EQUAL( a.size(), 10u );
+
+    for (unsigned int j = 0; j < 3; ++j) {
+      /* each component array must be aligned. */
+      BOOST_CHECK_EQUAL( reinterpret_cast<size_t>(a.component(j)) % a.alignment, 0u );
+      for (unsigned int i = 0; i < a.size(); ++i)
+        BOOST_CHECK_EQUAL( a.component(j)[i], j + 1. );
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE( proxy_reference ) {
+    VectorArray<double,3> a(2, 0.0);
+    a[1] = V3(1., 2., 3.);
+    a[1] += V3(1., 1., 1.);
+    a[1] *= 2.;
+    a[0][2] = 5.;
+
+    Vector<double,3> v = a[1];
+    BOOST_CHECK_EQUAL( v, V3(4., 6., 8.) );
+    BOOST_CHECK_EQUAL( a[1] * V3(1., 0., 0.), 4. );
+    BOOST_CHECK_EQUAL( a[1] - V3(4., 6., 8.), V3(0., 0., 0.) );
+    BOOST_CHECK_EQUAL( a.component(2)[0], 5. );
+
+    a[0] = a[1];
+    BOOST_CHECK_EQUAL( a[0].get(), V3(4., 6., 8.) );
+
+    const VectorArray<double,3> & ca = a;
+    BOOST_CHECK_EQUAL( ca[0][1], 6. );
+  }
+
+  BOOST_AUTO_TEST_CASE( aos_conversion ) {
+    std::vector< Vector<double,3> > aos;
+    for (int i = 0; i < 1000; ++i)
+      aos.push_back( V3(double(i), 2.*i, 3.*i) );
+
+    VectorArray<double,3> a(aos.begin(), aos.end());
+    BOOST_CHECK_EQUAL( a.size(), aos.size() );
+    BOOST_CHECK_EQUAL( a.component(1)[999], 2.*999 );
+
+    std::vector< Vector<double,3> > back(aos.size(), 0.0);
+    a.copy_to(back.begin());
+    for (unsigned int i = 0; i < aos.size(); ++i)
+      BOOST_CHECK_EQUAL( back[i], aos[i] );
+
+    a.push_back( V3(-1., -2., -3.) );
+    BOOST_CHECK_EQUAL( a.size(), 1001u );
+    BOOST_CHECK_EQUAL( a[1000].get(), V3(-1., -2., -3.) );
+    BOOST_CHECK_EQUAL( a[999].get(), aos[999] );
+  }
+
+  BOOST_AUTO_TEST_CASE( nsort ) {
+    const int len = 10;
+    double x[len] = {1, -2, 3, -1, 2, -3, 0, 1, -2, 4};
+    VectorArray<double,3> a;
+    for (int i = 0; i < len; ++i)
+      a.push_back( V3(x[i], double(i), -x[i]) );
+
+    olson_tools::nsort::NSort<x_sign> s(2);
+    s.sort(a.begin(), a.end());
+
+    BOOST_CHECK_EQUAL( s.size(0), 4 );
+    BOOST_CHECK_EQUAL( s.size(1), 6 );
+    for (int i = 0; i < len; ++i) {
+      BOOST_CHECK_EQUAL( a[i][0] >= 0.0, i >= s.begin(1) );
+      /* the components must have been moved together. */
+      BOOST_CHECK_EQUAL( a[i][2], -a[i][0] );
+      BOOST_CHECK_EQUAL( a[i][0], x[int(a[i][1])] );
+    }
+
+    std::iter_swap( a.begin(), a.begin() + 1 );
+    BOOST_CHECK_EQUAL( a[0][2], -a[0][0] );
+  }
+
+BOOST_AUTO_TEST_SUITE_END();
+
@@ -0,0 +1,399 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  field_lookup
+
+#include <olson-tools/force-lookup.h>
+#include <olson-tools/VectorArray.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+  using namespace olson_tools;
+  typedef ForceRecord<3> Record;
+
+  const double tol = 1e-12;
+
+  inline Vector<double,3> V3( const double & x, const double & y,
+                              const double & z ) {
+    Vector<double,3> v;
+    v[X] = x; v[Y] = y; v[Z] = z;
+    return v;
+  }
+
+  /** Check that two vectors agree to within tol. */
+  void check_close( const Vector<double,3> & a, const Vector<double,3> & b ) {
+    for ( unsigned int j = 0; j < 3u; ++j )
+      BOOST_CHECK_SMALL( a[j] - b[j], tol );
+  }
+
+  /** Fill every record of both tables of a lookup with an analytic field
+   * evaluated at the grid points.  The grid points are offset + min +
+   * k*dx, where min and max are given in the frame of the table. */
+  template < typename Lookup, typename Field >
+  void fill( Lookup & lookup,
+             const Vector<double,3> & r0,
+             const Vector<double,3> & offset,
+             const Vector<double,3> & core_dx,
+             const Vector<double,3> & core_min,
+             const Vector<double,3> & core_max,
+             const Vector<double,3> & shell_dx,
+             const Vector<double,3> & shell_min,
+             const Vector<double,3> & shell_max,
+             const Field & field ) {
+    lookup.initialize( r0, core_dx, core_min, core_max,
+                       shell_dx, shell_min, shell_max );
+
+    for ( int t = 0; t < 2; ++t ) {
+      typename Lookup::super::DSECT table =
+        t ? Lookup::super::SHELL : Lookup::super::CORE;
+      const Vector<double,3> & dx  = t ? shell_dx  : core_dx;
+      const Vector<double,3> & min = t ? shell_min : core_min;
+      const Vector<double,3> & max = t ? shell_max : core_max;
+      const int nx = int( round((max[X] - min[X]) / dx[X]) );
+      const int ny = int( round((max[Y] - min[Y]) / dx[Y]) );
+      const int nz = int( round((max[Z] - min[Z]) / dx[Z]) );
+
+      for ( int i = 0; i <= nx; ++i )
+        for ( int j = 0; j <= ny; ++j )
+          for ( int k = 0; k <= nz; ++k ) {
+            Vector<double,3> r = offset + min
+                               + V3( i*dx[X], j*dx[Y], k*dx[Z] );
+            Record & rec = lookup.getRecord( r, table );
+            rec.a = field.vector( r );
+            rec.V = field.scalar( r );
+          }
+    }
+  }
+
+  /** An arbitrary smooth field in the (rho, _, z) plane of an axially
+   * symmetric table centered at c. */
+  struct AxiSymField {
+    Vector<double,3> c;
+    explicit AxiSymField( const Vector<double,3> & c ) : c(c) { }
+
+    Vector<double,3> vector( const Vector<double,3> & r_ ) const {
+      Vector<double,3> r = r_ - c;
+      return V3( r[X]*(1.0 + r[Z]), 0.5 - r[Z]*r[Z], r[X] + 2.0*r[Z] );
+    }
+
+    double scalar( const Vector<double,3> & r_ ) const {
+      Vector<double,3> r = r_ - c;
+      return 1.0 + r[X]*r[X] - r[Z];
+    }
+  };
+
+  typedef AxiSymFieldLookup<Record> AxiSym;
+
+  void fill( AxiSym & lookup ) {
+    const Vector<double,3> r0 = V3(0.1, -0.2, 0.3);
+    fill( lookup, r0, r0,
+          V3(0.125, 1.0, 0.125), V3(0.0, 0.0, -1.0), V3(1.0, 0.0, 1.0),
+          V3(0.5,   1.0, 0.5),   V3(0.0, 0.0, -3.0), V3(3.0, 0.0, 3.0),
+          AxiSymField(r0) );
+  }
+
+  /** A polar vector field (and an even scalar) that is mirror symmetric
+   * about each of the planes through c. */
+  struct PolarField {
+    Vector<double,3> c;
+    explicit PolarField( const Vector<double,3> & c ) : c(c) { }
+
+    Vector<double,3> vector( const Vector<double,3> & r_ ) const {
+      Vector<double,3> r = r_ - c;
+      return V3( r[X] * (1.0 + r[Y]*r[Y] + r[Z]*r[Z]),
+                 r[Y] * (1.0 + r[X]*r[X]),
+                 r[Z] * (2.0 + r[X]*r[X] + r[Y]*r[Y]) );
+    }
+
+    double scalar( const Vector<double,3> & r_ ) const {
+      Vector<double,3> r = r_ - c;
+      return 1.0 + r[X]*r[X] + r[Y]*r[Y]*r[Z]*r[Z];
+    }
+  };
+
+  /** An axial vector field (such as that of a coil pair) that is mirror
+   * symmetric about the z-plane through c. */
+  struct AxialField {
+    Vector<double,3> c;
+    explicit AxialField( const Vector<double,3> & c ) : c(c) { }
+
+    Vector<double,3> vector( const Vector<double,3> & r_ ) const {
+      Vector<double,3> r = r_ - c;
+      return V3( r[X]*r[Z], r[Y]*r[Z]*(1.0 + r[X]),
+                 1.0 + r[X]*r[X] + r[Z]*r[Z] );
+    }
+
+    double scalar( const Vector<double,3> & r_ ) const {
+      Vector<double,3> r = r_ - c;
+      return 1.0 + r[X] + r[Z]*r[Z];
+    }
+  };
+
+  /** Fill a full (symmetry::None) table and a table folded by Symmetry with
+   * the same field and check that lookups agree in every mirrored region,
+   * on the mirror planes and around the core/shell boundaries.  The full
+   * table is centered on the mirror point c:  core c+-1, shell c+-3. */
+  template < typename Symmetry, typename Field >
+  void check_folded( const unsigned int & planes,
+                     const Vector<double,3> & c,
+                     const Field & field ) {
+    const Vector<double,3> core_dx  = V3(0.25, 0.25, 0.25);
+    const Vector<double,3> shell_dx = V3(0.5, 0.5, 0.5);
+    const Vector<double,3> one   = V3(1.0, 1.0, 1.0);
+    const Vector<double,3> three = V3(3.0, 3.0, 3.0);
+
+    FieldLookup<Record> full;
+    fill( full, c, V3(0,0,0),
+          core_dx,  c - one,   c + one,
+          shell_dx, c - three, c + three, field );
+
+    /* the folded table starts at the mirror planes. */
+    Vector<double,3> core_min = c - one, shell_min = c - three;
+    for ( unsigned int j = 0; j < 3u; ++j )
+      if ( planes & (1u<<j) )
+        core_min[j] = shell_min[j] = c[j];
+
+    FieldLookup<Record, Symmetry> folded;
+    fill( folded, c, V3(0,0,0),
+          core_dx,  core_min,  c + one,
+          shell_dx, shell_min, c + three, field );
+
+    /* in each region, on the planes (0), on the core boundary (+-1) and
+     * just into the shell (+-1.1, +-2.9). */
+    const double u[] = { -2.9, -1.1, -1.0, -0.6, -0.3, 0.0,
+                          0.3,  0.6,  1.0,  1.1,  2.9 };
+    const unsigned int nu = sizeof(u)/sizeof(u[0]);
+
+    for ( unsigned int i = 0; i < nu; ++i )
+      for ( unsigned int j = 0; j < nu; ++j )
+        for ( unsigned int k = 0; k < nu; ++k ) {
+          const Vector<double,3> r = c + V3( u[i], u[j], u[k] );
+
+          /* The lower edge of the full table (-1) is a grid point, while its
+           * mirror image at the upper edge of the folded table is clamped
+           * just inside the table (see getindx):  they differ by 0.1% of a
+           * grid step. */
+          const bool edge = ( (planes & (1u<<X)) && u[i] == -1.0 ) ||
+                            ( (planes & (1u<<Y)) && u[j] == -1.0 ) ||
+                            ( (planes & (1u<<Z)) && u[k] == -1.0 );
+          const double t = edge ? 1e-2 : tol;
+
+          Vector<double,3> vf, vs;
+          full.vector_lookup( vf, r, 0u );
+          folded.vector_lookup( vs, r, 0u );
+          for ( unsigned int m = 0; m < 3u; ++m )
+            BOOST_CHECK_SMALL( vs[m] - vf[m], t );
+          BOOST_CHECK_SMALL( folded.scalar_lookup( r, 0u )
+                           - full.scalar_lookup( r, 0u ), t );
+        }
+  }
+
+  /** Write the header of a table file (core and shell of 2x2x2 points; the
+   * records themselves are left out and read as defaults). */
+  void write_header( const std::string & filename,
+                     const Vector<double,3> & core_min,
+                     const Vector<double,3> & shell_min ) {
+    const Vector<double,3> one = V3(1.0, 1.0, 1.0);
+    const Vector<int,3> N = Vector<int,3>(2);
+    std::ofstream out(filename.c_str());
+    out << "# center \n"
+           "# " << core_min << "\n"
+           "# CORE : \n"
+           "# " << N << ' ' << one << ' '
+                << core_min << ' ' << (core_min + one) << "\n"
+           "# SHELL : \n"
+           "# " << N << ' ' << one << ' '
+                << shell_min << ' ' << (shell_min + one) << "\n"
+           "# \n"
+           "# \n";
+  }
+
+  /** A set of positions that covers the core and shell tables. */
+  VectorArray<double,3> positions( const std::size_t & n ) {
+    VectorArray<double,3> r(n);
+    for ( std::size_t k = 0; k < n; ++k ) {
+      const double s = double(k) / n;
+      r[k] = V3( 2.5 * std::sin(7.0 * s) + 0.1,
+                 1.7 * std::cos(11.0 * s) - 0.2,
+                 2.9 * std::sin(3.0 * s + 1.0) + 0.3 );
+    }
+    return r;
+  }
+
+  /** (rho,z) computed with the general rotation-matrix formula. */
+  void general_coords( const AxiSym & lookup, const Vector<double,3> & r,
+                       const Vector<double,3> & r0,
+                       double & rho, double & z ) {
+    Vector<double,3> rr = lookup.getR() * (r - r0);
+    rho = std::sqrt( rr[X]*rr[X] + rr[Y]*rr[Y] );
+    z = rr[Z];
+  }
+
+  /** Check the scalar and batched coordinates and lookups of lookup (with
+   * its current R) against the general rotation-matrix path. */
+  void check_against_general( AxiSym & lookup ) {
+    const Vector<double,3> r0 = V3(0.1, -0.2, 0.3);
+    VectorArray<double,3> r = positions(37);
+
+    std::vector<double> rho(r.size()), z(r.size());
+    lookup.getRotatedRelativeCoords( r, &rho[0], &z[0] );
+
+    for ( std::size_t k = 0; k < r.size(); ++k ) {
+      double grho, gz, srho, sz;
+      general_coords( lookup, r[k], r0, grho, gz );
+      lookup.getRotatedRelativeCoords( r[k], srho, sz );
+      BOOST_CHECK_SMALL( srho - grho, tol );
+      BOOST_CHECK_SMALL( sz - gz, tol );
+      BOOST_CHECK_SMALL( rho[k] - grho, tol );
+      BOOST_CHECK_SMALL( z[k] - gz, tol );
+    }
+
+    /* the same for an arbitrary sub-range (unaligned first element). */
+    lookup.getRotatedRelativeCoords( r, 3, 11, &rho[0], &z[0] );
+    for ( std::size_t k = 0; k < 11; ++k ) {
+      double grho, gz;
+      general_coords( lookup, r[3 + k], r0, grho, gz );
+      BOOST_CHECK_SMALL( rho[k] - grho, tol );
+      BOOST_CHECK_SMALL( z[k] - gz, tol );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( field_lookup );
+
+BOOST_AUTO_TEST_CASE( axisym_rotation_types ) {
+  AxiSym lookup;
+  fill( lookup );
+
+  /* identity (the default). */
+  check_against_general( lookup );
+
+  /* axis-aligned rotations from rotateField. */
+  const Vector<double,3> axes[] = {
+    V3( 1, 0, 0), V3(-1, 0, 0), V3(0,  1, 0),
+    V3( 0,-1, 0), V3( 0, 0,-1), V3(0,  0, 1)
+  };
+  for ( unsigned int a = 0; a < sizeof(axes)/sizeof(axes[0]); ++a ) {
+    lookup.rotateField( axes[a] );
+    check_against_general( lookup );
+  }
+
+  /* a signed permutation set directly. */
+  SquareMatrix<double,3> R;
+  R.zero();
+  R.val[X][Z] = 1.0;
+  R.val[Y][X] = -1.0;
+  R.val[Z][Y] = -1.0;
+  lookup.setR( R );
+  check_against_general( lookup );
+
+  /* almost, but not quite, a permutation (must take the general path). */
+  R.val[Z][X] = 1e-3;
+  lookup.setR( R );
+  check_against_general( lookup );
+
+  /* back to the identity (must not keep the previous general path). */
+  lookup.setR( SquareMatrix<double,3>::identity() );
+  check_against_general( lookup );
+
+  /* a general rotation. */
+  lookup.rotateField( V3(0.48, -0.6, 0.64) );
+  check_against_general( lookup );
+}
+
+BOOST_AUTO_TEST_CASE( axisym_batched_lookups ) {
+  AxiSym lookup;
+  fill( lookup );
+
+  /* (lengths that are not multiples of the SIMD width or of the block) */
+  const std::size_t sizes[] = { 1, 3, 37, 301 };
+  const Vector<double,3> rotations[] = {
+    V3(0, 0, 1), V3(1, 0, 0), V3(0.48, -0.6, 0.64)
+  };
+
+  for ( unsigned int rot = 0; rot < 3u; ++rot ) {
+    lookup.rotateField( rotations[rot] );
+    for ( unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s ) {
+      VectorArray<double,3> r = positions( sizes[s] );
+      VectorArray<double,3> v;
+      std::vector<double> V( r.size() );
+      lookup.vector_lookup( v, r, 0u );
+      lookup.scalar_lookup( &V[0], r, 0u );
+
+      BOOST_REQUIRE_EQUAL( v.size(), r.size() );
+      for ( std::size_t k = 0; k < r.size(); ++k ) {
+        Vector<double,3> single;
+        lookup.vector_lookup( single, r[k], 0u );
+        check_close( v[k], single );
+        BOOST_CHECK_SMALL( V[k] - lookup.scalar_lookup( r[k], 0u ), tol );
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( mirror_all_planes ) {
+  const Vector<double,3> c = V3(0,0,0);
+  check_folded< symmetry::Mirror< (1u<<X)|(1u<<Y)|(1u<<Z) > >(
+    (1u<<X)|(1u<<Y)|(1u<<Z), c, PolarField(c) );
+}
+
+BOOST_AUTO_TEST_CASE( mirror_offset_plane ) {
+  const Vector<double,3> c = V3(0.0, 0.0, 0.5);
+  check_folded< symmetry::Mirror< (1u<<Z) > >( (1u<<Z), c, PolarField(c) );
+}
+
+BOOST_AUTO_TEST_CASE( axial_mirror ) {
+  const Vector<double,3> c = V3(0.0, 0.0, 0.5);
+  check_folded< symmetry::AxialMirror< (1u<<Z) > >(
+    (1u<<Z), c, AxialField(c) );
+}
+
+BOOST_AUTO_TEST_CASE( mirror_shell_plane ) {
+  /* the shell table of a mirrored table must start at the mirror plane. */
+  typedef FieldLookup< Record, symmetry::Mirror< (1u<<Z) > > Folded;
+  const std::string filename = "field-lookup-mirror.tmp";
+
+  write_header( filename, V3(0.0, 0.0, 0.5), V3(-1.0, -1.0, 0.5) );
+  BOOST_CHECK_NO_THROW( Folded lookup(filename) );
+
+  write_header( filename, V3(0.0, 0.0, 0.5), V3(-1.0, -1.0, -1.0) );
+  BOOST_CHECK_THROW( Folded lookup(filename), std::runtime_error );
+  /* (without the symmetry, the same table is fine) */
+  BOOST_CHECK_NO_THROW( FieldLookup<Record> lookup(filename) );
+
+  std::remove( filename.c_str() );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
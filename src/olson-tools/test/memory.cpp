@@ -0,0 +1,164 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  memory
+
+#include <olson-tools/memory.h>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+namespace {
+  class Chunk {
+    REDEF_NEW_DEL_H(Chunk);
+  public:
+    int value[8];
+  };
+
+  /** Allocates and frees in rounds of n. */
+  struct Churn {
+    int n, rounds;
+    long sum;
+
+    Churn( const int & n, const int & rounds )
+      : n(n), rounds(rounds), sum(0) { }
+
+    void operator() () {
+      std::vector<Chunk *> v(n);
+      for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < n; ++i) {
+          v[i] = new Chunk;
+          v[i]->value[0] = i;
+        }
+        for (int i = 0; i < n; ++i) {
+          sum += v[i]->value[0];
+          delete v[i];
+        }
+      }
+    }
+
+#if defined(USE_PTHREAD)
+    static void * run( void * arg ) {
+      (*static_cast<Churn*>(arg))();
+      return NULL;
+    }
+#endif
+  };
+
+#if defined(USE_PTHREAD)
+  /** Only frees (the chunks that another thread allocated). */
+  void * delete_all( void * arg ) {
+    std::vector<Chunk *> & v = *static_cast< std::vector<Chunk *> * >(arg);
+    for (unsigned int i = 0; i < v.size(); ++i)
+      delete v[i];
+    return NULL;
+  }
+#endif
+}
+
+REDEF_NEW_DEL_C(Chunk, 1000);
+
+BOOST_AUTO_TEST_SUITE( memory_tests );
+
+BOOST_AUTO_TEST_CASE( reuse ) {
+  Chunk::freetoheap();
+  olson_tools::FreeListStats s0 = Chunk::freeliststats();
+
+  const int n = 500, rounds = 10;
+  Churn c(n, rounds);
+  c();
+  BOOST_CHECK_EQUAL( c.sum, long(rounds) * n * (n - 1) / 2 );
+
+  olson_tools::FreeListStats s = Chunk::freeliststats();
+  const long allocs = long(n) * rounds;
+  BOOST_CHECK_EQUAL( (s.hits - s0.hits) + (s.misses - s0.misses), allocs );
+  /* only the first round comes from the heap. */
+  BOOST_CHECK_EQUAL( s.heap_allocs - s0.heap_allocs, long(n) );
+  BOOST_CHECK( s.hits - s0.hits > allocs / 2 );
+  BOOST_CHECK( s.high_water > 0 );
+  BOOST_CHECK( s.high_water <= 1000 );
+  BOOST_CHECK_EQUAL( s.heap_frees, s0.heap_frees );
+}
+
+BOOST_AUTO_TEST_CASE( limit ) {
+  /* with a limit of 0 everything beyond the magazine goes to the heap. */
+  Chunk::freetoheap(0);
+  olson_tools::FreeListStats s0 = Chunk::freeliststats();
+  BOOST_CHECK_EQUAL( s0.freelistsz, 0 );
+
+  Churn c(300, 2);
+  c();
+  olson_tools::FreeListStats s = Chunk::freeliststats();
+  BOOST_CHECK_EQUAL( s.freelistsz, 0 );
+  BOOST_CHECK( s.heap_frees > s0.heap_frees );
+  BOOST_CHECK( s.heap_allocs - s0.heap_allocs > 300 );
+
+  Chunk::freetoheap();
+  BOOST_CHECK_EQUAL( Chunk::freeliststats().freelistsz, 0 );
+}
+
+#if defined(USE_PTHREAD)
+BOOST_AUTO_TEST_CASE( threads ) {
+  Chunk::freetoheap();
+  olson_tools::FreeListStats s0 = Chunk::freeliststats();
+  const int nt = 4, n = 200, rounds = 50;
+  std::vector<Churn> c(nt, Churn(n, rounds));
+  std::vector<pthread_t> th(nt);
+  for (int t = 0; t < nt; ++t)
+    pthread_create(&th[t], NULL, &Churn::run, &c[t]);
+  for (int t = 0; t < nt; ++t) {
+    pthread_join(th[t], NULL);
+    BOOST_CHECK_EQUAL( c[t].sum, long(rounds) * n * (n - 1) / 2 );
+  }
+
+  /* the magazines of the exited threads were returned. */
+  olson_tools::FreeListStats s = Chunk::freeliststats();
+  BOOST_CHECK_EQUAL( s.freelistsz + (s.heap_frees - s0.heap_frees),
+                     s.heap_allocs - s0.heap_allocs );
+  BOOST_CHECK( s.freelistsz <= 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( delete_only_thread ) {
+  /* a thread that never allocates must still return its magazine. */
+  Chunk::freetoheap();
+  olson_tools::FreeListStats s0 = Chunk::freeliststats();
+  std::vector<Chunk *> v(301);
+  for (unsigned int i = 0; i < v.size(); ++i)
+    v[i] = new Chunk;
+
+  pthread_t th;
+  pthread_create(&th, NULL, &delete_all, &v);
+  pthread_join(th, NULL);
+
+  olson_tools::FreeListStats s = Chunk::freeliststats();
+  BOOST_CHECK_EQUAL( s.heap_frees, s0.heap_frees );
+  BOOST_CHECK_EQUAL( s.freelistsz, static_cast<int>(v.size()) );
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END();
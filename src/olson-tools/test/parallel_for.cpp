@@ -0,0 +1,163 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  parallel_for
+
+#include <olson-tools/parallel_for.h>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+namespace {
+
+  /** Counts how many times each index is visited. */
+  struct Count {
+    int * count;
+    Count( int * count ) : count(count) { }
+    void operator() ( const int & b, const int & e ) const {
+      for (int i = b; i < e; ++i)
+        __atomic_add_fetch( count + i, 1, __ATOMIC_RELAXED );
+    }
+  };
+
+  /** A parallel_for inside of each piece of a parallel_for. */
+  struct Nested {
+    int * count;
+    int n_inner;
+    Nested( int * count, const int & n_inner )
+      : count(count), n_inner(n_inner) { }
+    void operator() ( const int & b, const int & e ) const {
+      for (int i = b; i < e; ++i)
+        olson_tools::parallel_for( 0, n_inner, 3, Count(count + i*n_inner) );
+    }
+  };
+
+  struct Sum {
+    double operator() ( const int & b, const int & e,
+                        const double & init ) const {
+      double s = init;
+      for (int i = b; i < e; ++i)
+        s += 1.0 / (1.0 + i);
+      return s;
+    }
+  };
+
+  struct Plus {
+    double operator() ( const double & l, const double & r ) const {
+      return l + r;
+    }
+  };
+
+  /** The reduction over the same tree, computed directly. */
+  double tree_sum( const int & b, const int & e, const int & grain ) {
+    if ( e - b <= grain )
+      return Sum()(b, e, 0.0);
+    const int m = b + (e - b) / 2;
+    double left = tree_sum(b, m, grain);
+    return left + tree_sum(m, e, grain);
+  }
+
+#if defined(USE_PTHREAD)
+  void set_threads( const int & n ) {
+    olson_tools::pthreadCache.set_max_threads(n);
+  }
+#elif defined(_OPENMP)
+  void set_threads( const int & n ) {
+    omp_set_num_threads(n);
+  }
+#else
+  void set_threads( const int & /*n*/ ) { }
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE( parallel_for_tests );
+
+BOOST_AUTO_TEST_CASE( each_once ) {
+  const int threads[] = {1, 4};
+  for (int t = 0; t < 2; ++t) {
+    set_threads(threads[t]);
+    const int n = 100003;
+    const int grains[] = {0, 1, 17, n};
+    for (int g = 0; g < 4; ++g) {
+      std::vector<int> count(n, 0);
+      olson_tools::parallel_for( 0, n, grains[g], Count(&count[0]) );
+      int wrong = 0;
+      for (int i = 0; i < n; ++i)
+        wrong += count[i] != 1;
+      BOOST_CHECK_EQUAL( wrong, 0 );
+    }
+  }
+
+  /* an empty range is a no-op. */
+  olson_tools::parallel_for( 5, 5, 1, Count(NULL) );
+  olson_tools::parallel_for( 5, 2, 1, Count(NULL) );
+}
+
+BOOST_AUTO_TEST_CASE( nested ) {
+  set_threads(4);
+  const int n_outer = 50, n_inner = 200;
+  std::vector<int> count(n_outer * n_inner, 0);
+  olson_tools::parallel_for( 0, n_outer, 1, Nested(&count[0], n_inner) );
+  int wrong = 0;
+  for (unsigned int i = 0; i < count.size(); ++i)
+    wrong += count[i] != 1;
+  BOOST_CHECK_EQUAL( wrong, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( reduce ) {
+  const int n = 100000, grain = 1000;
+  const double expected = tree_sum(0, n, grain);
+  const int threads[] = {1, 4};
+  for (int t = 0; t < 2; ++t) {
+    set_threads(threads[t]);
+    /* the same splits give the same rounding. */
+    for (int rep = 0; rep < 5; ++rep)
+      BOOST_CHECK_EQUAL(
+        olson_tools::parallel_reduce( 0, n, grain, 0.0, Sum(), Plus() ),
+        expected );
+  }
+
+  BOOST_CHECK_EQUAL(
+    olson_tools::parallel_reduce( 3, 3, grain, 2.0, Sum(), Plus() ), 2.0 );
+}
+
+#if defined(USE_PTHREAD)
+BOOST_AUTO_TEST_CASE( cache ) {
+  olson_tools::PThreadCache cache;
+  cache.set_max_threads(3);
+  const int n = 10000;
+  std::vector<int> count(n, 0);
+  olson_tools::parallel_for( 0, n, 10, Count(&count[0]), cache );
+  int wrong = 0;
+  for (int i = 0; i < n; ++i)
+    wrong += count[i] != 1;
+  BOOST_CHECK_EQUAL( wrong, 0 );
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,147 @@
+/*@HEADER
+ *         olson-tools:  A variety of routines and algorithms that
+ *      I've developed and collected over the past few years.  This collection
+ *      represents tools that are most useful for scientific and numerical
+ *      software.  This software is released under the LGPL license except
+ *      otherwise explicitly stated in individual files included in this
+ *      package.  Generally, the files in this package are copyrighted by
+ *      Spencer Olson--exceptions will be noted.   
+ *                 Copyright 2006-2009 Spencer E. Olson
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *  
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *                                                                                 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA.                                                                           .
+ * 
+ * Questions? Contact Spencer Olson (olsonse@umich.edu) 
+ */
+
+#define BOOST_TEST_MODULE  random
+
+#include <olson-tools/random/random.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#if defined(USE_PTHREAD)
+#  include <pthread.h>
+#endif
+
+namespace {
+  using namespace olson_tools::random;
+
+  const int n_draws = 1000;
+
+  /** Draw n_draws numbers from the calling thread's generator. */
+  std::vector<uint32> draw() {
+    std::vector<uint32> v;
+    for ( int i = 0; i < n_draws; ++i )
+      v.push_back( MTRNGrandInt() );
+    return v;
+  }
+
+  /** The numbers of a given stream (drawn in the calling thread). */
+  std::vector<uint32> stream_draws( uint32 stream ) {
+    MTRNGstream( &stream );
+    return draw();
+  }
+
+#if defined(USE_PTHREAD)
+  struct StreamThread {
+    uint32 stream;
+    std::vector<uint32> values;
+  };
+
+  void * run_stream( void * arg ) {
+    StreamThread & t = *static_cast<StreamThread*>(arg);
+    MTRNGstream( &t.stream );
+    t.values = draw();
+    return NULL;
+  }
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE( random_tests );
+
+BOOST_AUTO_TEST_CASE( master_seed ) {
+  uint32 seed = 4357;
+  MTRNGseedV1( &seed );
+  uint32 zero = 0;
+  MTRNGstream( &zero );
+
+  uint32 s = 0;
+  MTRNGgetSeed( &s );
+  BOOST_CHECK_EQUAL( s, seed );
+
+  /* stream 0 is the same as a single generator with the master seed. */
+  MTRand reference( seed );
+  for ( int i = 0; i < n_draws; ++i )
+    BOOST_CHECK_EQUAL( MTRNGrandInt(), reference.randInt() );
+
+  /* setting the master seed again restarts the stream. */
+  MTRNGseedV1( &seed );
+  reference.seed( seed );
+  BOOST_CHECK_EQUAL( MTRNGrand(), reference.rand() );
+  BOOST_CHECK_EQUAL( thread_rand().randInt(), reference.randInt() );
+}
+
+BOOST_AUTO_TEST_CASE( save_load ) {
+  uint32 state[MTRand::SAVE];
+  MTRNGsave( state );
+  std::vector<uint32> a = draw();
+  MTRNGload( state );
+  BOOST_CHECK( draw() == a );
+}
+
+BOOST_AUTO_TEST_CASE( streams ) {
+  uint32 seed = 5489;
+  MTRNGseedV1( &seed );
+
+  std::vector<uint32> s1 = stream_draws(1);
+  std::vector<uint32> s2 = stream_draws(2);
+  BOOST_CHECK( s1 != s2 );
+  BOOST_CHECK( stream_draws(1) == s1 );
+  BOOST_CHECK( stream_draws(0) != s1 );
+
+  /* a different master seed gives different streams. */
+  ++seed;
+  MTRNGseedV1( &seed );
+  BOOST_CHECK( stream_draws(1) != s1 );
+}
+
+#if defined(USE_PTHREAD)
+BOOST_AUTO_TEST_CASE( threads ) {
+  uint32 seed = 1234;
+  MTRNGseedV1( &seed );
+
+  const int n = 4;
+  StreamThread t[n];
+  pthread_t threads[n];
+  for ( int i = 0; i < n; ++i ) {
+    t[i].stream = i + 1;
+    pthread_create( threads + i, NULL, &run_stream, t + i );
+  }
+  for ( int i = 0; i < n; ++i )
+    pthread_join( threads[i], NULL );
+
+  /* each thread got its own stream, reproducibly. */
+  for ( int i = 0; i < n; ++i ) {
+    BOOST_CHECK( t[i].values == stream_draws(i + 1) );
+    for ( int j = 0; j < i; ++j )
+      BOOST_CHECK( t[i].values != t[j].values );
+  }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END();